@@ -0,0 +1,160 @@
+// Packs directories into one archive that the game maps at startup (see AssetArchive.hpp).
+// Run it from the game's working directory so entries get the paths the loaders ask for:
+//   AssetPacker ShootingGallery.gpak Assets Shaders
+// -nocompress stores every file raw.
+#include "AssetArchive.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+	// Appends every file under directory (recursively) to outFiles, in a stable order
+	bool ListFiles(const std::string& directory, std::vector<std::string>& outFiles)
+	{
+		std::vector<std::string> names;
+		std::vector<std::string> subdirectories;
+#ifdef _WIN32
+		WIN32_FIND_DATAA data;
+		HANDLE find = FindFirstFileA((directory + "/*").c_str(), &data);
+		if (find == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		do
+		{
+			if (strcmp(data.cFileName, ".") == 0 || strcmp(data.cFileName, "..") == 0)
+			{
+				continue;
+			}
+			std::string path = directory + "/" + data.cFileName;
+			if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			{
+				subdirectories.emplace_back(path);
+			}
+			else
+			{
+				names.emplace_back(path);
+			}
+		} while (FindNextFileA(find, &data));
+		FindClose(find);
+#else
+		DIR* dir = opendir(directory.c_str());
+		if (dir == nullptr)
+		{
+			return false;
+		}
+		while (dirent* entry = readdir(dir))
+		{
+			if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+			{
+				continue;
+			}
+			std::string path = directory + "/" + entry->d_name;
+			struct stat info;
+			if (stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+			{
+				subdirectories.emplace_back(path);
+			}
+			else
+			{
+				names.emplace_back(path);
+			}
+		}
+		closedir(dir);
+#endif
+		std::sort(names.begin(), names.end());
+		std::sort(subdirectories.begin(), subdirectories.end());
+		outFiles.insert(outFiles.end(), names.begin(), names.end());
+		for (const std::string& subdirectory : subdirectories)
+		{
+			if (!ListFiles(subdirectory, outFiles))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string output;
+	std::vector<std::string> directories;
+	bool compress = true;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-nocompress") == 0)
+		{
+			compress = false;
+		}
+		else if (output.empty())
+		{
+			output = argv[i];
+		}
+		else
+		{
+			directories.emplace_back(argv[i]);
+		}
+	}
+	if (output.empty() || directories.empty())
+	{
+		printf("Usage: AssetPacker output.gpak directory... [-nocompress]\n");
+		return 1;
+	}
+
+	std::vector<std::string> files;
+	for (const std::string& directory : directories)
+	{
+		if (!ListFiles(AssetArchive::NormalizePath(directory), files))
+		{
+			printf("Can't read directory %s\n", directory.c_str());
+			return 1;
+		}
+	}
+
+	ArchiveWriter writer;
+	for (const std::string& path : files)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open())
+		{
+			printf("Can't read %s\n", path.c_str());
+			return 1;
+		}
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		writer.AddFile(path, std::move(data), compress);
+	}
+
+	std::string error;
+	if (!writer.Write(output, error))
+	{
+		printf("Failed to write %s: %s\n", output.c_str(), error.c_str());
+		return 1;
+	}
+
+	// Read the result back the way the game will
+	AssetArchive archive;
+	if (!archive.Open(output, error) || !archive.Verify(error))
+	{
+		printf("%s doesn't read back: %s\n", output.c_str(), error.c_str());
+		return 1;
+	}
+
+	const ArchiveWriter::Stats& stats = writer.GetStats();
+	printf("Packed %zu files (%zu compressed) into %s: %.2f MB -> %.2f MB\n", stats.mFiles, stats.mCompressedFiles,
+		output.c_str(), stats.mRawBytes / (1024.0 * 1024.0), stats.mStoredBytes / (1024.0 * 1024.0));
+	return 0;
+}
@@ -0,0 +1,562 @@
+// Micro-benchmarks for the Math and Collision kernels.
+// Inputs mimic the gallery: plane boxes laid out like Game::LoadData and
+// 30 unit ball segments like BallMove casts each frame.
+// The game's headers pull in SDL, which would otherwise rename BENCHMARK_MAIN's main
+#define SDL_MAIN_HANDLED
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+#include "Math.hpp"
+#include "Collision.hpp"
+#include "ComponentPool.hpp"
+#include "Game.hpp"
+#include "Actor.hpp"
+#include "Renderer.hpp"
+#include "Mesh.hpp"
+#include "MoveComponent.hpp"
+#include "MeshComponent.hpp"
+#include "BoxComponent.hpp"
+#include "NetSnapshot.hpp"
+#include <algorithm>
+#include <memory>
+
+namespace
+{
+	const int NumInputs = 1024;
+
+	std::mt19937& Rng()
+	{
+		static std::mt19937 rng(1234);
+		return rng;
+	}
+
+	float RandomFloat(float min, float max)
+	{
+		std::uniform_real_distribution<float> dist(min, max);
+		return dist(Rng());
+	}
+
+	Vector3 RandomVector(float min, float max)
+	{
+		return Vector3(RandomFloat(min, max), RandomFloat(min, max), RandomFloat(min, max));
+	}
+
+	Vector3 RandomDirection()
+	{
+		Vector3 dir = RandomVector(-1.0f, 1.0f);
+		if (Math::NearZero(dir.LengthSq()))
+		{
+			return Vector3::UnitX;
+		}
+		dir.Normalize();
+		return dir;
+	}
+
+	Quaternion RandomRotation()
+	{
+		return Quaternion(RandomDirection(), RandomFloat(0.0f, Math::TwoPi));
+	}
+
+	// Same construction as Actor::ComputeWorldTransform
+	Matrix4 RandomWorldTransform()
+	{
+		Matrix4 world = Matrix4::CreateScale(RandomFloat(0.5f, 10.0f));
+		world *= Matrix4::CreateFromQuaternion(RandomRotation());
+		world *= Matrix4::CreateTranslation(RandomVector(-1500.0f, 1500.0f));
+		return world;
+	}
+
+	// World box of a plane, computed like BoxComponent::OnUpdateWorldTransform
+	AABB PlaneBox(const Vector3& pos, const Quaternion& rot, float scale)
+	{
+		AABB box(Vector3(-50.0f, -50.0f, 0.0f), Vector3(50.0f, 50.0f, 0.0f));
+		box.mMin *= scale;
+		box.mMax *= scale;
+		box.Rotate(rot);
+		box.mMin += pos;
+		box.mMax += pos;
+		return box;
+	}
+
+	// The floor, outer walls and wall blocks of the gallery
+	const std::vector<AABB>& GalleryPlaneBoxes()
+	{
+		static std::vector<AABB> boxes;
+		if (boxes.empty())
+		{
+			const float start = -1250.0f;
+			const float size = 250.0f;
+			Quaternion q(Vector3::UnitX, Math::PiOver2);
+			Quaternion q2 = Quaternion::Concatenate(q, Quaternion(Vector3::UnitZ, Math::PiOver2));
+			for (int i = 0; i < 10; i++)
+			{
+				for (int j = 0; j < 10; j++)
+				{
+					boxes.emplace_back(PlaneBox(Vector3(start + i * size, start + j * size, -100.0f), Quaternion::Identity, 10.0f));
+				}
+				boxes.emplace_back(PlaneBox(Vector3(start + i * size, start - size, 0.0f), q, 10.0f));
+				boxes.emplace_back(PlaneBox(Vector3(start + i * size, -start + size, 0.0f), q, 10.0f));
+				boxes.emplace_back(PlaneBox(Vector3(start - size, start + i * size, 0.0f), q2, 10.0f));
+				boxes.emplace_back(PlaneBox(Vector3(-start + size, start + i * size, 0.0f), q2, 10.0f));
+			}
+			for (int i = 0; i < 17; i++)
+			{
+				for (int j = 0; j < 9; j++)
+				{
+					boxes.emplace_back(PlaneBox(Vector3(0.0f, start - size / 2 - 50 + i * 50, j * 50.0f), q2, 2.0f));
+				}
+			}
+			for (int i = 0; i < 10; i++)
+			{
+				for (int j = 0; j < 9; j++)
+				{
+					boxes.emplace_back(PlaneBox(Vector3(-500.0f, -start - size + i * 50, j * 50.0f), q2, 2.0f));
+					boxes.emplace_back(PlaneBox(Vector3(-700.0f, -start - size + i * 50, j * 50.0f), q2, 2.0f));
+				}
+			}
+		}
+		return boxes;
+	}
+
+	// Ball segments spread over the arena, as cast by BallMove
+	const std::vector<LineSegment>& BallSegments()
+	{
+		static std::vector<LineSegment> segments;
+		if (segments.empty())
+		{
+			for (int i = 0; i < NumInputs; i++)
+			{
+				Vector3 start(RandomFloat(-1500.0f, 1500.0f), RandomFloat(-1500.0f, 1500.0f), RandomFloat(-100.0f, 450.0f));
+				segments.emplace_back(start, start + RandomDirection() * 30.0f);
+			}
+		}
+		return segments;
+	}
+}
+
+static void BM_Matrix4Multiply(benchmark::State& state)
+{
+	std::vector<Matrix4> a, b;
+	for (int i = 0; i < NumInputs; i++)
+	{
+		a.emplace_back(RandomWorldTransform());
+		b.emplace_back(RandomWorldTransform());
+	}
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		Matrix4 result = a[i] * b[i];
+		benchmark::DoNotOptimize(result);
+		i = (i + 1) % NumInputs;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Matrix4Multiply);
+
+static void BM_Matrix4Invert(benchmark::State& state)
+{
+	// View * projection, as inverted by Renderer::Unproject
+	Matrix4 proj = Matrix4::CreatePerspectiveFOV(Math::ToRadians(70.0f), 1024.0f, 768.0f, 10.0f, 10000.0f);
+	std::vector<Matrix4> inputs;
+	for (int i = 0; i < NumInputs; i++)
+	{
+		Vector3 eye = RandomVector(-1000.0f, 1000.0f);
+		inputs.emplace_back(Matrix4::CreateLookAt(eye, eye + RandomDirection() * 100.0f, Vector3::UnitZ) * proj);
+	}
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		Matrix4 m = inputs[i];
+		m.Invert();
+		benchmark::DoNotOptimize(m);
+		i = (i + 1) % NumInputs;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Matrix4Invert);
+
+static void BM_CreateFromQuaternion(benchmark::State& state)
+{
+	std::vector<Quaternion> inputs;
+	for (int i = 0; i < NumInputs; i++)
+	{
+		inputs.emplace_back(RandomRotation());
+	}
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		Matrix4 m = Matrix4::CreateFromQuaternion(inputs[i]);
+		benchmark::DoNotOptimize(m);
+		i = (i + 1) % NumInputs;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CreateFromQuaternion);
+
+static void BM_QuaternionSlerp(benchmark::State& state)
+{
+	std::vector<Quaternion> a, b;
+	std::vector<float> f;
+	for (int i = 0; i < NumInputs; i++)
+	{
+		a.emplace_back(RandomRotation());
+		b.emplace_back(RandomRotation());
+		f.emplace_back(RandomFloat(0.0f, 1.0f));
+	}
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		Quaternion q = Quaternion::Slerp(a[i], b[i], f[i]);
+		benchmark::DoNotOptimize(q);
+		i = (i + 1) % NumInputs;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_QuaternionSlerp);
+
+static void BM_Vector3TransformMatrix(benchmark::State& state)
+{
+	std::vector<Vector3> points;
+	std::vector<Matrix4> worlds;
+	for (int i = 0; i < NumInputs; i++)
+	{
+		points.emplace_back(RandomVector(-50.0f, 50.0f));
+		worlds.emplace_back(RandomWorldTransform());
+	}
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		Vector3 v = Vector3::Transform(points[i], worlds[i]);
+		benchmark::DoNotOptimize(v);
+		i = (i + 1) % NumInputs;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Vector3TransformMatrix);
+
+static void BM_Vector3TransformQuaternion(benchmark::State& state)
+{
+	std::vector<Vector3> points;
+	std::vector<Quaternion> rotations;
+	for (int i = 0; i < NumInputs; i++)
+	{
+		points.emplace_back(RandomVector(-50.0f, 50.0f));
+		rotations.emplace_back(RandomRotation());
+	}
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		Vector3 v = Vector3::Transform(points[i], rotations[i]);
+		benchmark::DoNotOptimize(v);
+		i = (i + 1) % NumInputs;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Vector3TransformQuaternion);
+
+static void BM_AABBRotate(benchmark::State& state)
+{
+	// Plane object box with the wall rotations used by the gallery
+	Quaternion q(Vector3::UnitX, Math::PiOver2);
+	Quaternion rotations[3] = { Quaternion::Identity, q, Quaternion::Concatenate(q, Quaternion(Vector3::UnitZ, Math::PiOver2)) };
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		AABB box(Vector3(-50.0f, -50.0f, 0.0f), Vector3(50.0f, 50.0f, 0.0f));
+		box.Rotate(rotations[i]);
+		benchmark::DoNotOptimize(box);
+		i = (i + 1) % 3;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AABBRotate);
+
+// The FPSActor::FixCollisions loop: the player box against every plane
+static void BM_IntersectAABBGallery(benchmark::State& state)
+{
+	const std::vector<AABB>& planes = GalleryPlaneBoxes();
+	std::vector<AABB> players;
+	for (int i = 0; i < NumInputs; i++)
+	{
+		Vector3 pos(RandomFloat(-1250.0f, 1250.0f), RandomFloat(-1250.0f, 1250.0f), 0.0f);
+		players.emplace_back(Vector3(-25.0f, -25.0f, -87.5f) + pos, Vector3(25.0f, 25.0f, 87.5f) + pos);
+	}
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		int hits = 0;
+		for (const AABB& plane : planes)
+		{
+			hits += Intersect(players[i], plane) ? 1 : 0;
+		}
+		benchmark::DoNotOptimize(hits);
+		i = (i + 1) % NumInputs;
+	}
+	state.SetItemsProcessed(state.iterations() * planes.size());
+}
+BENCHMARK(BM_IntersectAABBGallery);
+
+// The PhysWorld::SegmentCast loop: one ball segment against every plane
+static void BM_IntersectSegmentGallery(benchmark::State& state)
+{
+	const std::vector<AABB>& planes = GalleryPlaneBoxes();
+	const std::vector<LineSegment>& segments = BallSegments();
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		float closestT = Math::Infinity;
+		for (const AABB& plane : planes)
+		{
+			float t;
+			Vector3 norm;
+			if (Intersect(segments[i], plane, t, norm) && t < closestT)
+			{
+				closestT = t;
+			}
+		}
+		benchmark::DoNotOptimize(closestT);
+		i = (i + 1) % segments.size();
+	}
+	state.SetItemsProcessed(state.iterations() * planes.size());
+}
+BENCHMARK(BM_IntersectSegmentGallery);
+
+static void BM_MinDistSq(benchmark::State& state)
+{
+	const std::vector<AABB>& planes = GalleryPlaneBoxes();
+	std::vector<Vector3> points;
+	for (int i = 0; i < NumInputs; i++)
+	{
+		points.emplace_back(RandomFloat(-1500.0f, 1500.0f), RandomFloat(-1500.0f, 1500.0f), RandomFloat(-100.0f, 450.0f));
+	}
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		float minDist = Math::Infinity;
+		for (const AABB& plane : planes)
+		{
+			minDist = Math::Min(minDist, plane.MinDistSq(points[i]));
+		}
+		benchmark::DoNotOptimize(minDist);
+		i = (i + 1) % NumInputs;
+	}
+	state.SetItemsProcessed(state.iterations() * planes.size());
+}
+BENCHMARK(BM_MinDistSq);
+
+// Component update loops over heap-scattered vs pooled storage, on the real component types.
+// Each component gets its own actor in a hosted headless game. The scattered instances are allocated
+// between other allocations and visited in shuffled order, like a component list after a few levels
+// of spawning and deleting. Run from the ShootingGallery directory so Target.gpmesh loads, and with
+// --benchmark_perf_counters=CACHE-MISSES (Google Benchmark built with libpfm) to get cache misses per type.
+namespace
+{
+	const int NumComponents = 914;
+
+	class ComponentScene
+	{
+	public:
+		ComponentScene()
+		{
+			mGame.SetHosted(true);
+			mGame.SetSceneLoader([](Game*) {});
+			mGame.Initialize(true);
+			mMesh = mGame.GetRenderer()->GetMesh("Assets/Target.gpmesh");
+			for (int i = 0; i < NumComponents; i++)
+			{
+				Actor* actor = new Actor(&mGame);
+				actor->SetPosition(RandomVector(-1000.0f, 1000.0f));
+				actor->ComputeWorldTransform();
+				mActors.emplace_back(actor);
+			}
+		}
+		~ComponentScene()
+		{
+			mMesh.Reset();
+			mGame.Shutdown();
+		}
+
+		Game* GetGame() { return &mGame; }
+		Actor* GetActor(int index) { return mActors[index]; }
+		const AssetHandle<Mesh>& GetMesh() const { return mMesh; }
+
+	private:
+		Game mGame;
+		AssetHandle<Mesh> mMesh;
+		std::vector<Actor*> mActors;
+	};
+
+	// Set up like the gallery's own actors
+	void Setup(MoveComponent& comp, ComponentScene&)
+	{
+		comp.SetAngularSpeed(1.0f);
+		comp.SetForwardSpeed(100.0f);
+	}
+	void Setup(MeshComponent& comp, ComponentScene& scene)
+	{
+		comp.SetMesh(scene.GetMesh());
+	}
+	void Setup(BoxComponent& comp, ComponentScene&)
+	{
+		comp.SetObjectBox(AABB(Vector3(-50.0f, -50.0f, -2.5f), Vector3(50.0f, 50.0f, 2.5f)));
+	}
+
+	// The per frame work the game does for each type
+	void Kernel(MoveComponent& comp)
+	{
+		comp.Update(0.016f);
+	}
+	void Kernel(MeshComponent& comp)
+	{
+		// Like Renderer::BuildSnapshot, for a 768 pixel high view with a 70 degree field of view
+		if (comp.GetVisible() && comp.GetMesh())
+		{
+			comp.SelectLOD(Vector3::Zero, 548.0f);
+		}
+	}
+	void Kernel(BoxComponent& comp)
+	{
+		comp.OnUpdateWorldTransform();
+	}
+}
+
+template <typename T>
+static void BM_UpdateScattered(benchmark::State& state)
+{
+	ComponentScene scene;
+	std::vector<T*> components;
+	std::vector<std::unique_ptr<char[]>> other;
+	std::uniform_int_distribution<int> otherSize(16, 256);
+	for (int i = 0; i < NumComponents; i++)
+	{
+		// Global placement new skips the type's pool
+		T* comp = ::new (::operator new(sizeof(T))) T(scene.GetActor(i));
+		Setup(*comp, scene);
+		components.emplace_back(comp);
+		other.emplace_back(new char[otherSize(Rng())]);
+	}
+	std::shuffle(components.begin(), components.end(), Rng());
+	for (auto _ : state)
+	{
+		for (T* comp : components)
+		{
+			Kernel(*comp);
+		}
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * components.size());
+
+	// Before the scene deletes the actors, which would hand them to the pool
+	for (T* comp : components)
+	{
+		comp->~T();
+		::operator delete(comp);
+	}
+}
+BENCHMARK_TEMPLATE(BM_UpdateScattered, MoveComponent);
+BENCHMARK_TEMPLATE(BM_UpdateScattered, MeshComponent);
+BENCHMARK_TEMPLATE(BM_UpdateScattered, BoxComponent);
+
+template <typename T>
+static void BM_UpdatePooled(benchmark::State& state)
+{
+	ComponentScene scene;
+	{
+		// Allocated from the scene's pools, like the game's own components
+		ComponentPools::Scope pools(scene.GetGame());
+		for (int i = 0; i < NumComponents; i++)
+		{
+			Setup(*new T(scene.GetActor(i)), scene);
+		}
+	}
+	ComponentPool<T>& pool = ComponentPool<T>::Get(scene.GetGame());
+	for (auto _ : state)
+	{
+		pool.ForEach([](T& comp) { Kernel(comp); });
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * NumComponents);
+}
+BENCHMARK_TEMPLATE(BM_UpdatePooled, MoveComponent);
+BENCHMARK_TEMPLATE(BM_UpdatePooled, MeshComponent);
+BENCHMARK_TEMPLATE(BM_UpdatePooled, BoxComponent);
+
+// Snapshot encoding for one client: 20 targets, the player and Arg(0) balls in flight.
+// Delta packets are encoded against the previous tick, full packets against nothing.
+namespace
+{
+	void MakeSnapshots(int balls, NetSnapshot& outPrevious, NetSnapshot& outCurrent)
+	{
+		std::uniform_real_distribution<float> coord(-1000.0f, 1000.0f);
+		outPrevious.mTick = 0;
+		outPrevious.mActors.clear();
+		uint32_t id = 1;
+		for (int i = 0; i < 21 + balls; i++)
+		{
+			NetActorState actor = {};
+			actor.mID = id++;
+			actor.mType = i == 0 ? NetActorState::EPlayer : (i <= 20 ? NetActorState::ETarget : NetActorState::EBall);
+			actor.SetTransform(Vector3(coord(Rng()), coord(Rng()), coord(Rng()) * 0.1f), Quaternion(Vector3::UnitZ, coord(Rng())), 1.0f);
+			actor.mLifeSpan = actor.mType == NetActorState::EBall ? 120 : 0;
+			outPrevious.mActors.emplace_back(actor);
+		}
+
+		// Balls move 25 units and age a tick, everything else stays put
+		outCurrent = outPrevious;
+		outCurrent.mTick = 1;
+		for (NetActorState& actor : outCurrent.mActors)
+		{
+			if (actor.mType == NetActorState::EBall)
+			{
+				actor.SetTransform(actor.GetPosition() + Vector3(25.0f, 0.0f, 0.0f), actor.GetRotation(), actor.GetScale());
+				actor.mLifeSpan--;
+			}
+		}
+	}
+}
+
+static void BM_SnapshotEncodeFull(benchmark::State& state)
+{
+	NetSnapshot previous, current;
+	MakeSnapshots(static_cast<int>(state.range(0)), previous, current);
+	BitWriter writer;
+	for (auto _ : state)
+	{
+		writer.Reset();
+		SnapshotCodec::Encode(current, nullptr, writer);
+		benchmark::DoNotOptimize(writer.GetData().data());
+	}
+	state.counters["bytes"] = static_cast<double>(writer.GetData().size());
+}
+BENCHMARK(BM_SnapshotEncodeFull)->Arg(10)->Arg(100);
+
+static void BM_SnapshotEncodeDelta(benchmark::State& state)
+{
+	NetSnapshot previous, current;
+	MakeSnapshots(static_cast<int>(state.range(0)), previous, current);
+	BitWriter writer;
+	for (auto _ : state)
+	{
+		writer.Reset();
+		SnapshotCodec::Encode(current, &previous, writer);
+		benchmark::DoNotOptimize(writer.GetData().data());
+	}
+	state.counters["bytes"] = static_cast<double>(writer.GetData().size());
+}
+BENCHMARK(BM_SnapshotEncodeDelta)->Arg(10)->Arg(100);
+
+static void BM_SnapshotDecodeDelta(benchmark::State& state)
+{
+	NetSnapshot previous, current, decoded;
+	MakeSnapshots(static_cast<int>(state.range(0)), previous, current);
+	BitWriter writer;
+	SnapshotCodec::Encode(current, &previous, writer);
+	for (auto _ : state)
+	{
+		SnapshotCodec::Decode(writer.GetData().data(), writer.GetData().size(), &previous, decoded);
+		benchmark::DoNotOptimize(decoded.mActors.data());
+	}
+}
+BENCHMARK(BM_SnapshotDecodeDelta)->Arg(10)->Arg(100);
+
+BENCHMARK_MAIN();
@@ -3,7 +3,7 @@
 #include "Component.hpp"
 #include <algorithm>
 
-Actor::Actor(Game* game): mState(EActive), mPosition(Vector3::Zero), mRotation(Quaternion::Identity), mScale(1.0f), mGame(game), mRecomputeWorldTransform(true)
+Actor::Actor(Game* game, Type type): mState(EActive), mPosition(Vector3::Zero), mRotation(Quaternion::Identity), mScale(1.0f), mGame(game), mRecomputeWorldTransform(true), mIsStatic(false), mID(game->GenerateActorID()), mType(type)
 {
 	mGame->AddActor(this);
 }
@@ -23,21 +23,12 @@ void Actor::Update(float deltaTime)
 	{
 		ComputeWorldTransform();
 
-		UpdateComponents(deltaTime);
 		UpdateActor(deltaTime);
 
 		ComputeWorldTransform();
 	}
 }
 
-void Actor::UpdateComponents(float deltaTime)
-{
-	for (auto comp : mComponents)
-	{
-		comp->Update(deltaTime);
-	}
-}
-
 void Actor::UpdateActor(float deltaTime)
 {
 }
@@ -96,21 +87,20 @@ void Actor::ComputeWorldTransform()
 	}
 }
 
-void Actor::AddComponent(Component* component)
+void Actor::SetState(State state)
 {
-	int myOrder = component->GetUpdateOrder();
-	auto iter = mComponents.begin();
-	for (;
-		iter != mComponents.end();
-		++iter)
+	mState = state;
+	for (auto comp : mComponents)
 	{
-		if (myOrder < (*iter)->GetUpdateOrder())
-		{
-			break;
-		}
+		comp->SetOwnerActive(mState == EActive);
 	}
+}
 
-	mComponents.insert(iter, component);
+void Actor::AddComponent(Component* component)
+{
+	// Update order is handled by the game's tick lists, this list is only for input and transforms
+	component->SetOwnerActive(mState == EActive);
+	mComponents.emplace_back(component);
 }
 
 void Actor::RemoveComponent(Component* component)
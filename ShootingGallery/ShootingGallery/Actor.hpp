@@ -14,11 +14,21 @@ public:
 		EDead
 	};
 
-	Actor(class Game* game);
+	// Concrete class of the actor, so hot paths can check it without RTTI
+	enum Type : uint8_t
+	{
+		EGeneric,
+		EPlayer,
+		ETarget,
+		EBall,
+		EPlane
+	};
+
+	Actor(class Game* game, Type type = EGeneric);
 	virtual ~Actor();
 
+	// Ticking components were already updated by the game for this frame
 	void Update(float deltaTime);
-	void UpdateComponents(float deltaTime);
 	virtual void UpdateActor(float deltaTime);
 
 	void ProcessInput(const uint8_t* keyState);
@@ -40,10 +50,17 @@ public:
 
 	void RotateToNewForward(const Vector3& forward);
 
+	Type GetType() const { return mType; }
 	State GetState() const { return mState; }
-	void SetState(State state) { mState = state; }
+	void SetState(State state);
+
+	// Static actors are baked into the level geometry and never updated or moved again
+	bool IsStatic() const { return mIsStatic; }
+	void SetStatic(bool isStatic) { mIsStatic = isStatic; }
 
 	class Game* GetGame() { return mGame; }
+	// Unique within its game, never reused (replication identifies actors by it)
+	uint32_t GetID() const { return mID; }
 
 	void AddComponent(class Component* component);
 	void RemoveComponent(class Component* component);
@@ -55,6 +72,9 @@ private:
 	Quaternion mRotation;
 	float mScale;
 	bool mRecomputeWorldTransform;
+	bool mIsStatic;
+	uint32_t mID;
+	Type mType;
 
 	std::vector<class Component*> mComponents;
 	class Game* mGame;
@@ -0,0 +1,358 @@
+#include "AssetArchive.hpp"
+#include "LZ4.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const char ArchiveMagic[4] = { 'G', 'P', 'A', 'K' };
+	// Entry data is aligned so views can be read as floats/ints in place
+	const uint64_t DataAlignment = 16;
+
+	uint64_t AlignUp(uint64_t value)
+	{
+		return (value + DataAlignment - 1) & ~(DataAlignment - 1);
+	}
+}
+
+void FileData::SetView(const uint8_t* data, size_t size)
+{
+	mOwned.clear();
+	mOwned.shrink_to_fit();
+	mData = data;
+	mSize = size;
+}
+
+uint8_t* FileData::Allocate(size_t size)
+{
+	// Never empty, so IsView stays false for empty files too
+	mOwned.resize(size + 1);
+	mOwned[size] = 0;
+	mData = mOwned.data();
+	mSize = size;
+	return mOwned.data();
+}
+
+AssetArchive::AssetArchive():mBase(nullptr), mSize(0), mEntries(nullptr), mNumEntries(0), mNames(nullptr), mNamesSize(0), mFile(nullptr), mMapping(nullptr)
+{
+}
+
+AssetArchive::~AssetArchive()
+{
+	Close();
+}
+
+bool AssetArchive::Open(const std::string& fileName, std::string& outError)
+{
+	Close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		outError = "can't open file";
+		return false;
+	}
+	LARGE_INTEGER size;
+	HANDLE mapping = nullptr;
+	void* view = nullptr;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+	{
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	}
+	if (view == nullptr)
+	{
+		if (mapping)
+		{
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		outError = "can't map file";
+		return false;
+	}
+	mFile = file;
+	mMapping = mapping;
+	mBase = static_cast<const uint8_t*>(view);
+	mSize = static_cast<size_t>(size.QuadPart);
+#else
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		outError = "can't open file";
+		return false;
+	}
+	struct stat info;
+	void* view = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && info.st_size > 0)
+	{
+		view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	// The mapping keeps the file alive
+	close(fd);
+	if (view == MAP_FAILED)
+	{
+		outError = "can't map file";
+		return false;
+	}
+	mBase = static_cast<const uint8_t*>(view);
+	mSize = static_cast<size_t>(info.st_size);
+#endif
+
+	Header header;
+	if (mSize < sizeof(Header))
+	{
+		outError = "file is too small";
+		Close();
+		return false;
+	}
+	memcpy(&header, mBase, sizeof(Header));
+	if (memcmp(header.mMagic, ArchiveMagic, sizeof(ArchiveMagic)) != 0 || header.mVersion != Version)
+	{
+		outError = "not a version 1 asset archive";
+		Close();
+		return false;
+	}
+	uint64_t tocSize = static_cast<uint64_t>(header.mNumEntries) * sizeof(Entry);
+	if (header.mTocOffset % DataAlignment != 0 || header.mTocOffset > mSize || tocSize + header.mNamesSize > mSize - header.mTocOffset)
+	{
+		outError = "table of contents is out of bounds";
+		Close();
+		return false;
+	}
+	mEntries = reinterpret_cast<const Entry*>(mBase + header.mTocOffset);
+	mNumEntries = header.mNumEntries;
+	mNames = reinterpret_cast<const char*>(mBase + header.mTocOffset + tocSize);
+	mNamesSize = header.mNamesSize;
+
+	// Checking the bounds once here lets Read trust the entries
+	for (size_t i = 0; i < mNumEntries; i++)
+	{
+		const Entry& entry = mEntries[i];
+		bool valid = entry.mOffset <= header.mTocOffset && entry.mStoredSize <= header.mTocOffset - entry.mOffset &&
+			static_cast<uint64_t>(entry.mNameOffset) + entry.mNameLength <= mNamesSize &&
+			(entry.mCompression == ELZ4 || (entry.mCompression == ENone && entry.mStoredSize == entry.mSize)) &&
+			(i == 0 || mEntries[i - 1].mPathHash <= entry.mPathHash);
+		if (!valid)
+		{
+			outError = "entry " + std::to_string(i) + " is corrupt";
+			Close();
+			return false;
+		}
+	}
+	mRawVerified.reset(new std::atomic<bool>[mNumEntries]);
+	for (size_t i = 0; i < mNumEntries; i++)
+	{
+		mRawVerified[i].store(false, std::memory_order_relaxed);
+	}
+	return true;
+}
+
+void AssetArchive::Close()
+{
+	if (mBase)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(mBase);
+		CloseHandle(static_cast<HANDLE>(mMapping));
+		CloseHandle(static_cast<HANDLE>(mFile));
+#else
+		munmap(const_cast<uint8_t*>(mBase), mSize);
+#endif
+	}
+	mBase = nullptr;
+	mSize = 0;
+	mEntries = nullptr;
+	mNumEntries = 0;
+	mNames = nullptr;
+	mNamesSize = 0;
+	mRawVerified.reset();
+	mFile = nullptr;
+	mMapping = nullptr;
+}
+
+const AssetArchive::Entry* AssetArchive::Find(const std::string& path) const
+{
+	std::string name = NormalizePath(path);
+	uint64_t hash = Hash(name.data(), name.size());
+	const Entry* end = mEntries + mNumEntries;
+	const Entry* entry = std::lower_bound(mEntries, end, hash,
+		[](const Entry& e, uint64_t h) { return e.mPathHash < h; });
+	for (; entry != end && entry->mPathHash == hash; ++entry)
+	{
+		if (entry->mNameLength == name.size() && memcmp(mNames + entry->mNameOffset, name.data(), name.size()) == 0)
+		{
+			return entry;
+		}
+	}
+	return nullptr;
+}
+
+bool AssetArchive::Read(const Entry& entry, FileData& outData) const
+{
+	const uint8_t* stored = mBase + entry.mOffset;
+	if (entry.mCompression == ENone)
+	{
+		// Hashed once; two threads racing on the first read just both hash it
+		std::atomic<bool>& verified = mRawVerified[&entry - mEntries];
+		if (!verified.load(std::memory_order_relaxed))
+		{
+			if (Hash(stored, entry.mSize) != entry.mContentHash)
+			{
+				return false;
+			}
+			verified.store(true, std::memory_order_relaxed);
+		}
+		outData.SetView(stored, entry.mSize);
+		return true;
+	}
+	uint8_t* data = outData.Allocate(entry.mSize);
+	return LZ4::Decompress(stored, entry.mStoredSize, data, entry.mSize) && Hash(data, entry.mSize) == entry.mContentHash;
+}
+
+bool AssetArchive::Verify(std::string& outError) const
+{
+	FileData data;
+	for (size_t i = 0; i < mNumEntries; i++)
+	{
+		if (!Read(mEntries[i], data) || Hash(data.GetData(), data.GetSize()) != mEntries[i].mContentHash)
+		{
+			outError = GetName(mEntries[i]) + " doesn't match its content hash";
+			return false;
+		}
+	}
+	return true;
+}
+
+std::string AssetArchive::GetName(const Entry& entry) const
+{
+	return std::string(mNames + entry.mNameOffset, entry.mNameLength);
+}
+
+uint64_t AssetArchive::Hash(const void* data, size_t size)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+std::string AssetArchive::NormalizePath(const std::string& path)
+{
+	std::string result(path);
+	std::replace(result.begin(), result.end(), '\\', '/');
+	while (result.compare(0, 2, "./") == 0)
+	{
+		result.erase(0, 2);
+	}
+	return result;
+}
+
+void ArchiveWriter::AddFile(const std::string& path, std::vector<uint8_t> data, bool compress)
+{
+	File file;
+	file.mPath = AssetArchive::NormalizePath(path);
+	file.mEntry = {};
+	file.mEntry.mPathHash = AssetArchive::Hash(file.mPath.data(), file.mPath.size());
+	file.mEntry.mContentHash = AssetArchive::Hash(data.data(), data.size());
+	file.mEntry.mSize = static_cast<uint32_t>(data.size());
+	file.mEntry.mCompression = AssetArchive::ENone;
+
+	if (compress && !data.empty())
+	{
+		std::vector<uint8_t> packed(LZ4::CompressBound(data.size()));
+		size_t packedSize = LZ4::Compress(data.data(), data.size(), packed.data(), packed.size());
+		// Already compressed formats (png) are kept raw so they can be read in place
+		if (packedSize > 0 && packedSize <= data.size() - data.size() / 10)
+		{
+			packed.resize(packedSize);
+			data.swap(packed);
+			file.mEntry.mCompression = AssetArchive::ELZ4;
+			mStats.mCompressedFiles++;
+		}
+	}
+	file.mEntry.mStoredSize = static_cast<uint32_t>(data.size());
+	file.mData.swap(data);
+
+	mStats.mFiles++;
+	mStats.mRawBytes += file.mEntry.mSize;
+	mStats.mStoredBytes += file.mEntry.mStoredSize;
+	mFiles.emplace_back(std::move(file));
+}
+
+bool ArchiveWriter::Write(const std::string& fileName, std::string& outError)
+{
+	std::sort(mFiles.begin(), mFiles.end(), [](const File& a, const File& b)
+	{
+		return a.mEntry.mPathHash != b.mEntry.mPathHash ? a.mEntry.mPathHash < b.mEntry.mPathHash : a.mPath < b.mPath;
+	});
+
+	// Lay everything out first, then write it front to back
+	std::string names;
+	std::vector<AssetArchive::Entry> entries;
+	uint64_t offset = AlignUp(sizeof(AssetArchive::Header));
+	for (size_t i = 0; i < mFiles.size(); i++)
+	{
+		File& file = mFiles[i];
+		if (i > 0 && file.mPath == mFiles[i - 1].mPath)
+		{
+			outError = "duplicate path " + file.mPath;
+			return false;
+		}
+		file.mEntry.mOffset = offset;
+		file.mEntry.mNameOffset = static_cast<uint32_t>(names.size());
+		file.mEntry.mNameLength = static_cast<uint16_t>(file.mPath.size());
+		names += file.mPath;
+		entries.emplace_back(file.mEntry);
+		offset = AlignUp(offset + file.mData.size());
+	}
+
+	AssetArchive::Header header;
+	memcpy(header.mMagic, ArchiveMagic, sizeof(ArchiveMagic));
+	header.mVersion = AssetArchive::Version;
+	header.mNumEntries = static_cast<uint32_t>(entries.size());
+	header.mNamesSize = static_cast<uint32_t>(names.size());
+	header.mTocOffset = offset;
+
+	std::ofstream out(fileName, std::ios::binary);
+	if (!out.is_open())
+	{
+		outError = "can't create file";
+		return false;
+	}
+	const char zeros[DataAlignment] = {};
+	uint64_t written = 0;
+	auto write = [&out, &written, &zeros](const void* data, size_t size, uint64_t padTo)
+	{
+		out.write(static_cast<const char*>(data), size);
+		written += size;
+		out.write(zeros, padTo - written);
+		written = padTo;
+	};
+	write(&header, sizeof(header), AlignUp(sizeof(header)));
+	for (const File& file : mFiles)
+	{
+		write(file.mData.data(), file.mData.size(), AlignUp(written + file.mData.size()));
+	}
+	write(entries.data(), entries.size() * sizeof(AssetArchive::Entry), written + entries.size() * sizeof(AssetArchive::Entry));
+	write(names.data(), names.size(), written + names.size());
+	if (!out.good())
+	{
+		outError = "write failed";
+		return false;
+	}
+	return true;
+}
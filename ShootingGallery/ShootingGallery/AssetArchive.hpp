@@ -0,0 +1,137 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The bytes of one file: a view straight into a mapped archive, or an owned copy
+// (loose files and compressed entries). Views stay valid while the archive is mounted.
+class FileData
+{
+public:
+	FileData():mData(nullptr), mSize(0) {}
+	FileData(FileData&& other) = default;
+	FileData& operator=(FileData&& other) = default;
+	FileData(const FileData&) = delete;
+	FileData& operator=(const FileData&) = delete;
+
+	const uint8_t* GetData() const { return mData; }
+	const char* GetChars() const { return reinterpret_cast<const char*>(mData); }
+	size_t GetSize() const { return mSize; }
+	bool IsView() const { return mData != nullptr && mOwned.empty(); }
+
+	void SetView(const uint8_t* data, size_t size);
+	// Makes room for an owned copy of size bytes and returns it to be filled
+	uint8_t* Allocate(size_t size);
+
+private:
+	const uint8_t* mData;
+	size_t mSize;
+	std::vector<uint8_t> mOwned;
+};
+
+// A pack file: a header, the entries' data (16 byte aligned) and a table of contents at the end.
+// The table is sorted by path hash and every entry has a hash of its contents, so lookups are a
+// binary search and a damaged pack is caught when the entry is read (raw entries are hashed on their
+// first read only). Entries are stored either raw (read in place, no copy) or LZ4 compressed when
+// that saves at least 10%.
+class AssetArchive
+{
+public:
+	enum Compression : uint8_t
+	{
+		ENone,
+		ELZ4
+	};
+
+	struct Header
+	{
+		char mMagic[4];
+		uint32_t mVersion;
+		uint32_t mNumEntries;
+		uint32_t mNamesSize;
+		uint64_t mTocOffset;
+	};
+
+	// Followed in the file by mNamesSize bytes of entry paths
+	struct Entry
+	{
+		uint64_t mPathHash;
+		uint64_t mContentHash;
+		uint64_t mOffset;
+		uint32_t mStoredSize;
+		uint32_t mSize;
+		uint32_t mNameOffset;
+		uint16_t mNameLength;
+		Compression mCompression;
+		uint8_t mPad;
+	};
+
+	static const uint32_t Version = 1;
+
+	AssetArchive();
+	~AssetArchive();
+
+	// Maps the whole file read-only. On failure outError says why.
+	bool Open(const std::string& fileName, std::string& outError);
+	void Close();
+
+	const Entry* Find(const std::string& path) const;
+	// Raw entries come back as views, compressed ones are decompressed into outData.
+	// Fails if the data doesn't match the entry's content hash. Safe to call from several threads.
+	bool Read(const Entry& entry, FileData& outData) const;
+	// Checks every entry against its content hash
+	bool Verify(std::string& outError) const;
+
+	size_t GetNumEntries() const { return mNumEntries; }
+	const Entry& GetEntry(size_t index) const { return mEntries[index]; }
+	std::string GetName(const Entry& entry) const;
+
+	// FNV-1a, also used for the content hashes
+	static uint64_t Hash(const void* data, size_t size);
+	// Paths are stored with forward slashes, relative to the game's working directory
+	static std::string NormalizePath(const std::string& path);
+
+private:
+	const uint8_t* mBase;
+	size_t mSize;
+	const Entry* mEntries;
+	size_t mNumEntries;
+	const char* mNames;
+	size_t mNamesSize;
+	// Per entry: raw data already matched its hash, so later reads are plain views
+	std::unique_ptr<std::atomic<bool>[]> mRawVerified;
+	// Platform handles of the mapping
+	void* mFile;
+	void* mMapping;
+};
+
+// Builds a pack from files in memory (used by the AssetPacker tool)
+class ArchiveWriter
+{
+public:
+	struct Stats
+	{
+		size_t mFiles = 0;
+		size_t mCompressedFiles = 0;
+		uint64_t mRawBytes = 0;
+		uint64_t mStoredBytes = 0;
+	};
+
+	void AddFile(const std::string& path, std::vector<uint8_t> data, bool compress);
+	bool Write(const std::string& fileName, std::string& outError);
+	const Stats& GetStats() const { return mStats; }
+
+private:
+	struct File
+	{
+		std::string mPath;
+		std::vector<uint8_t> mData;
+		AssetArchive::Entry mEntry;
+	};
+
+	std::vector<File> mFiles;
+	Stats mStats;
+};
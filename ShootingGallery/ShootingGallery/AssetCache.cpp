@@ -0,0 +1,31 @@
+#include "AssetCache.hpp"
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+	// Shared by every game in the process (MatchServer runs several on worker threads)
+	std::mutex sNamesMutex;
+	std::unordered_map<std::string, AssetID> sIDs;
+	std::vector<std::string> sPaths;
+}
+
+AssetID AssetNames::Intern(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(sNamesMutex);
+	auto iter = sIDs.find(path);
+	if (iter != sIDs.end())
+	{
+		return iter->second;
+	}
+	AssetID id = static_cast<AssetID>(sPaths.size());
+	sPaths.emplace_back(path);
+	sIDs.emplace(path, id);
+	return id;
+}
+
+std::string AssetNames::GetPath(AssetID id)
+{
+	std::lock_guard<std::mutex> lock(sNamesMutex);
+	return id < sPaths.size() ? sPaths[id] : std::string();
+}
@@ -0,0 +1,326 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Asset paths are interned once into small integer ids shared by every cache,
+// so after the first lookup an asset is found by index instead of hashing its path
+typedef uint32_t AssetID;
+
+namespace AssetNames
+{
+	// Thread safe, a path always gets the same id
+	AssetID Intern(const std::string& path);
+	std::string GetPath(AssetID id);
+}
+
+template <typename T>
+class AssetCache;
+
+// Counted reference to a cached asset. The asset stays loaded while a handle to it exists,
+// after the last one is gone it waits in the cache until the budget needs the memory.
+template <typename T>
+class AssetHandle
+{
+public:
+	AssetHandle():mCache(nullptr), mID(0), mAsset(nullptr) {}
+	AssetHandle(const AssetHandle& other):mCache(other.mCache), mID(other.mID), mAsset(other.mAsset) { AddRef(); }
+	AssetHandle(AssetHandle&& other):mCache(other.mCache), mID(other.mID), mAsset(other.mAsset)
+	{
+		other.mCache = nullptr;
+		other.mAsset = nullptr;
+	}
+	~AssetHandle() { Reset(); }
+	AssetHandle& operator=(AssetHandle other)
+	{
+		std::swap(mCache, other.mCache);
+		std::swap(mID, other.mID);
+		std::swap(mAsset, other.mAsset);
+		return *this;
+	}
+
+	void Reset()
+	{
+		if (mCache)
+		{
+			mCache->Release(mID);
+		}
+		mCache = nullptr;
+		mAsset = nullptr;
+	}
+	T* Get() const { return mAsset; }
+	T* operator->() const { return mAsset; }
+	explicit operator bool() const { return mAsset != nullptr; }
+	AssetID GetID() const { return mID; }
+
+private:
+	friend class AssetCache<T>;
+	AssetHandle(AssetCache<T>* cache, AssetID id, T* asset):mCache(cache), mID(id), mAsset(asset) { AddRef(); }
+	void AddRef()
+	{
+		if (mCache)
+		{
+			mCache->AddRef(mID);
+		}
+	}
+
+	AssetCache<T>* mCache;
+	AssetID mID;
+	T* mAsset;
+};
+
+// Loads assets of one type on first use and keeps them while they are referenced.
+// Unreferenced assets stay cached until their CPU or GPU bytes go over budget, then the least
+// recently used ones are unloaded. Referenced assets are never evicted and don't count against
+// the budget, so a scene that needs more than it still keeps everything it uses. T reports its size through GetCPUBytes/GetGPUBytes.
+// Not thread safe: each renderer owns its caches and uses them from one thread at a time.
+template <typename T>
+class AssetCache
+{
+public:
+	// The loader returns null on failure, the unloader frees an evicted asset
+	typedef std::function<T*(const std::string& path)> Loader;
+	typedef std::function<void(T*)> Unloader;
+
+	struct AssetStats
+	{
+		T* mAsset = nullptr;
+		int mRefs = 0;
+		size_t mCPUBytes = 0;
+		size_t mGPUBytes = 0;
+		uint64_t mHits = 0;
+		uint64_t mMisses = 0;
+		uint64_t mEvictions = 0;
+	};
+
+	struct Stats
+	{
+		size_t mLoaded = 0;
+		size_t mReferenced = 0;
+		size_t mCPUBytes = 0;
+		size_t mGPUBytes = 0;
+		// Part of the above in unreferenced assets, what the budget applies to
+		size_t mUnreferencedCPUBytes = 0;
+		size_t mUnreferencedGPUBytes = 0;
+		uint64_t mHits = 0;
+		uint64_t mMisses = 0;
+		uint64_t mEvictions = 0;
+	};
+
+	AssetCache(Loader loader, Unloader unloader):mLoader(loader), mUnloader(unloader), mEvictionDelay(0), mFrame(0), mLRUHead(None), mLRUTail(None)
+	{
+	}
+
+	// Frames an asset stays loaded after its last handle goes away, for draw data that still points at it
+	void SetEvictionDelay(uint32_t frames) { mEvictionDelay = frames; }
+
+	// Returns an empty handle if the asset failed to load
+	AssetHandle<T> Acquire(AssetID id)
+	{
+		if (id >= mEntries.size())
+		{
+			mEntries.resize(id + 1);
+		}
+		if (mEntries[id].mStats.mAsset)
+		{
+			mEntries[id].mStats.mHits++;
+			mStats.mHits++;
+		}
+		else
+		{
+			mEntries[id].mStats.mMisses++;
+			mStats.mMisses++;
+			T* asset = mLoader(AssetNames::GetPath(id));
+			if (asset == nullptr)
+			{
+				return AssetHandle<T>();
+			}
+			AssetStats& stats = mEntries[id].mStats;
+			stats.mAsset = asset;
+			stats.mCPUBytes = asset->GetCPUBytes();
+			stats.mGPUBytes = asset->GetGPUBytes();
+			mStats.mLoaded++;
+			mStats.mCPUBytes += stats.mCPUBytes;
+			mStats.mGPUBytes += stats.mGPUBytes;
+		}
+		return AssetHandle<T>(this, id, mEntries[id].mStats.mAsset);
+	}
+
+	// Call once per frame: evicts unreferenced assets, oldest first, until their bytes fit both budgets
+	void Trim(size_t cpuBudget, size_t gpuBudget)
+	{
+		mFrame++;
+		AssetID id = mLRUHead;
+		while (id != None && (mStats.mUnreferencedCPUBytes > cpuBudget || mStats.mUnreferencedGPUBytes > gpuBudget))
+		{
+			Entry& entry = mEntries[id];
+			// The list is in release order, so everything after this was released later
+			if (mFrame - entry.mReleasedFrame < mEvictionDelay)
+			{
+				break;
+			}
+			AssetID next = entry.mNext;
+			Evict(id);
+			id = next;
+		}
+	}
+
+	// Re-reads the size of an asset that grew or shrank while loaded (streamed texture mips)
+	void UpdateBytes(AssetID id)
+	{
+		Entry& entry = mEntries[id];
+		if (entry.mStats.mAsset == nullptr)
+		{
+			return;
+		}
+		size_t cpuBytes = entry.mStats.mAsset->GetCPUBytes();
+		size_t gpuBytes = entry.mStats.mAsset->GetGPUBytes();
+		mStats.mCPUBytes = mStats.mCPUBytes - entry.mStats.mCPUBytes + cpuBytes;
+		mStats.mGPUBytes = mStats.mGPUBytes - entry.mStats.mGPUBytes + gpuBytes;
+		if (entry.mInLRU)
+		{
+			mStats.mUnreferencedCPUBytes = mStats.mUnreferencedCPUBytes - entry.mStats.mCPUBytes + cpuBytes;
+			mStats.mUnreferencedGPUBytes = mStats.mUnreferencedGPUBytes - entry.mStats.mGPUBytes + gpuBytes;
+		}
+		entry.mStats.mCPUBytes = cpuBytes;
+		entry.mStats.mGPUBytes = gpuBytes;
+	}
+
+	// Unloads everything, referenced or not (shutdown)
+	void Clear()
+	{
+		for (size_t id = 0; id < mEntries.size(); id++)
+		{
+			if (mEntries[id].mStats.mAsset)
+			{
+				Evict(static_cast<AssetID>(id));
+			}
+		}
+	}
+
+	const Stats& GetStats() const { return mStats; }
+	// Ids are shared by all caches, so most of them are empty here
+	size_t GetNumIDs() const { return mEntries.size(); }
+	const AssetStats& GetAssetStats(AssetID id) const { return mEntries[id].mStats; }
+
+private:
+	friend class AssetHandle<T>;
+	static const AssetID None = 0xFFFFFFFF;
+
+	struct Entry
+	{
+		AssetStats mStats;
+		uint32_t mReleasedFrame = 0;
+		// Links in the list of unreferenced assets
+		AssetID mPrev = None;
+		AssetID mNext = None;
+		bool mInLRU = false;
+	};
+
+	void AddRef(AssetID id)
+	{
+		Entry& entry = mEntries[id];
+		if (entry.mStats.mRefs++ == 0)
+		{
+			mStats.mReferenced++;
+			if (entry.mInLRU)
+			{
+				Unlink(id);
+			}
+		}
+	}
+
+	void Release(AssetID id)
+	{
+		Entry& entry = mEntries[id];
+		if (--entry.mStats.mRefs == 0)
+		{
+			mStats.mReferenced--;
+			// Handles can outlive a Clear
+			if (entry.mStats.mAsset)
+			{
+				entry.mReleasedFrame = mFrame;
+				PushBack(id);
+			}
+		}
+	}
+
+	void Evict(AssetID id)
+	{
+		Entry& entry = mEntries[id];
+		if (entry.mInLRU)
+		{
+			Unlink(id);
+		}
+		T* asset = entry.mStats.mAsset;
+		mStats.mLoaded--;
+		mStats.mCPUBytes -= entry.mStats.mCPUBytes;
+		mStats.mGPUBytes -= entry.mStats.mGPUBytes;
+		mStats.mEvictions++;
+		entry.mStats.mEvictions++;
+		entry.mStats.mAsset = nullptr;
+		entry.mStats.mCPUBytes = 0;
+		entry.mStats.mGPUBytes = 0;
+		// May release handles into other caches (a mesh's textures)
+		mUnloader(asset);
+	}
+
+	void PushBack(AssetID id)
+	{
+		Entry& entry = mEntries[id];
+		entry.mPrev = mLRUTail;
+		entry.mNext = None;
+		mStats.mUnreferencedCPUBytes += entry.mStats.mCPUBytes;
+		mStats.mUnreferencedGPUBytes += entry.mStats.mGPUBytes;
+		if (mLRUTail != None)
+		{
+			mEntries[mLRUTail].mNext = id;
+		}
+		else
+		{
+			mLRUHead = id;
+		}
+		mLRUTail = id;
+		entry.mInLRU = true;
+	}
+
+	void Unlink(AssetID id)
+	{
+		Entry& entry = mEntries[id];
+		if (entry.mPrev != None)
+		{
+			mEntries[entry.mPrev].mNext = entry.mNext;
+		}
+		else
+		{
+			mLRUHead = entry.mNext;
+		}
+		if (entry.mNext != None)
+		{
+			mEntries[entry.mNext].mPrev = entry.mPrev;
+		}
+		else
+		{
+			mLRUTail = entry.mPrev;
+		}
+		entry.mPrev = None;
+		entry.mNext = None;
+		entry.mInLRU = false;
+		mStats.mUnreferencedCPUBytes -= entry.mStats.mCPUBytes;
+		mStats.mUnreferencedGPUBytes -= entry.mStats.mGPUBytes;
+	}
+
+	Loader mLoader;
+	Unloader mUnloader;
+	// Indexed by AssetID
+	std::vector<Entry> mEntries;
+	Stats mStats;
+	uint32_t mEvictionDelay;
+	uint32_t mFrame;
+	// Unreferenced loaded assets, least recently used first
+	AssetID mLRUHead;
+	AssetID mLRUTail;
+};
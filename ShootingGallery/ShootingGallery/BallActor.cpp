@@ -5,14 +5,17 @@
 #include "BallMove.hpp"
 #include "MeshComponent.hpp"
 
-BallActor::BallActor(Game* game):Actor(game), mLifeSpan(2.0f)
+BallActor::BallActor(Game* game):Actor(game, EBall), mLifeSpan(2.0f)
 {
 	//SetScale(10.0f);
 	MeshComponent* mc = new MeshComponent(this);
-	Mesh* mesh = GetGame()->GetRenderer()->GetMesh("Assets/Sphere.gpmesh");
+	// Balls are spawned all the time, look the mesh up by id instead of by path
+	static const AssetID sphere = AssetNames::Intern("Assets/Sphere.gpmesh");
+	AssetHandle<Mesh> mesh = GetGame()->GetRenderer()->GetMesh(sphere);
 	mc->SetMesh(mesh);
 	mMyMove = new BallMove(this);
 	mMyMove->SetForwardSpeed(1500.0f);
+	mMyMove->SetContactRadius(mesh->GetRadius());
 }
 
 void BallActor::UpdateActor(float deltaTime)
@@ -31,6 +34,11 @@ void BallActor::SetPlayer(Actor* player)
 	mMyMove->SetPlayer(player);
 }
 
+void BallActor::SetRewindTicks(int ticks)
+{
+	mMyMove->SetRewindTicks(ticks);
+}
+
 void BallActor::HitTarget()
 {
 
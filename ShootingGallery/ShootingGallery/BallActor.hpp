@@ -8,6 +8,9 @@ public:
 
 	void UpdateActor(float deltaTime) override;
 	void SetPlayer(Actor* player);
+	void SetRewindTicks(int ticks);
+	void SetLifeSpan(float lifeSpan) { mLifeSpan = lifeSpan; }
+	float GetLifeSpan() const { return mLifeSpan; }
 	void HitTarget();
 
 private:
@@ -2,41 +2,69 @@
 #include "Actor.hpp"
 #include "Game.hpp"
 #include "PhysWorld.hpp"
-#include "BallActor.hpp"
-#include "TargetActor.hpp"
 
-BallMove::BallMove(Actor* owner):MoveComponent(owner)
+BallMove::BallMove(Actor* owner):MoveComponent(owner), mPlayer(nullptr), mContactRadius(0.0f), mRewindTicks(0)
 {
 }
 
+// Sweeps the ball along its whole displacement for this tick, so it can't tunnel
+// through thin boxes no matter how fast it moves or how long the tick is.
+// On a hit the ball stops at the surface, reflects, and continues with the remaining distance.
 void BallMove::Update(float deltaTime)
 {
-	// Construct segment in direction of travel
-	const float segmentLength = 30.0f;
-	Vector3 start = mOwner->GetPosition();
-	Vector3 dir = mOwner->GetForward();
-	Vector3 end = start + dir * segmentLength;
-
-	// Create line segment
-	LineSegment l(start, end);
+	// Caps the work for a ball wedged in a corner
+	const int maxBounces = 4;
 
-	// Test segment vs world
 	PhysWorld* phys = mOwner->GetGame()->GetPhysWorld();
-	PhysWorld::CollisionInfo info;
-	// (Don't collide vs player)
-	if (phys->SegmentCast(l, info) && info.mActor != mPlayer)
+	Vector3 pos = mOwner->GetPosition();
+	Vector3 dir = mOwner->GetForward();
+	float remaining = mForwardSpeed * deltaTime;
+	bool bounced = false;
+	uint32_t tick = phys->GetNewestTick();
+	tick -= Math::Min(tick, static_cast<uint32_t>(Math::Max(mRewindTicks, 0)));
+
+	for (int bounce = 0; bounce <= maxBounces && remaining > 0.0f; bounce++)
 	{
+		// Cast a bit further than we move, so the ball bounces when its surface touches
+		Vector3 end = pos + dir * (remaining + mContactRadius);
+		LineSegment l(pos, end);
+
+		// (Don't collide vs player)
+		PhysWorld::CollisionInfo info;
+		bool hit = mRewindTicks > 0 ? phys->SegmentCastAtTick(l, tick, info, mPlayer) : phys->SegmentCast(l, info, mPlayer);
+		if (!hit)
+		{
+			pos += dir * remaining;
+			remaining = 0.0f;
+			break;
+		}
+
+		float travel = Math::Max(0.0f, (info.mPoint - pos).Length() - mContactRadius);
+		travel = Math::Min(travel, remaining);
+		pos += dir * travel;
+		remaining -= travel;
+
+		// Flat boxes report the same hit for both faces, use the one facing the ball
+		Vector3 normal = info.mNormal;
+		if (Vector3::Dot(dir, normal) > 0.0f)
+		{
+			normal = -1.0f * normal;
+		}
 		// If we collided, reflect the ball about the normal
-		dir = Vector3::Reflect(dir, info.mNormal);
-		mOwner->RotateToNewForward(dir);
-		// Did we hit a target?
-		TargetActor* target = dynamic_cast<TargetActor*>(info.mActor);
-		if (target)
+		dir = Vector3::Reflect(dir, normal);
+		bounced = true;
+
+		// Did we hit a target? The game reacts to it once physics is done
+		if (info.mActor->GetType() == Actor::ETarget)
 		{
-			static_cast<BallActor*>(mOwner)->HitTarget();
+			PhysWorld::HitEvent event = { mOwner, info.mActor, info.mPoint, normal, static_cast<uint32_t>(mOwner->GetGame()->GetFrameCount()) };
+			phys->PushHit(event);
 		}
 	}
 
-	// Base class update moves based on forward speed
-	MoveComponent::Update(deltaTime);
-}
\ No newline at end of file
+	mOwner->SetPosition(pos);
+	if (bounced)
+	{
+		mOwner->RotateToNewForward(dir);
+	}
+}
@@ -3,11 +3,18 @@
 
 class BallMove : public MoveComponent
 {
+	POOLED_COMPONENT(BallMove)
 public:
 	BallMove(class Actor* owner);
 	void SetPlayer(Actor* player) { mPlayer = player; }
+	// Distance from the ball's center at which it bounces off a surface
+	void SetContactRadius(float radius) { mContactRadius = radius; }
+	// Collide with the world as it was this many ticks ago (what the shooter saw)
+	void SetRewindTicks(int ticks) { mRewindTicks = ticks; }
 	void Update(float deltaTime) override;
 
 protected:
 	class Actor* mPlayer;
-};
\ No newline at end of file
+	float mContactRadius;
+	int mRewindTicks;
+};
@@ -0,0 +1,240 @@
+#include "Benchmark.hpp"
+#include "Game.hpp"
+#include "Renderer.hpp"
+#include "Actor.hpp"
+#include "PlaneActor.hpp"
+#include "TargetActor.hpp"
+#include "BallActor.hpp"
+#include "FPSActor.hpp"
+#include <algorithm>
+#include <fstream>
+#include <random>
+
+namespace
+{
+	struct Percentiles
+	{
+		double mMean;
+		double mP50;
+		double mP90;
+		double mP99;
+		double mMax;
+	};
+
+	Percentiles ComputePercentiles(std::vector<double> values)
+	{
+		Percentiles p = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+		if (values.empty())
+		{
+			return p;
+		}
+
+		std::sort(values.begin(), values.end());
+		auto at = [&values](double fraction)
+		{
+			size_t index = static_cast<size_t>(fraction * (values.size() - 1) + 0.5);
+			return values[index];
+		};
+
+		for (double v : values)
+		{
+			p.mMean += v;
+		}
+		p.mMean /= values.size();
+		p.mP50 = at(0.5);
+		p.mP90 = at(0.9);
+		p.mP99 = at(0.99);
+		p.mMax = values.back();
+		return p;
+	}
+
+	void WritePercentiles(std::ofstream& file, const char* name, const Percentiles& p, bool last = false)
+	{
+		file << "\t\t\"" << name << "\": { \"mean\": " << p.mMean << ", \"p50\": " << p.mP50 << ", \"p90\": " << p.mP90
+			<< ", \"p99\": " << p.mP99 << ", \"max\": " << p.mMax << " }" << (last ? "\n" : ",\n");
+	}
+}
+
+Benchmark::Benchmark(const Settings& settings):mSettings(settings), mWallPlanes(0)
+{
+	// Extra lights wouldn't be shaded, and the results would report a scene that wasn't measured
+	if (mSettings.mLights > Renderer::MaxPointLights)
+	{
+		SDL_Log("Benchmark: %d point lights requested, only %d are shaded; using %d", mSettings.mLights, Renderer::MaxPointLights, Renderer::MaxPointLights);
+		mSettings.mLights = Renderer::MaxPointLights;
+	}
+}
+
+bool Benchmark::Run()
+{
+	Game game;
+	game.SetFixedTimestep(1.0f / 60.0f);
+	game.SetUncapped(true);
+	game.SetMaxFrames(mSettings.mWarmupFrames + mSettings.mFrames);
+	game.SetRecordFrameStats(true);
+	game.SetBakeStaticGeometry(mSettings.mBakeStatic);
+	game.SetSceneLoader([this](Game* g) { LoadScene(g); });
+
+	bool success = game.Initialize(mSettings.mHeadless);
+	if (success)
+	{
+		game.RunLoop();
+
+		const std::vector<FrameStats>& all = game.GetFrameStats();
+		size_t warmup = Math::Min(static_cast<size_t>(mSettings.mWarmupFrames), all.size());
+		std::vector<FrameStats> measured(all.begin() + warmup, all.end());
+		success = WriteResults(measured);
+	}
+	game.Shutdown();
+	return success;
+}
+
+void Benchmark::LoadScene(Game* game)
+{
+	std::mt19937 rng(mSettings.mSeed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	// Floor tiles are 250 units wide (Plane.gpmesh is 100 units across)
+	const float tileSize = 250.0f;
+	const float tileScale = tileSize / 100.0f;
+	const int side = Math::Max(1, static_cast<int>(Math::Sqrt(static_cast<float>(mSettings.mPlanes)) + 0.999f));
+	const float half = side * tileSize * 0.5f;
+
+	Actor* a = nullptr;
+	int placed = 0;
+	for (int i = 0; i < side && placed < mSettings.mPlanes; i++)
+	{
+		for (int j = 0; j < side && placed < mSettings.mPlanes; j++)
+		{
+			a = new PlaneActor(game);
+			a->SetScale(tileScale);
+			a->SetPosition(Vector3(-half + (i + 0.5f) * tileSize, -half + (j + 0.5f) * tileSize, -100.0f));
+			placed++;
+		}
+	}
+
+	// Two tile high walls keep the balls bouncing inside the grid
+	Quaternion q(Vector3::UnitX, Math::PiOver2);
+	Quaternion q2 = Quaternion::Concatenate(q, Quaternion(Vector3::UnitZ, Math::PiOver2));
+	mWallPlanes = 0;
+	for (int i = 0; i < side; i++)
+	{
+		float along = -half + (i + 0.5f) * tileSize;
+		for (int k = 0; k < 2; k++)
+		{
+			float height = -100.0f + (k + 0.5f) * tileSize;
+			const Vector3 positions[4] = {
+				Vector3(along, -half, height), Vector3(along, half, height),
+				Vector3(-half, along, height), Vector3(half, along, height)
+			};
+			for (int w = 0; w < 4; w++)
+			{
+				a = new PlaneActor(game);
+				a->SetScale(tileScale);
+				a->SetPosition(positions[w]);
+				a->SetRotation(w < 2 ? q : q2);
+				mWallPlanes++;
+			}
+		}
+	}
+
+	auto randomInArena = [&](float minZ, float maxZ)
+	{
+		return Vector3((unit(rng) * 2.0f - 1.0f) * half * 0.9f, (unit(rng) * 2.0f - 1.0f) * half * 0.9f, minZ + unit(rng) * (maxZ - minZ));
+	};
+
+	for (int i = 0; i < mSettings.mTargets; i++)
+	{
+		a = new TargetActor(game);
+		a->SetRotation(Quaternion(Vector3::UnitZ, unit(rng) * Math::TwoPi));
+		a->SetPosition(randomInArena(100.0f, 300.0f));
+	}
+
+	for (int i = 0; i < mSettings.mBalls; i++)
+	{
+		BallActor* ball = new BallActor(game);
+		ball->SetLifeSpan(1.0e9f);
+		ball->SetPosition(randomInArena(0.0f, 300.0f));
+		Vector3 dir(unit(rng) * 2.0f - 1.0f, unit(rng) * 2.0f - 1.0f, unit(rng) * 2.0f - 1.0f);
+		if (Math::NearZero(dir.LengthSq()))
+		{
+			dir = Vector3::UnitX;
+		}
+		dir.Normalize();
+		ball->RotateToNewForward(dir);
+	}
+
+	Renderer* renderer = game->GetRenderer();
+	renderer->SetAmbientLight(Vector3(0.2f, 0.2f, 0.2f));
+	DirectionalLight& dir = renderer->GetDirectionalLight();
+	dir.mDirection = Vector3(0.0f, -0.707f, -0.707f);
+	dir.mDiffuseColor = Vector3(0.78f, 0.88f, 1.0f);
+	dir.mSpecColor = Vector3(0.8f, 0.8f, 0.8f);
+	for (int i = 0; i < mSettings.mLights; i++)
+	{
+		PointLight light;
+		light.Position = randomInArena(50.0f, 200.0f);
+		light.DiffuseColor = Vector3(unit(rng), unit(rng), unit(rng));
+		light.SpecularColor = light.DiffuseColor;
+		light.TurnOn = 1;
+		renderer->AddPointLight(light);
+	}
+
+	// The player provides the camera and the FixCollisions load
+	new FPSActor(game);
+}
+
+bool Benchmark::WriteResults(const std::vector<FrameStats>& stats)
+{
+	std::vector<double> input, update, collision, draw, allocations;
+	uint64_t droppedHits = 0;
+	for (const FrameStats& s : stats)
+	{
+		droppedHits += s.mDroppedHits;
+		input.emplace_back(s.mInputMs);
+		update.emplace_back(s.mUpdateMs);
+		collision.emplace_back(s.mCollisionMs);
+		draw.emplace_back(s.mDrawMs);
+		allocations.emplace_back(static_cast<double>(s.mAllocations));
+	}
+
+	Percentiles updateP = ComputePercentiles(update);
+	Percentiles collisionP = ComputePercentiles(collision);
+	Percentiles drawP = ComputePercentiles(draw);
+	SDL_Log("Benchmark: %d frames, update p50 %.3f ms p99 %.3f ms, collision p50 %.3f ms",
+		static_cast<int>(stats.size()), updateP.mP50, updateP.mP99, collisionP.mP50);
+	// The null renderer does no drawing work, so headless runs have no draw time to report
+	if (!mSettings.mHeadless)
+	{
+		SDL_Log("Benchmark: draw p50 %.3f ms p99 %.3f ms", drawP.mP50, drawP.mP99);
+	}
+
+	std::ofstream file(mSettings.mOutputFile);
+	if (!file.is_open())
+	{
+		SDL_Log("Failed to write benchmark results to %s", mSettings.mOutputFile.c_str());
+		return false;
+	}
+
+	file << "{\n";
+	file << "\t\"scene\": { \"planes\": " << mSettings.mPlanes << ", \"wallPlanes\": " << mWallPlanes
+		<< ", \"targets\": " << mSettings.mTargets << ", \"balls\": " << mSettings.mBalls
+		<< ", \"lights\": " << mSettings.mLights << ", \"frames\": " << stats.size()
+		<< ", \"headless\": " << (mSettings.mHeadless ? "true" : "false")
+		<< ", \"bakeStatic\": " << (mSettings.mBakeStatic ? "true" : "false") << " },\n";
+	file << "\t\"ms\": {\n";
+	WritePercentiles(file, "input", ComputePercentiles(input));
+	WritePercentiles(file, "update", updateP);
+	WritePercentiles(file, "collision", collisionP, mSettings.mHeadless);
+	if (!mSettings.mHeadless)
+	{
+		WritePercentiles(file, "draw", drawP, true);
+	}
+	file << "\t},\n";
+	file << "\t\"allocationsPerFrame\": {\n";
+	WritePercentiles(file, "all", ComputePercentiles(allocations), true);
+	file << "\t},\n";
+	file << "\t\"droppedHits\": " << droppedHits << "\n";
+	file << "}\n";
+	return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <string>
+#include <vector>
+
+struct FrameStats;
+
+// Runs a synthetic stress scene through the real Game/PhysWorld/Renderer code
+// and writes per-frame timing percentiles as JSON, so regressions can be tracked across commits.
+// It's a mode of the game executable (-benchmark) rather than its own target like KernelBenchmarks:
+// the numbers have to come from the binary that ships, with its build settings, pack and renderer
+// options (-mdi, -renderthread, ...), none of which a second project would be guaranteed to match.
+class Benchmark
+{
+public:
+	struct Settings
+	{
+		// Floor tiles in a square grid (walls around the grid are added on top)
+		int mPlanes = 400;
+		int mTargets = 20;
+		// Balls are kept alive for the whole run
+		int mBalls = 50;
+		int mLights = 8;
+		// Measured frames, after the warmup frames
+		int mFrames = 1000;
+		int mWarmupFrames = 30;
+		bool mHeadless = true;
+		bool mBakeStatic = true;
+		unsigned int mSeed = 1234;
+		std::string mOutputFile = "benchmark.json";
+	};
+
+	Benchmark(const Settings& settings);
+	bool Run();
+
+private:
+	void LoadScene(class Game* game);
+	bool WriteResults(const std::vector<FrameStats>& stats);
+
+	Settings mSettings;
+	int mWallPlanes;
+};
@@ -5,6 +5,7 @@
 
 class BoxComponent : public Component
 {
+	POOLED_COMPONENT(BoxComponent)
 public:
 	BoxComponent(class Actor* owner, int updateOrder = 100);
 	~BoxComponent();
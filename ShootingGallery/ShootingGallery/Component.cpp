@@ -1,16 +1,35 @@
 #include "Component.hpp"
 #include "Actor.hpp"
+#include "Game.hpp"
 
-Component::Component(Actor* owner, int updateOrder): mOwner(owner), mUpdateOrder(updateOrder)
+Component::Component(Actor* owner, int updateOrder): mOwner(owner), mUpdateOrder(updateOrder), mTicking(false), mTickState(ENotTicking), mOwnerActive(true)
 {
 	mOwner->AddComponent(this);
 }
 
 Component::~Component()
 {
+	SetTicking(false);
 	mOwner->RemoveComponent(this);
 }
 
+void Component::SetTicking(bool ticking)
+{
+	if (ticking == mTicking)
+	{
+		return;
+	}
+	mTicking = ticking;
+	if (ticking)
+	{
+		mOwner->GetGame()->AddTickingComponent(this);
+	}
+	else
+	{
+		mOwner->GetGame()->RemoveTickingComponent(this);
+	}
+}
+
 void Component::Update(float deltaTime)
 {
 }
\ No newline at end of file
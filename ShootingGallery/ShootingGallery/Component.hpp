@@ -1,5 +1,6 @@
 #pragma once
 #include <cstdint>
+#include "ComponentPool.hpp"
 
 class Component
 {
@@ -7,13 +8,45 @@ public:
 	// The lower the update order, the earlier the component updates.
 	Component(class Actor* owner, int updateOrder = 100);
 	virtual ~Component();
+	// Only called for components that enabled ticking
 	virtual void Update(float deltaTime);
 	virtual void ProcessInput(const uint8_t* keyState) {}
 	virtual void OnUpdateWorldTransform() { }
 
 	class Actor* GetOwner() { return mOwner; }
 	int GetUpdateOrder() const { return mUpdateOrder; }
+	bool IsTicking() const { return mTicking; }
+
+	// Where the game ticks the component from. Kept in the component, next to the other
+	// fields the update loop reads, so walking a pool never has to look anywhere else.
+	enum TickState : uint8_t
+	{
+		ENotTicking,
+		// Registered since the game's last update, starts ticking with the next one
+		ETickPending,
+		// In one of the game's tick lists
+		ETickListed,
+		// Ticked by walking its game's pool for its type
+		ETickPooled
+	};
+	TickState GetTickState() const { return mTickState; }
+	void SetTickState(TickState state) { mTickState = state; }
+	// Mirrors the owner's state, so ticking doesn't have to load the actor
+	bool IsOwnerActive() const { return mOwnerActive; }
+	void SetOwnerActive(bool active) { mOwnerActive = active; }
+
+	// Calls visit(component, context) for every instance in game's pool of one component type
+	typedef void (*PoolWalk)(const void* game, void (*visit)(Component*, void*), void* context);
+	// Set by POOLED_COMPONENT for instances of the pooled type in game's pool, null otherwise
+	virtual PoolWalk GetPoolWalk(const void* game) const { return nullptr; }
 protected:
+	// Components that override Update opt in from their constructor. They join the game's
+	// update list for their type and order; everything else costs nothing per frame.
+	void SetTicking(bool ticking);
+
 	class Actor* mOwner;
 	int mUpdateOrder;
+	bool mTicking;
+	TickState mTickState;
+	bool mOwnerActive;
 };
\ No newline at end of file
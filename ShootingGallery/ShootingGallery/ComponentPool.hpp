@@ -0,0 +1,262 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <typeinfo>
+#include <vector>
+
+// Which game new pooled components belong to on this thread, and cleanup of a game's pools.
+// A Game opens a Scope around everything that can create components (loading, ticking, input).
+class ComponentPools
+{
+public:
+	class Scope
+	{
+	public:
+		explicit Scope(const void* owner):mPrevious(Owner()) { Owner() = owner; }
+		~Scope() { Owner() = mPrevious; }
+	private:
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+		const void* mPrevious;
+	};
+
+	// Null outside of any scope; such components still work, they are just ticked from lists
+	static const void*& Owner()
+	{
+		static thread_local const void* owner = nullptr;
+		return owner;
+	}
+
+	// Frees the chunks of owner's pools on this thread, once its components are all deleted
+	static void Release(const void* owner)
+	{
+		for (const PoolType& type : Types())
+		{
+			type.mRelease(owner);
+		}
+	}
+
+	// Bytes of chunks owner's pools hold on this thread, live slots or not
+	static size_t GetCapacityBytes(const void* owner)
+	{
+		size_t bytes = 0;
+		for (const PoolType& type : Types())
+		{
+			bytes += type.mCapacityBytes(owner);
+		}
+		return bytes;
+	}
+
+	// Every component type with pools on this thread registers itself once
+	struct PoolType
+	{
+		void (*mRelease)(const void* owner);
+		size_t (*mCapacityBytes)(const void* owner);
+	};
+	static void AddType(const PoolType& type) { Types().emplace_back(type); }
+
+private:
+	static std::vector<PoolType>& Types()
+	{
+		static thread_local std::vector<PoolType> types;
+		return types;
+	}
+};
+
+// Chunked storage for the instances of one component type owned by one game.
+// Instances of a type sit next to each other in memory (allocated in address order while a chunk
+// fills up), so systems walking them with ForEach touch consecutive cache lines instead of
+// chasing pointers all over the heap, and only ever see their own game's components.
+// Freed slots are reused; chunks are kept until the game releases its pools.
+// Every thread has its own pools, so components have to be deleted on the thread that created them
+// (a game and its matches never move between threads).
+template <typename T>
+class ComponentPool
+{
+public:
+	static const size_t ChunkSize = 64;
+
+	// The pool for owner's components on this thread
+	static ComponentPool& Get(const void* owner)
+	{
+		std::vector<std::unique_ptr<ComponentPool>>& pools = Pools();
+		for (auto& pool : pools)
+		{
+			if (pool->mOwner == owner)
+			{
+				return *pool;
+			}
+		}
+		static thread_local bool registered = false;
+		if (!registered)
+		{
+			ComponentPools::AddType({ &Release, &CapacityBytes });
+			registered = true;
+		}
+		pools.emplace_back(new ComponentPool(owner));
+		return *pools.back();
+	}
+
+	static void* Allocate(size_t size)
+	{
+		// Derived types without their own pool are bigger than T and go to the heap
+		if (size != sizeof(T))
+		{
+			return ::operator new(size);
+		}
+		return Get(ComponentPools::Owner()).AllocateSlot();
+	}
+
+	static void Free(void* ptr, size_t size)
+	{
+		if (size != sizeof(T))
+		{
+			::operator delete(ptr);
+			return;
+		}
+		// The storage is the first member of its slot
+		Slot* slot = reinterpret_cast<Slot*>(ptr);
+		slot->mPool->FreeSlot(slot);
+	}
+
+	// Owner of the pool an instance of exactly T was allocated from
+	static const void* GetOwner(const T* ptr) { return reinterpret_cast<const Slot*>(ptr)->mPool->mOwner; }
+
+	// Calls func(T&) for every live instance, in memory order.
+	// func may create or delete instances; ones created during the walk may or may not be visited.
+	template <typename Func>
+	void ForEach(Func func)
+	{
+		// Indexed, since allocating can add a chunk (chunks themselves never move)
+		for (size_t i = 0; i < mChunks.size(); i++)
+		{
+			for (Slot& slot : mChunks[i]->mSlots)
+			{
+				if (slot.mLive)
+				{
+					func(*reinterpret_cast<T*>(slot.mStorage));
+				}
+			}
+		}
+	}
+
+	// Whether ptr is a slot of this pool (derived types allocated on the heap are not)
+	bool Contains(const void* ptr) const
+	{
+		for (auto& chunk : mChunks)
+		{
+			const Slot* slots = chunk->mSlots;
+			if (ptr >= slots && ptr < slots + ChunkSize)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	size_t GetCount() const { return mCount; }
+	size_t GetCapacity() const { return mChunks.size() * ChunkSize; }
+
+private:
+	explicit ComponentPool(const void* owner):mOwner(owner), mCount(0) {}
+	ComponentPool(const ComponentPool&) = delete;
+	ComponentPool& operator=(const ComponentPool&) = delete;
+
+	struct Slot
+	{
+		alignas(T) unsigned char mStorage[sizeof(T)];
+		ComponentPool* mPool;
+		bool mLive;
+	};
+	struct Chunk
+	{
+		Slot mSlots[ChunkSize];
+	};
+
+	static std::vector<std::unique_ptr<ComponentPool>>& Pools()
+	{
+		static thread_local std::vector<std::unique_ptr<ComponentPool>> pools;
+		return pools;
+	}
+
+	static size_t CapacityBytes(const void* owner)
+	{
+		for (auto& pool : Pools())
+		{
+			if (pool->mOwner == owner)
+			{
+				return pool->mChunks.size() * sizeof(Chunk);
+			}
+		}
+		return 0;
+	}
+
+	static void Release(const void* owner)
+	{
+		std::vector<std::unique_ptr<ComponentPool>>& pools = Pools();
+		for (auto iter = pools.begin(); iter != pools.end(); ++iter)
+		{
+			if ((*iter)->mOwner == owner && (*iter)->mCount == 0)
+			{
+				pools.erase(iter);
+				return;
+			}
+		}
+	}
+
+	void* AllocateSlot()
+	{
+		if (mFree.empty())
+		{
+			AddChunk();
+		}
+		Slot* slot = mFree.back();
+		mFree.pop_back();
+		slot->mLive = true;
+		mCount++;
+		return slot->mStorage;
+	}
+
+	void FreeSlot(Slot* slot)
+	{
+		slot->mLive = false;
+		mFree.emplace_back(slot);
+		mCount--;
+	}
+
+	void AddChunk()
+	{
+		mChunks.emplace_back(new Chunk());
+		Chunk* chunk = mChunks.back().get();
+		// Pushed in reverse so the chunk hands out slots front to back
+		for (size_t i = ChunkSize; i > 0; i--)
+		{
+			chunk->mSlots[i - 1].mPool = this;
+			chunk->mSlots[i - 1].mLive = false;
+			mFree.emplace_back(&chunk->mSlots[i - 1]);
+		}
+	}
+
+	const void* mOwner;
+	std::vector<std::unique_ptr<Chunk>> mChunks;
+	std::vector<Slot*> mFree;
+	size_t mCount;
+};
+
+// Put at the top of a component class to allocate its instances from ComponentPool<Type>.
+// `new Type(owner)` and `delete component` keep working as before. The game ticks the exact Type
+// instances in its own pool by walking it; anything else ticks from a list instead.
+#define POOLED_COMPONENT(Type) \
+public: \
+	static void* operator new(size_t size) { return ComponentPool<Type>::Allocate(size); } \
+	static void operator delete(void* ptr, size_t size) { ComponentPool<Type>::Free(ptr, size); } \
+	Component::PoolWalk GetPoolWalk(const void* game) const override \
+	{ \
+		return typeid(*this) == typeid(Type) && ComponentPool<Type>::GetOwner(this) == game ? &WalkPool : nullptr; \
+	} \
+	static void WalkPool(const void* game, void (*visit)(Component*, void*), void* context) \
+	{ \
+		ComponentPool<Type>::Get(game).ForEach([=](Type& comp) { visit(&comp, context); }); \
+	} \
+private:
@@ -8,8 +8,11 @@
 #include "BoxComponent.hpp"
 #include "PlaneActor.hpp"
 #include "FPSCamera.hpp"
+#include "InputSystem.hpp"
+#include "Profiler.hpp"
+#include "PhysWorld.hpp"
 
-FPSActor::FPSActor(Game* game):Actor(game)
+FPSActor::FPSActor(Game* game):Actor(game, EPlayer)
 {
 	mMoveComp = new MoveComponent(this);
 	mCameraComp = new FPSCamera(this);
@@ -136,8 +139,9 @@ void FPSActor::ActorInput(const uint8_t* keys)
 	mMoveComp->SetStrafeSpeed(strafeSpeed);
 
 	// Mouse movement
-	int x, y;
-	SDL_GetRelativeMouseState(&x, &y);
+	InputSystem* input = GetGame()->GetInput();
+	int x = input->GetRelativeMouseX();
+	int y = input->GetRelativeMouseY();
 	const int maxMouseSpeed = 500;
 	const float maxAngularSpeed = Math::Pi * 8;
 	float angularSpeed = 0.0f;
@@ -173,6 +177,7 @@ void FPSActor::Shoot()
 	// Spawn a ball.
 	BallActor* ball = new BallActor(GetGame());
 	ball->SetPlayer(this);
+	ball->SetRewindTicks(GetGame()->GetLagCompensation());
 	ball->SetPosition(start + dir*20.0f);
 	// Rotate the ball to face new direction.
 	ball->RotateToNewForward(dir);
@@ -185,6 +190,8 @@ void FPSActor::SetVisible(bool visible)
 
 void FPSActor::FixCollisions()
 {
+	PROFILE_SCOPE("FPSActor::FixCollisions");
+	PhysWorld::CollisionTimer timer(GetGame()->GetPhysWorld());
 	// Need to recompute my world transform to update world box.
 	ComputeWorldTransform();
 
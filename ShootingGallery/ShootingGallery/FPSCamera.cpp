@@ -3,7 +3,7 @@
 
 FPSCamera::FPSCamera(Actor* owner):CameraComponent(owner), mPitchSpeed(0.0f), mMaxPitch(Math::Pi / 3.0f), mPitch(0.0f)
 {
-
+	SetTicking(true);
 }
 
 void FPSCamera::Update(float deltaTime)
@@ -3,6 +3,7 @@
 
 class FPSCamera : public CameraComponent
 {
+	POOLED_COMPONENT(FPSCamera)
 public:
 	FPSCamera(class Actor* owner);
 
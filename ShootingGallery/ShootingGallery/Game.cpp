@@ -1,7 +1,11 @@
 #include "Game.hpp"
 #include <algorithm>
 #include "Renderer.hpp"
+#include "NullRenderer.hpp"
 #include "PhysWorld.hpp"
+#include "InputSystem.hpp"
+#include "Profiler.hpp"
+#include "MemoryStats.hpp"
 #include "Actor.hpp"
 #include "SpriteComponent.hpp"
 #include "MeshComponent.hpp"
@@ -9,22 +13,41 @@
 #include "PlaneActor.hpp"
 #include "TargetActor.hpp"
 #include "BallActor.hpp"
+#include "Level.hpp"
+#include "Component.hpp"
 #include<iostream>
 
-Game::Game() :mRenderer(nullptr), mPhysWorld(nullptr), mIsRunning(true), mUpdatingActors(false)
+Game::Game() :mTickListsDirty(false), mRenderer(nullptr), mPhysWorld(nullptr), mInput(new InputSystem()), mIsRunning(true), mUpdatingActors(false), mHeadless(false), mHosted(false), mFixedDeltaTime(0.0f), mUncapped(false), mMaxFrames(0), mFrameCount(0), mNextActorID(1), mRecordFrameStats(false), mBakeStaticGeometry(true), mMultiDrawIndirect(false), mCompactVertices(false), mOptimizeMeshes(true), mShaderCache(true), mRenderThread(false), mAssetCPUBudget(64 * 1024 * 1024), mAssetGPUBudget(256 * 1024 * 1024), mTextureStreaming(true), mVRAMBudget(128 * 1024 * 1024), mLagCompensation(0), mLevelFile("Assets/Gallery.gplevel"), mReportedDroppedHits(0), mFPSActor(nullptr)
 {
 
 }
 
-bool Game::Initialize()
+bool Game::Initialize(bool headless)
 {
-	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) != 0)
+	ComponentPools::Scope pools(this);
+	mHeadless = headless || mHosted;
+	Uint32 sdlFlags = mHeadless ? (SDL_INIT_TIMER | SDL_INIT_EVENTS) : (SDL_INIT_VIDEO | SDL_INIT_AUDIO);
+	if (!mHosted && SDL_Init(sdlFlags) != 0)
 	{
 		SDL_Log("Unable to initialize SDL: %s", SDL_GetError());
 		return false;
 	}
 
-	mRenderer = new Renderer(this);
+	if (mHeadless)
+	{
+		mRenderer = new NullRenderer(this);
+	}
+	else
+	{
+		mRenderer = new Renderer(this);
+		mRenderer->SetMultiDrawIndirect(mMultiDrawIndirect);
+		mRenderer->SetCompactVertices(mCompactVertices);
+		mRenderer->SetShaderCache(mShaderCache);
+		mRenderer->SetTextureStreaming(mTextureStreaming);
+		mRenderer->SetVRAMBudget(mVRAMBudget);
+	}
+	mRenderer->SetOptimizeMeshes(mOptimizeMeshes);
+	mRenderer->SetAssetBudget(mAssetCPUBudget, mAssetGPUBudget);
 	if (!mRenderer->Initialize(1024.0f, 768.0f))
 	{
 		SDL_Log("Failed to initialize renderer");
@@ -36,7 +59,27 @@ bool Game::Initialize()
 	// Create the physics world
 	mPhysWorld = new PhysWorld(this);
 
-	LoadData();
+	if (mSceneLoader)
+	{
+		mSceneLoader(this);
+	}
+	else
+	{
+		if (!LoadData())
+		{
+			SDL_Log("Failed to load level %s", mLevelFile.c_str());
+			return false;
+		}
+	}
+	if (mBakeStaticGeometry)
+	{
+		BakeStaticGeometry();
+	}
+	mRenderer->PrewarmShaders();
+	if (mRenderThread && !mRenderer->StartRenderThread())
+	{
+		SDL_Log("Rendering on the main thread");
+	}
 
 	mTicksCount = SDL_GetTicks();
 
@@ -45,11 +88,61 @@ bool Game::Initialize()
 
 void Game::RunLoop()
 {
+	ComponentPools::Scope pools(this);
 	while (mIsRunning)
 	{
-		ProcessInput();
-		UpdateGame();
-		GenerateOutput();
+		{
+			PROFILE_SCOPE("Frame");
+			uint64_t allocations = MemoryStats::GetAllocationCount();
+			mCurrentStats = FrameStats();
+			mPhysWorld->ResetCollisionTime();
+
+			uint64_t start = Profiler::GetTime();
+			ProcessInput();
+			mCurrentStats.mInputMs = Profiler::ToMilliseconds(Profiler::GetTime() - start);
+
+			UpdateGame();
+
+			GenerateOutput();
+			mCurrentStats.mDrawMs = mRenderer->GetLastSubmitMs();
+
+			mCurrentStats.mCollisionMs = Profiler::ToMilliseconds(mPhysWorld->GetCollisionTime());
+			mCurrentStats.mAllocations = MemoryStats::GetAllocationCount() - allocations;
+			if (mRecordFrameStats)
+			{
+				mFrameStats.emplace_back(mCurrentStats);
+			}
+		}
+		Profiler::EndFrame();
+
+		mFrameCount++;
+		if (mMaxFrames > 0 && mFrameCount >= mMaxFrames)
+		{
+			mIsRunning = false;
+		}
+	}
+}
+
+void Game::Tick()
+{
+	PROFILE_SCOPE("Game::Tick");
+	ComponentPools::Scope pools(this);
+	UpdateGame();
+	GenerateOutput();
+
+	mFrameCount++;
+	if (mMaxFrames > 0 && mFrameCount >= mMaxFrames)
+	{
+		mIsRunning = false;
+	}
+}
+
+void Game::FirePlayerWeapon()
+{
+	ComponentPools::Scope pools(this);
+	if (mFPSActor)
+	{
+		mFPSActor->Shoot();
 	}
 }
 
@@ -64,32 +157,68 @@ void Game::RemovePlane(PlaneActor* plane)
 	mPlanes.erase(iter);
 }
 
-void Game::ProcessInput()
+bool Game::StartRecording(const std::string& fileName)
 {
-	SDL_Event event;
-	while (SDL_PollEvent(&event))
+	if (mFixedDeltaTime <= 0.0f)
 	{
-		switch (event.type)
+		mFixedDeltaTime = 1.0f / 60.0f;
+	}
+	return mInput->StartRecording(fileName, mFixedDeltaTime);
+}
+
+bool Game::StartReplay(const std::string& fileName)
+{
+	if (!mInput->StartReplay(fileName))
+	{
+		return false;
+	}
+	mFixedDeltaTime = mInput->GetReplayTimeStep();
+	return true;
+}
+
+uint32_t Game::ComputeStateHash() const
+{
+	// FNV-1a over the raw transform bits
+	uint32_t hash = 2166136261u;
+	auto hashBytes = [&hash](const void* data, size_t size)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; i++)
 		{
-		case SDL_QUIT:
-			mIsRunning = false;
-			break;
-			// This fires when a key's initially pressed
-		case SDL_KEYDOWN:
-			if (!event.key.repeat)
-			{
-				HandleKeyPress(event.key.keysym.sym);
-			}
-			break;
-		case SDL_MOUSEBUTTONDOWN:
-			HandleKeyPress(event.button.button);
-			break;
-		default:
-			break;
+			hash = (hash ^ bytes[i]) * 16777619u;
 		}
+	};
+
+	for (auto actor : mActors)
+	{
+		hashBytes(&actor->GetPosition(), sizeof(Vector3));
+		hashBytes(&actor->GetRotation(), sizeof(Quaternion));
+		float scale = actor->GetScale();
+		hashBytes(&scale, sizeof(float));
+	}
+	return hash;
+}
+
+void Game::ProcessInput()
+{
+	PROFILE_SCOPE("Game::ProcessInput");
+	// A replay that ran out of ticks ends the game
+	if (!mInput->Update() || mInput->GetQuitRequested())
+	{
+		mIsRunning = false;
+		return;
 	}
 
-	const Uint8* state = SDL_GetKeyboardState(NULL);
+	for (int key : mInput->GetKeyPresses())
+	{
+		HandleKeyPress(key);
+	}
+	if (mInput->WasButtonPressed(SDL_BUTTON_LEFT))
+	{
+		HandleKeyPress(SDL_BUTTON_LEFT);
+	}
+
+	const Uint8* state = mInput->GetKeyState();
 	if (state[SDL_SCANCODE_ESCAPE])
 	{
 		mIsRunning = false;
@@ -106,11 +235,29 @@ void Game::HandleKeyPress(int key)
 	switch (key)
 	{
 	case SDL_BUTTON_LEFT:
-	{
-		// Fire weapon
-		mFPSActor->Shoot();
+		FirePlayerWeapon();
+		break;
+	case SDLK_F1:
+		mRenderer->ToggleFrameGraph();
+		break;
+	case SDLK_F2:
+		mRenderer->ToggleOcclusionCulling();
+		break;
+	case SDLK_F3:
+		mRenderer->ToggleDepthPrepass();
+		break;
+	case SDLK_F4:
+		mRenderer->ToggleFrontToBack();
+		break;
+	case SDLK_F5:
+		mRenderer->ToggleOverdraw();
+		break;
+	case SDLK_F6:
+		mRenderer->LogAssetStats();
+		break;
+	case SDLK_F7:
+		mRenderer->LogStreamingStats();
 		break;
-	}
 	default:
 		break;
 	}
@@ -118,16 +265,28 @@ void Game::HandleKeyPress(int key)
 
 void Game::UpdateGame()
 {
-	while (!SDL_TICKS_PASSED(SDL_GetTicks(), mTicksCount + 16));
+	if (!mUncapped)
+	{
+		while (!SDL_TICKS_PASSED(SDL_GetTicks(), mTicksCount + 16));
+	}
 
-	float deltaTime = (SDL_GetTicks() - mTicksCount) / 1000.0f;
-	if (deltaTime > 0.05f)
+	PROFILE_SCOPE("Game::UpdateGame");
+	// Time spent waiting for the frame limit doesn't count as update time
+	uint64_t updateStart = Profiler::GetTime();
+	float deltaTime = mFixedDeltaTime;
+	if (mFixedDeltaTime <= 0.0f)
 	{
-		deltaTime = 0.05f;
+		deltaTime = (SDL_GetTicks() - mTicksCount) / 1000.0f;
+		if (deltaTime > 0.05f)
+		{
+			deltaTime = 0.05f;
+		}
 	}
 	mTicksCount = SDL_GetTicks();
 
 	mUpdatingActors = true;
+	UpdateComponents(deltaTime);
+	DispatchHits();
 	for (auto actor : mActors)
 	{
 		actor->Update(deltaTime);
@@ -154,215 +313,217 @@ void Game::UpdateGame()
 	{
 		delete actor;
 	}
-}
-
-void Game::GenerateOutput()
-{
-	mRenderer->Draw();
-}
 
-void AddColumn(class Game* game, int x, int y, class Actor * a, Quaternion& q, Quaternion& q2) {
-	for (int i = 0;i < 9;i++) {
-		a = new PlaneActor(game);
-		a->SetScale(2.0f);
-		a->SetPosition(Vector3(x, y, i * 50));
-		a->SetRotation(q2);
+	// Where every collider ended up this tick, for lag compensated hits
+	mPhysWorld->RecordHistory(static_cast<uint32_t>(mFrameCount));
 
-		a = new PlaneActor(game);
-		a->SetScale(2.0f);
-		a->SetPosition(Vector3(x - 200, y, i * 50));
-		a->SetRotation(q2);
+	mCurrentStats.mUpdateMs = Profiler::ToMilliseconds(Profiler::GetTime() - updateStart);
+}
 
-		a = new PlaneActor(game);
-		a->SetScale(2.0f);
-		a->SetPosition(Vector3(x - 100, y - 100, i * 50));
-		a->SetRotation(q);
+void Game::DispatchHits()
+{
+	PROFILE_SCOPE("Game::DispatchHits");
+	mPhysWorld->DispatchHits([](const PhysWorld::HitEvent& hit)
+	{
+		if (hit.mTarget->GetType() == Actor::ETarget)
+		{
+			static_cast<TargetActor*>(hit.mTarget)->OnHit();
+		}
+		if (hit.mBall->GetType() == Actor::EBall)
+		{
+			static_cast<BallActor*>(hit.mBall)->HitTarget();
+		}
+	});
 
-		a = new PlaneActor(game);
-		a->SetScale(2.0f);
-		a->SetPosition(Vector3(x - 100, y + 100, i * 50));
-		a->SetRotation(q);
+	uint64_t dropped = mPhysWorld->GetDroppedHits();
+	if (dropped != mReportedDroppedHits)
+	{
+		SDL_Log("Hit queue full, dropped %llu hits in tick %d", static_cast<unsigned long long>(dropped - mReportedDroppedHits), mFrameCount);
+		mCurrentStats.mDroppedHits += dropped - mReportedDroppedHits;
+		mReportedDroppedHits = dropped;
 	}
 }
 
-void Game::LoadData()
+void Game::UpdateComponents(float deltaTime)
 {
-	// Create actors
-	Actor* a = nullptr;
-	Quaternion q, q2,q3;
-
-	// Setup floor
-	const float start = -1250.0f;
-	const float size = 250.0f;
-	for (int i = 0; i < 10; i++)
+	PROFILE_SCOPE("Game::UpdateComponents");
+	FlushPendingTicks();
+	for (TickList& list : mTickLists)
 	{
-		for (int j = 0; j < 10; j++)
+		if (list.mPoolWalk)
 		{
-			a = new PlaneActor(this);
-			a->SetPosition(Vector3(start + i * size, start + j * size, -100.0f));
+			// The pool only holds this game's components; everything else needed is in the component
+			struct PoolTick
+			{
+				int mUpdateOrder;
+				float mDeltaTime;
+			} context = { list.mUpdateOrder, deltaTime };
+			list.mPoolWalk(this, [](Component* comp, void* data)
+			{
+				PoolTick* tick = static_cast<PoolTick*>(data);
+				if (comp->GetTickState() == Component::ETickPooled && comp->IsOwnerActive() && comp->GetUpdateOrder() == tick->mUpdateOrder)
+				{
+					comp->Update(tick->mDeltaTime);
+				}
+			}, &context);
+		}
+
+		// Components created meanwhile wait in mPendingTicks, so the lists don't grow here.
+		// Pooled types can have some here too, e.g. ones created outside the game's pool scope.
+		for (auto comp : list.mComponents)
+		{
+			if (comp && comp->IsOwnerActive())
+			{
+				comp->Update(deltaTime);
+			}
 		}
 	}
 
-	// Left/right walls
-	q = Quaternion(Vector3::UnitX, Math::PiOver2);
-	for (int i = 0; i < 10; i++)
+	if (mTickListsDirty)
 	{
-		a = new PlaneActor(this);
-		a->SetPosition(Vector3(start + i * size, start - size, 0.0f));
-		a->SetRotation(q);
-
-		a = new PlaneActor(this);
-		a->SetPosition(Vector3(start + i * size, -start + size, 0.0f));
-		a->SetRotation(q);
+		mTickListsDirty = false;
+		for (TickList& list : mTickLists)
+		{
+			list.mComponents.erase(std::remove(list.mComponents.begin(), list.mComponents.end(), nullptr), list.mComponents.end());
+		}
 	}
+}
 
-	q2 = Quaternion::Concatenate(q, Quaternion(Vector3::UnitZ, Math::PiOver2));
-
-	// Forward/back walls
-	for (int i = 0; i < 10; i++)
+void Game::FlushPendingTicks()
+{
+	for (auto comp : mPendingTicks)
 	{
-		a = new PlaneActor(this);
-		a->SetPosition(Vector3(start - size, start + i * size, 0.0f));
-		a->SetRotation(q2);
-		a = new PlaneActor(this);
-		a->SetPosition(Vector3(-start + size, start + i * size, 0.0f));
-		a->SetRotation(q2);
+		std::type_index type(typeid(*comp));
+		int order = comp->GetUpdateOrder();
+		auto iter = std::lower_bound(mTickLists.begin(), mTickLists.end(), std::make_pair(order, type),
+			[](const TickList& list, const std::pair<int, std::type_index>& key)
+		{
+			return list.mUpdateOrder < key.first || (list.mUpdateOrder == key.first && list.mType < key.second);
+		});
+		Component::PoolWalk walk = comp->GetPoolWalk(this);
+		if (iter == mTickLists.end() || iter->mUpdateOrder != order || iter->mType != type)
+		{
+			iter = mTickLists.insert(iter, TickList{ order, type, walk, {} });
+		}
+		if (walk)
+		{
+			iter->mPoolWalk = walk;
+			comp->SetTickState(Component::ETickPooled);
+		}
+		else
+		{
+			iter->mComponents.emplace_back(comp);
+			comp->SetTickState(Component::ETickListed);
+		}
 	}
+	mPendingTicks.clear();
+}
 
-	//prepreke
+void Game::AddTickingComponent(Component* component)
+{
+	mPendingTicks.emplace_back(component);
+	component->SetTickState(Component::ETickPending);
+}
 
-	//left wall
-	for (int i = 0;i < 17;i++) {
-		for (int j = 0;j < 9;j++) {
-			a = new PlaneActor(this);
-			a->SetScale(2.0f);
-			a->SetPosition(Vector3(0, start-size/2-50+i*50, j*50));
-			a->SetRotation(q2);
-		}
+void Game::RemoveTickingComponent(Component* component)
+{
+	Component::TickState state = component->GetTickState();
+	component->SetTickState(Component::ENotTicking);
+	if (state == Component::ETickPending)
+	{
+		mPendingTicks.erase(std::find(mPendingTicks.begin(), mPendingTicks.end(), component));
+		return;
+	}
+	// Pooled components are skipped by their state alone
+	if (state != Component::ETickListed)
+	{
+		return;
 	}
 
-	for (int i = 1;i < 18;i++) {
-		for (int j = 0;j < 9;j++) {
-			a = new PlaneActor(this);
-			a->SetScale(2.0f);
-			a->SetPosition(Vector3((i * 50)-size*2+50, start + 3 * size, j * 50));
-			a->SetRotation(q);
-
-			a = new PlaneActor(this);
-			a->SetScale(2.0f);
-			a->SetPosition(Vector3((i * 50)-size*2+50, start + 3 * size - 200, j * 50));
-			a->SetRotation(q);
+	// Called from ~Component, where typeid no longer gives the concrete type, so search by update order
+	for (TickList& list : mTickLists)
+	{
+		if (list.mUpdateOrder != component->GetUpdateOrder())
+		{
+			continue;
+		}
+		auto iter = std::find(list.mComponents.begin(), list.mComponents.end(), component);
+		if (iter == list.mComponents.end())
+		{
+			continue;
 		}
+		if (mUpdatingActors)
+		{
+			*iter = nullptr;
+			mTickListsDirty = true;
+		}
+		else
+		{
+			std::iter_swap(iter, list.mComponents.end() - 1);
+			list.mComponents.pop_back();
+		}
+		return;
 	}
+}
 
+void Game::GenerateOutput()
+{
+	mRenderer->UpdateAssets();
+	mRenderer->Draw();
+}
 
+bool Game::LoadData()
+{
+	Level level;
+	if (!level.Load(mLevelFile))
+	{
+		return false;
+	}
+	mFPSActor = level.Spawn(this);
 
-	for (int i = 0;i < 9;i++) {
-		a = new PlaneActor(this);
-		a->SetScale(2.0f);
-		a->SetPosition(Vector3(500, start + 3 * size - 100, i * 50));
-		a->SetRotation(q2);
+	// UI elements
+	Actor* a = new Actor(this);
+	a->SetScale(2.0f);
+	mCrosshair = new SpriteComponent(a);
+	mCrosshair->SetTexture(mRenderer->GetTexture("Assets/Crosshair.png"));
 
-		a = new PlaneActor(this);
-		a->SetScale(2.0f);
-		a->SetPosition(Vector3(-500, start + 3 * size - 100, i * 50));
-		a->SetRotation(q2);
+	if (!mHeadless)
+	{
+		// Enable relative mouse mode for camera look
+		SDL_SetRelativeMouseMode(SDL_TRUE);
+		// Make an initial call to get relative to clear out
+		SDL_GetRelativeMouseState(nullptr, nullptr);
 	}
+	return true;
+}
 
-	AddColumn(this, 500, 500, a, q, q2);
-	AddColumn(this, -1000, -1000, a, q, q2);
-	AddColumn(this, -800, 200, a, q, q2);
-	
-	//right wall
-
-	for (int i = 0;i < 10;i++) {
-		for (int j = 0;j < 9;j++) {
-			a = new PlaneActor(this);
-			a->SetScale(2.0f);
-			a->SetPosition(Vector3(-500, -start - size + i * 50, j * 50));
-			a->SetRotation(q2);
+void Game::ReserveActors(size_t actors, size_t planes)
+{
+	mActors.reserve(mActors.size() + actors);
+	mPlanes.reserve(mPlanes.size() + planes);
+	mRenderer->ReserveMeshComps(actors);
+	mPhysWorld->ReserveBoxes(actors);
+}
 
-			a = new PlaneActor(this);
-			a->SetScale(2.0f);
-			a->SetPosition(Vector3(-700, -start - size + i * 50, j * 50));
-			a->SetRotation(q2);
+void Game::BakeStaticGeometry()
+{
+	PROFILE_SCOPE("Game::BakeStaticGeometry");
+	// Planes never move, so their world transforms and boxes are final
+	for (auto plane : mPlanes)
+	{
+		auto iter = std::find(mActors.begin(), mActors.end(), plane);
+		if (iter == mActors.end())
+		{
+			continue;
 		}
+		plane->ComputeWorldTransform();
+		plane->SetStatic(true);
+		mActors.erase(iter);
+		mStaticActors.emplace_back(plane);
 	}
 
-	for (int i = 0;i < 9;i++) {
-		a = new PlaneActor(this);
-		a->SetScale(2.0f);
-		a->SetPosition(Vector3(-600, -start-2*size+150, i * 50));
-		a->SetRotation(q);
-	}
-	// Setup lights
-	mRenderer->SetAmbientLight(Vector3(0.2f, 0.2f, 0.2f));
-	DirectionalLight& dir = mRenderer->GetDirectionalLight();
-	dir.mDirection = Vector3(0.0f, -0.707f, -0.707f);
-	dir.mDiffuseColor = Vector3(0.78f, 0.88f, 1.0f);
-	dir.mSpecColor = Vector3(0.8f, 0.8f, 0.8f);
-	
-	auto yellowLight = PointLight();
-	yellowLight.Position = Vector3(0.0f, 0.0f, 100.0f);
-	yellowLight.DiffuseColor = Vector3(0.8f, 0.8f, 0.0f);
-	yellowLight.SpecularColor = Vector3(0.8f, 0.8f, 0.0f);
-	yellowLight.TurnOn = 0;
-	mRenderer->AddPointLight(yellowLight);
-
-	auto redLight = PointLight();
-	redLight.Position = Vector3(1000.0f, -1000.0f, 100.0f);
-	redLight.DiffuseColor = Vector3(1.0f, 0.4f, 0.4f);
-	redLight.SpecularColor = Vector3(0.8f, 0.3f, 0.3f);
-	redLight.TurnOn = 0;
-	mRenderer->AddPointLight(redLight);
-
-	auto greenLight = PointLight();
-	greenLight.Position = Vector3(1000.0f, 1000.0f, 100.0f);
-	greenLight.DiffuseColor = Vector3(0.4f, 1.0f, 0.4f);
-	greenLight.SpecularColor = Vector3(0.3f, 0.8f, 0.3f);
-	greenLight.TurnOn = 0;
-	mRenderer->AddPointLight(greenLight);
-
-	auto blueLight = PointLight();
-	blueLight.Position = Vector3(-1000.0f, 1000.0f, 100.0f);
-	blueLight.DiffuseColor = Vector3(0.4f, 0.4f, 1.0f);
-	blueLight.SpecularColor = Vector3(0.3f, 0.3f, 0.8f);
-	blueLight.TurnOn = 0;
-	mRenderer->AddPointLight(blueLight);
-
-	auto tealLight = PointLight();
-	tealLight.Position = Vector3(-800.0f, -1000.0f, 100.0f);
-	tealLight.DiffuseColor = Vector3(0.0f, 0.8f, 0.8f);
-	tealLight.SpecularColor = Vector3(0.0f, 0.8f, 0.8f);
-	tealLight.TurnOn = 0;
-	mRenderer->AddPointLight(tealLight);
-
-	// UI elements
-	a = new Actor(this);
-	a->SetScale(2.0f);
-	mCrosshair = new SpriteComponent(a);
-	mCrosshair->SetTexture(mRenderer->GetTexture("Assets/Crosshair.png"));
-
-	// Enable relative mouse mode for camera look
-	SDL_SetRelativeMouseMode(SDL_TRUE);
-	// Make an initial call to get relative to clear out
-	SDL_GetRelativeMouseState(nullptr, nullptr);
-
-	// Different camera actors
-	mFPSActor = new FPSActor(this);
-	q3 = Quaternion::Concatenate(q, Quaternion(Vector3::UnitZ, Math::TwoPi));
-	// Create target actors
-	a = new TargetActor(this);
-	a->SetPosition(Vector3(1450.0f, 0.0f, 200.0f));
-	a = new TargetActor(this);
-	a->SetRotation(q3);
-	a->SetPosition(Vector3(-950.0f, -1000.0f, 300.0f));
-	a = new TargetActor(this);
-	a->SetRotation(q3);
-	a->SetPosition(Vector3(-1450.0f, 500.0f, 200.0f));
-	a = new TargetActor(this);
-	a->SetRotation(q2);
-	a->SetPosition(Vector3(-100.0f, -450.0f, 200.0f));
+	mRenderer->BakeStaticGeometry();
+	mPhysWorld->SeparateStaticBoxes();
 }
 
 void Game::UnloadData()
@@ -371,6 +532,10 @@ void Game::UnloadData()
 	{
 		delete mActors.back();
 	}
+	while (!mStaticActors.empty())
+	{
+		delete mStaticActors.back();
+	}
 
 	if (mRenderer)
 	{
@@ -380,13 +545,27 @@ void Game::UnloadData()
 
 void Game::Shutdown()
 {
+	// Unloading deletes GL objects, so the context has to be back on this thread
+	if (mRenderer)
+	{
+		mRenderer->StopRenderThread();
+	}
+	mInput->Shutdown();
+	delete mInput;
+	mInput = nullptr;
 	UnloadData();
+	ComponentPools::Release(this);
 	delete mPhysWorld;
 	if (mRenderer)
 	{
 		mRenderer->Shutdown();
+		delete mRenderer;
+		mRenderer = nullptr;
+	}
+	if (!mHosted)
+	{
+		SDL_Quit();
 	}
-	SDL_Quit();
 }
 
 void Game::AddActor(Actor* actor)
@@ -416,4 +595,11 @@ void Game::RemoveActor(Actor* actor)
 		std::iter_swap(iter, mActors.end() - 1);
 		mActors.pop_back();
 	}
+
+	iter = std::find(mStaticActors.begin(), mStaticActors.end(), actor);
+	if (iter != mStaticActors.end())
+	{
+		std::iter_swap(iter, mStaticActors.end() - 1);
+		mStaticActors.pop_back();
+	}
 }
\ No newline at end of file
@@ -4,19 +4,99 @@
 #include <unordered_map>
 #include <string>
 #include <vector>
+#include <typeindex>
+#include <cstdint>
+#include <functional>
 #include "Math.hpp"
+#include "Component.hpp"
+
+// Per frame timings in milliseconds, plus allocations made during the frame
+struct FrameStats
+{
+	double mInputMs = 0.0;
+	double mUpdateMs = 0.0;
+	double mCollisionMs = 0.0;
+	double mDrawMs = 0.0;
+	uint64_t mAllocations = 0;
+	// Ball hits lost because the hit queue was full
+	uint64_t mDroppedHits = 0;
+};
 
 class Game
 {
 public:
 	Game();
-	bool Initialize();
+	// A headless game uses the null renderer and needs no window or GPU
+	bool Initialize(bool headless = false);
 	void RunLoop();
 	void Shutdown();
+	// Advances the simulation one tick without input (hosted matches are ticked by their server)
+	void Tick();
+	bool IsRunning() const { return mIsRunning; }
+
+	// Hosted games share the process with other matches: they are headless,
+	// never init or quit SDL and never poll input (set before Initialize)
+	void SetHosted(bool hosted) { mHosted = hosted; }
+	// Fires the player's weapon, like a left click (for bots)
+	void FirePlayerWeapon();
+
+	// With a fixed timestep every frame advances time by exactly deltaTime
+	void SetFixedTimestep(float deltaTime) { mFixedDeltaTime = deltaTime; }
+	// Uncapped frames don't wait for the 16ms frame limit
+	void SetUncapped(bool uncapped) { mUncapped = uncapped; }
+	// Stop the loop after this many frames (0 runs until quit)
+	void SetMaxFrames(int frames) { mMaxFrames = frames; }
+	int GetFrameCount() const { return mFrameCount; }
+	bool IsHeadless() const { return mHeadless; }
+
+	// Input recording/replay, both force a fixed timestep so reruns are bit-exact
+	bool StartRecording(const std::string& fileName);
+	bool StartReplay(const std::string& fileName);
+	class InputSystem* GetInput() { return mInput; }
+
+	// Hash of every actor's transform, identical replays produce identical hashes
+	uint32_t ComputeStateHash() const;
+
+	// Replaces the gallery level with a custom scene (set before Initialize)
+	void SetSceneLoader(std::function<void(Game*)> loader) { mSceneLoader = loader; }
+	// Keep the FrameStats of every frame (for benchmarks)
+	void SetRecordFrameStats(bool record) { mRecordFrameStats = record; }
+	const std::vector<FrameStats>& GetFrameStats() const { return mFrameStats; }
+	// Bake the planes into static chunks after loading (on by default)
+	void SetBakeStaticGeometry(bool bake) { mBakeStaticGeometry = bake; }
+	// Static meshes use the GL 4.3 multi-draw-indirect path when available (set before Initialize)
+	void SetMultiDrawIndirect(bool enable) { mMultiDrawIndirect = enable; }
+	// Meshes use the compact vertex format (set before Initialize)
+	void SetCompactVertices(bool compact) { mCompactVertices = compact; }
+	// Meshes are welded and reordered for the vertex cache on load (set before Initialize)
+	void SetOptimizeMeshes(bool optimize) { mOptimizeMeshes = optimize; }
+	// Linked shader programs are cached on disk between runs (set before Initialize)
+	void SetShaderCache(bool enable) { mShaderCache = enable; }
+	// Draw on a dedicated render thread, one frame behind the simulation (set before Initialize)
+	void SetRenderThread(bool enable) { mRenderThread = enable; }
+	// Memory that unreferenced meshes and textures may keep cached (set before Initialize)
+	void SetAssetBudget(size_t cpuBytes, size_t gpuBytes) { mAssetCPUBudget = cpuBytes; mAssetGPUBudget = gpuBytes; }
+	// Stream texture mips in as they're needed, keeping them under the VRAM budget (set before Initialize)
+	void SetTextureStreaming(bool enable) { mTextureStreaming = enable; }
+	void SetVRAMBudget(size_t bytes) { mVRAMBudget = bytes; }
+	// Shots test targets as they were this many ticks ago, like a server compensating a client's latency
+	void SetLagCompensation(int ticks) { mLagCompensation = ticks; }
+	int GetLagCompensation() const { return mLagCompensation; }
+	// Level loaded when there is no scene loader (set before Initialize)
+	void SetLevelFile(const std::string& fileName) { mLevelFile = fileName; }
 
 	void AddActor(class Actor* actor);
+	uint32_t GenerateActorID() { return mNextActorID++; }
+	// Active actors (not the baked static ones)
+	const std::vector<class Actor*>& GetActors() const { return mActors; }
+	// Reserve room for a batch of actors before spawning them
+	void ReserveActors(size_t actors, size_t planes);
 	void RemoveActor(class Actor* actor);
 
+	// Components that tick are updated per type, in update order, before the actors' own updates
+	void AddTickingComponent(class Component* component);
+	void RemoveTickingComponent(class Component* component);
+
 	class Renderer* GetRenderer() { return mRenderer; }
 	class PhysWorld* GetPhysWorld() { return mPhysWorld; }
 
@@ -28,18 +108,67 @@ private:
 	void HandleKeyPress(int key);
 	void UpdateGame();
 	void GenerateOutput();
-	void LoadData();
+	bool LoadData();
 	void UnloadData();
+	void BakeStaticGeometry();
+	void UpdateComponents(float deltaTime);
+	void FlushPendingTicks();
+	void DispatchHits();
 
 	std::vector<class Actor*> mActors;
+	// Baked actors, they keep their colliders but are never updated
+	std::vector<class Actor*> mStaticActors;
 	std::vector<class Actor*> mPendingActors;
 
+	// Every ticking component of one concrete type and update order.
+	// Pooled types are ticked by walking this game's pool, so mostly heap types fill mComponents.
+	struct TickList
+	{
+		int mUpdateOrder;
+		std::type_index mType;
+		Component::PoolWalk mPoolWalk;
+		std::vector<class Component*> mComponents;
+	};
+	// Sorted by update order, then type
+	std::vector<TickList> mTickLists;
+	// Registered since the last update; their dynamic type is only known once construction finished
+	std::vector<class Component*> mPendingTicks;
+	// Components removed while ticking leave a null slot, compacted after the update
+	bool mTickListsDirty;
+
 	class Renderer* mRenderer;
 	class PhysWorld* mPhysWorld;
+	class InputSystem* mInput;
 
 	Uint32 mTicksCount;
 	bool mIsRunning;
 	bool mUpdatingActors;
+	bool mHeadless;
+	bool mHosted;
+	float mFixedDeltaTime;
+	bool mUncapped;
+	int mMaxFrames;
+	int mFrameCount;
+	uint32_t mNextActorID;
+
+	std::function<void(Game*)> mSceneLoader;
+	bool mRecordFrameStats;
+	bool mBakeStaticGeometry;
+	bool mMultiDrawIndirect;
+	bool mCompactVertices;
+	bool mOptimizeMeshes;
+	bool mShaderCache;
+	bool mRenderThread;
+	size_t mAssetCPUBudget;
+	size_t mAssetGPUBudget;
+	bool mTextureStreaming;
+	size_t mVRAMBudget;
+	int mLagCompensation;
+	std::string mLevelFile;
+	std::vector<FrameStats> mFrameStats;
+	FrameStats mCurrentStats;
+	// PhysWorld's dropped hit count when it was last reported
+	uint64_t mReportedDroppedHits;
 
 	std::vector<class PlaneActor*> mPlanes;
 	class FPSActor* mFPSActor;
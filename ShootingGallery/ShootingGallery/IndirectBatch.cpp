@@ -0,0 +1,232 @@
+#include "IndirectBatch.hpp"
+#include "MeshComponent.hpp"
+#include "Mesh.hpp"
+#include "Actor.hpp"
+#include "Shader.hpp"
+#include "Texture.hpp"
+#include "OcclusionCuller.hpp"
+#include <algorithm>
+#include <numeric>
+#include <GL/glew.h>
+
+IndirectBatch::IndirectBatch():mVertexArray(0), mVertexBuffer(0), mIndexBuffer(0), mDrawIDBuffer(0), mObjectBuffer(0), mCommandBuffer(0)
+{
+}
+
+IndirectBatch::~IndirectBatch()
+{
+	Unload();
+}
+
+bool IndirectBatch::IsSupported()
+{
+	return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_shader_storage_buffer_object);
+}
+
+void IndirectBatch::Build(const std::vector<MeshComponent*>& meshes)
+{
+	Unload();
+
+	// Sort objects so each texture/specular power pair is one contiguous run of commands
+	std::vector<MeshComponent*> objects;
+	objects.reserve(meshes.size());
+	for (auto mc : meshes)
+	{
+		if (mc->GetMesh())
+		{
+			objects.emplace_back(mc);
+		}
+	}
+	auto groupKey = [](MeshComponent* mc)
+	{
+		return std::make_pair(mc->GetMesh()->GetTexture(mc->GetTextureIndex()), mc->GetMesh()->GetSpecPower());
+	};
+	std::stable_sort(objects.begin(), objects.end(), [&groupKey](MeshComponent* a, MeshComponent* b)
+	{
+		return groupKey(a) < groupKey(b);
+	});
+
+	// Each distinct mesh is copied into the arena once
+	struct ArenaRange
+	{
+		unsigned int mFirstIndex;
+		int mBaseVertex;
+	};
+	std::unordered_map<Mesh*, ArenaRange> ranges;
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+	std::vector<float> transforms;
+	transforms.reserve(objects.size() * 16);
+	mCommands.reserve(objects.size());
+	mObjects.reserve(objects.size());
+
+	for (auto mc : objects)
+	{
+		Mesh* mesh = mc->GetMesh();
+		auto iter = ranges.find(mesh);
+		if (iter == ranges.end())
+		{
+			ArenaRange range;
+			range.mFirstIndex = static_cast<unsigned int>(indices.size());
+			range.mBaseVertex = static_cast<int>(vertices.size() / 8);
+			vertices.insert(vertices.end(), mesh->GetVertices().begin(), mesh->GetVertices().end());
+			indices.insert(indices.end(), mesh->GetIndices().begin(), mesh->GetIndices().end());
+			iter = ranges.emplace(mesh, range).first;
+		}
+
+		// baseInstance selects the draw id, which indexes the object buffer
+		DrawCommand cmd;
+		cmd.mCount = static_cast<unsigned int>(mesh->GetIndices().size());
+		cmd.mInstanceCount = mc->GetVisible() ? 1 : 0;
+		cmd.mFirstIndex = iter->second.mFirstIndex;
+		cmd.mBaseVertex = iter->second.mBaseVertex;
+		cmd.mBaseInstance = static_cast<unsigned int>(mCommands.size());
+
+		const Matrix4& world = mc->GetOwner()->GetWorldTransform();
+		transforms.insert(transforms.end(), world.GetAsFloatPtr(), world.GetAsFloatPtr() + 16);
+
+		if (mGroups.empty() || groupKey(mc) != std::make_pair(mGroups.back().mTexture, mGroups.back().mSpecPower))
+		{
+			DrawGroup group;
+			group.mTexture = mesh->GetTexture(mc->GetTextureIndex());
+			group.mSpecPower = mesh->GetSpecPower();
+			group.mFirstCommand = mCommands.size();
+			group.mNumCommands = 0;
+			mGroups.emplace_back(group);
+		}
+		mGroups.back().mNumCommands++;
+
+		mObjectIndices.emplace(mc, mCommands.size());
+		mObjects.emplace_back(mc);
+		mCommands.emplace_back(cmd);
+	}
+
+	if (mCommands.empty())
+	{
+		return;
+	}
+
+	std::vector<unsigned int> drawIDs(mCommands.size());
+	std::iota(drawIDs.begin(), drawIDs.end(), 0u);
+
+	glGenVertexArrays(1, &mVertexArray);
+	glBindVertexArray(mVertexArray);
+
+	glGenBuffers(1, &mVertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), 0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), reinterpret_cast<void*>(sizeof(float) * 3));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), reinterpret_cast<void*>(sizeof(float) * 6));
+
+	// Draw id advances once per instance, starting at the command's baseInstance
+	glGenBuffers(1, &mDrawIDBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, mDrawIDBuffer);
+	glBufferData(GL_ARRAY_BUFFER, drawIDs.size() * sizeof(unsigned int), drawIDs.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(3);
+	glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(unsigned int), 0);
+	glVertexAttribDivisor(3, 1);
+
+	glGenBuffers(1, &mIndexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+	glGenBuffers(1, &mObjectBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mObjectBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, transforms.size() * sizeof(float), transforms.data(), GL_STATIC_DRAW);
+
+	glGenBuffers(1, &mCommandBuffer);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, mCommands.size() * sizeof(DrawCommand), mCommands.data(), GL_DYNAMIC_DRAW);
+
+	glBindVertexArray(0);
+}
+
+void IndirectBatch::Unload()
+{
+	if (mVertexArray != 0)
+	{
+		glDeleteBuffers(1, &mVertexBuffer);
+		glDeleteBuffers(1, &mIndexBuffer);
+		glDeleteBuffers(1, &mDrawIDBuffer);
+		glDeleteBuffers(1, &mObjectBuffer);
+		glDeleteBuffers(1, &mCommandBuffer);
+		glDeleteVertexArrays(1, &mVertexArray);
+		mVertexArray = mVertexBuffer = mIndexBuffer = mDrawIDBuffer = mObjectBuffer = mCommandBuffer = 0;
+	}
+	mCommands.clear();
+	mObjects.clear();
+	mGroups.clear();
+	mObjectIndices.clear();
+}
+
+void IndirectBatch::Remove(MeshComponent* mesh)
+{
+	auto iter = mObjectIndices.find(mesh);
+	if (iter != mObjectIndices.end())
+	{
+		mCommands[iter->second].mInstanceCount = 0;
+		PatchCommand(iter->second);
+		mObjects[iter->second] = nullptr;
+		mObjectIndices.erase(iter);
+	}
+}
+
+void IndirectBatch::Cull(const OcclusionCuller* culler)
+{
+	bool changed = false;
+	for (size_t i = 0; i < mObjects.size(); i++)
+	{
+		MeshComponent* mc = mObjects[i];
+		if (mc == nullptr)
+		{
+			continue;
+		}
+		bool visible = mc->GetVisible() &&
+			(culler == nullptr || culler->IsVisible(mc->GetMesh()->GetBox(), mc->GetOwner()->GetWorldTransform()));
+		unsigned int instanceCount = visible ? 1 : 0;
+		if (mCommands[i].mInstanceCount != instanceCount)
+		{
+			mCommands[i].mInstanceCount = instanceCount;
+			changed = true;
+		}
+	}
+
+	if (changed)
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBuffer);
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, mCommands.size() * sizeof(DrawCommand), mCommands.data());
+	}
+}
+
+void IndirectBatch::PatchCommand(size_t index)
+{
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBuffer);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, index * sizeof(DrawCommand), sizeof(DrawCommand), &mCommands[index]);
+}
+
+void IndirectBatch::Draw(Shader* shader)
+{
+	if (mVertexArray == 0)
+	{
+		return;
+	}
+
+	glBindVertexArray(mVertexArray);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mObjectBuffer);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBuffer);
+	for (const auto& group : mGroups)
+	{
+		shader->SetFloatUniform("uSpecPower", group.mSpecPower);
+		if (group.mTexture)
+		{
+			group.mTexture->SetActive();
+		}
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<void*>(group.mFirstCommand * sizeof(DrawCommand)),
+			static_cast<GLsizei>(group.mNumCommands), 0);
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
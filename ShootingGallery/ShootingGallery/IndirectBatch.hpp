@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+
+// GL 4.3 multi-draw-indirect submission for static meshes.
+// Every mesh lives once in a shared vertex/index arena, each object's world transform
+// lives in a shader storage buffer and each object is one indirect draw command.
+// The command buffer is built once; removing or hiding an object only patches its command.
+class IndirectBatch
+{
+public:
+	IndirectBatch();
+	~IndirectBatch();
+
+	// True if the current context supports everything this path needs
+	static bool IsSupported();
+
+	void Build(const std::vector<class MeshComponent*>& meshes);
+	void Unload();
+
+	// Patch a single object, unknown mesh components are ignored
+	void Remove(class MeshComponent* mesh);
+	// Hide objects the culler rejects (and show them again), the command buffer is uploaded only if something changed
+	void Cull(const class OcclusionCuller* culler);
+
+	// Shader must already be active with the view-projection and light uniforms set
+	void Draw(class Shader* shader);
+
+	size_t GetNumObjects() const { return mCommands.size(); }
+
+private:
+	// Layout is fixed by GL
+	struct DrawCommand
+	{
+		unsigned int mCount;
+		unsigned int mInstanceCount;
+		unsigned int mFirstIndex;
+		int mBaseVertex;
+		unsigned int mBaseInstance;
+	};
+
+	// Consecutive commands drawn with the same texture and specular power
+	struct DrawGroup
+	{
+		class Texture* mTexture;
+		float mSpecPower;
+		size_t mFirstCommand;
+		size_t mNumCommands;
+	};
+
+	void PatchCommand(size_t index);
+
+	std::vector<DrawCommand> mCommands;
+	// Object of each command, null once removed
+	std::vector<class MeshComponent*> mObjects;
+	std::vector<DrawGroup> mGroups;
+	std::unordered_map<class MeshComponent*, size_t> mObjectIndices;
+
+	unsigned int mVertexArray;
+	unsigned int mVertexBuffer;
+	unsigned int mIndexBuffer;
+	unsigned int mDrawIDBuffer;
+	unsigned int mObjectBuffer;
+	unsigned int mCommandBuffer;
+};
@@ -0,0 +1,304 @@
+#include "InputSystem.hpp"
+#include "Math.hpp"
+#include <fstream>
+#include <iterator>
+#include <cstring>
+
+namespace
+{
+	const char LogMagic[4] = { 'S', 'G', 'I', 'N' };
+	const uint32_t LogVersion = 1;
+
+	// Per tick flags, a tick with no input costs a single byte
+	enum TickFlags : uint8_t
+	{
+		TickQuit = 1 << 0,
+		TickMouse = 1 << 1,
+		TickKeyChanges = 1 << 2,
+		TickKeyPresses = 1 << 3,
+		TickButtons = 1 << 4
+	};
+
+	template <typename T>
+	void WriteValue(std::vector<uint8_t>& out, const T& value)
+	{
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+		out.insert(out.end(), bytes, bytes + sizeof(T));
+	}
+
+	template <typename T>
+	bool ReadValue(const std::vector<uint8_t>& in, size_t& pos, T& outValue)
+	{
+		if (pos + sizeof(T) > in.size())
+		{
+			return false;
+		}
+		memcpy(&outValue, in.data() + pos, sizeof(T));
+		pos += sizeof(T);
+		return true;
+	}
+
+	int16_t ClampToShort(int value)
+	{
+		if (value > INT16_MAX)
+		{
+			return INT16_MAX;
+		}
+		if (value < INT16_MIN)
+		{
+			return INT16_MIN;
+		}
+		return static_cast<int16_t>(value);
+	}
+}
+
+InputSystem::InputSystem():mMode(ELive), mMouseX(0), mMouseY(0), mButtonPresses(0), mQuit(false), mReadPos(0), mReplayTimeStep(0.0f)
+{
+	memset(mKeyState, 0, sizeof(mKeyState));
+	memset(mPrevKeyState, 0, sizeof(mPrevKeyState));
+}
+
+InputSystem::~InputSystem()
+{
+}
+
+bool InputSystem::StartRecording(const std::string& fileName, float timeStep)
+{
+	mMode = ERecord;
+	mFileName = fileName;
+	mLog.clear();
+	mLog.insert(mLog.end(), LogMagic, LogMagic + sizeof(LogMagic));
+	WriteValue(mLog, LogVersion);
+	WriteValue(mLog, timeStep);
+	return true;
+}
+
+bool InputSystem::StartReplay(const std::string& fileName)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+	{
+		SDL_Log("Input log not found: %s", fileName.c_str());
+		return false;
+	}
+
+	mLog.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	mReadPos = sizeof(LogMagic);
+	uint32_t version = 0;
+	if (mLog.size() < sizeof(LogMagic) || memcmp(mLog.data(), LogMagic, sizeof(LogMagic)) != 0 ||
+		!ReadValue(mLog, mReadPos, version) || version != LogVersion ||
+		!ReadValue(mLog, mReadPos, mReplayTimeStep))
+	{
+		SDL_Log("Input log %s is not a valid version %u log", fileName.c_str(), LogVersion);
+		mLog.clear();
+		return false;
+	}
+
+	mMode = EReplay;
+	mFileName = fileName;
+	return true;
+}
+
+void InputSystem::Shutdown()
+{
+	if (mMode == ERecord)
+	{
+		std::ofstream file(mFileName, std::ios::binary);
+		if (file.is_open())
+		{
+			file.write(reinterpret_cast<const char*>(mLog.data()), mLog.size());
+		}
+		else
+		{
+			SDL_Log("Failed to write input log %s", mFileName.c_str());
+		}
+	}
+	mLog.clear();
+	mMode = ELive;
+}
+
+bool InputSystem::Update()
+{
+	memcpy(mPrevKeyState, mKeyState, sizeof(mKeyState));
+	mMouseX = 0;
+	mMouseY = 0;
+	mButtonPresses = 0;
+	mKeyPresses.clear();
+	mQuit = false;
+
+	if (mMode == EReplay)
+	{
+		// Keep the window responsive, but only a quit request is honored
+		SDL_Event event;
+		bool quit = false;
+		while (SDL_PollEvent(&event))
+		{
+			quit |= event.type == SDL_QUIT;
+		}
+
+		if (!ReadTick())
+		{
+			return false;
+		}
+		mQuit |= quit;
+		return true;
+	}
+
+	PollLive();
+	if (mMode == ERecord)
+	{
+		WriteTick();
+	}
+	return true;
+}
+
+void InputSystem::PollLive()
+{
+	SDL_Event event;
+	while (SDL_PollEvent(&event))
+	{
+		switch (event.type)
+		{
+		case SDL_QUIT:
+			mQuit = true;
+			break;
+			// This fires when a key's initially pressed
+		case SDL_KEYDOWN:
+			if (!event.key.repeat)
+			{
+				mKeyPresses.emplace_back(event.key.keysym.sym);
+			}
+			break;
+		case SDL_MOUSEBUTTONDOWN:
+			mButtonPresses |= SDL_BUTTON(event.button.button);
+			break;
+		default:
+			break;
+		}
+	}
+
+	int numKeys = 0;
+	const Uint8* state = SDL_GetKeyboardState(&numKeys);
+	memcpy(mKeyState, state, Math::Min(numKeys, static_cast<int>(SDL_NUM_SCANCODES)));
+
+	SDL_GetRelativeMouseState(&mMouseX, &mMouseY);
+}
+
+void InputSystem::WriteTick()
+{
+	int16_t mouseX = ClampToShort(mMouseX);
+	int16_t mouseY = ClampToShort(mMouseY);
+	// Replays must see exactly what gameplay saw
+	mMouseX = mouseX;
+	mMouseY = mouseY;
+
+	std::vector<uint16_t> changes;
+	for (uint16_t i = 0; i < SDL_NUM_SCANCODES; i++)
+	{
+		if (mKeyState[i] != mPrevKeyState[i])
+		{
+			changes.emplace_back(i);
+		}
+	}
+
+	uint8_t flags = 0;
+	flags |= mQuit ? TickQuit : 0;
+	flags |= (mouseX != 0 || mouseY != 0) ? TickMouse : 0;
+	flags |= !changes.empty() ? TickKeyChanges : 0;
+	flags |= !mKeyPresses.empty() ? TickKeyPresses : 0;
+	flags |= mButtonPresses != 0 ? TickButtons : 0;
+	WriteValue(mLog, flags);
+
+	if (flags & TickMouse)
+	{
+		WriteValue(mLog, mouseX);
+		WriteValue(mLog, mouseY);
+	}
+	if (flags & TickKeyChanges)
+	{
+		WriteValue(mLog, static_cast<uint16_t>(changes.size()));
+		for (uint16_t scancode : changes)
+		{
+			WriteValue(mLog, scancode);
+		}
+	}
+	if (flags & TickKeyPresses)
+	{
+		uint8_t count = static_cast<uint8_t>(Math::Min(static_cast<int>(mKeyPresses.size()), 255));
+		WriteValue(mLog, count);
+		for (uint8_t i = 0; i < count; i++)
+		{
+			WriteValue(mLog, static_cast<int32_t>(mKeyPresses[i]));
+		}
+	}
+	if (flags & TickButtons)
+	{
+		WriteValue(mLog, static_cast<uint8_t>(mButtonPresses));
+	}
+}
+
+bool InputSystem::ReadTick()
+{
+	uint8_t flags = 0;
+	if (!ReadValue(mLog, mReadPos, flags))
+	{
+		return false;
+	}
+
+	mQuit = (flags & TickQuit) != 0;
+	if (flags & TickMouse)
+	{
+		int16_t mouseX = 0;
+		int16_t mouseY = 0;
+		if (!ReadValue(mLog, mReadPos, mouseX) || !ReadValue(mLog, mReadPos, mouseY))
+		{
+			return false;
+		}
+		mMouseX = mouseX;
+		mMouseY = mouseY;
+	}
+	if (flags & TickKeyChanges)
+	{
+		uint16_t count = 0;
+		if (!ReadValue(mLog, mReadPos, count))
+		{
+			return false;
+		}
+		for (uint16_t i = 0; i < count; i++)
+		{
+			uint16_t scancode = 0;
+			if (!ReadValue(mLog, mReadPos, scancode) || scancode >= SDL_NUM_SCANCODES)
+			{
+				return false;
+			}
+			mKeyState[scancode] = !mKeyState[scancode];
+		}
+	}
+	if (flags & TickKeyPresses)
+	{
+		uint8_t count = 0;
+		if (!ReadValue(mLog, mReadPos, count))
+		{
+			return false;
+		}
+		for (uint8_t i = 0; i < count; i++)
+		{
+			int32_t key = 0;
+			if (!ReadValue(mLog, mReadPos, key))
+			{
+				return false;
+			}
+			mKeyPresses.emplace_back(key);
+		}
+	}
+	if (flags & TickButtons)
+	{
+		uint8_t buttons = 0;
+		if (!ReadValue(mLog, mReadPos, buttons))
+		{
+			return false;
+		}
+		mButtonPresses = buttons;
+	}
+	return true;
+}
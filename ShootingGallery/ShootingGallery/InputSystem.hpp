@@ -0,0 +1,67 @@
+#pragma once
+#include <SDL.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Gathers the input for one tick: keyboard state, relative mouse motion,
+// mouse button presses and key presses.
+// Input can come live from SDL, be recorded to a compact binary log while playing,
+// or be replayed from such a log, which gives bit-exact reruns under a fixed timestep.
+class InputSystem
+{
+public:
+	enum Mode
+	{
+		ELive,
+		ERecord,
+		EReplay
+	};
+
+	InputSystem();
+	~InputSystem();
+
+	// Record every tick to fileName, timeStep is stored in the header for replays
+	bool StartRecording(const std::string& fileName, float timeStep);
+	// Load a log written by StartRecording
+	bool StartReplay(const std::string& fileName);
+	// Flush the recording (if any) to disk
+	void Shutdown();
+
+	// Gather input for the next tick.
+	// Returns false once a replay has run out of ticks.
+	bool Update();
+
+	Mode GetMode() const { return mMode; }
+	// Timestep the log was recorded with
+	float GetReplayTimeStep() const { return mReplayTimeStep; }
+
+	const uint8_t* GetKeyState() const { return mKeyState; }
+	int GetRelativeMouseX() const { return mMouseX; }
+	int GetRelativeMouseY() const { return mMouseY; }
+	bool WasButtonPressed(int button) const { return (mButtonPresses & SDL_BUTTON(button)) != 0; }
+	const std::vector<int>& GetKeyPresses() const { return mKeyPresses; }
+	bool GetQuitRequested() const { return mQuit; }
+
+private:
+	void PollLive();
+	void WriteTick();
+	bool ReadTick();
+
+	Mode mMode;
+
+	// State for the current tick
+	uint8_t mKeyState[SDL_NUM_SCANCODES];
+	uint8_t mPrevKeyState[SDL_NUM_SCANCODES];
+	int mMouseX;
+	int mMouseY;
+	Uint32 mButtonPresses;
+	std::vector<int> mKeyPresses;
+	bool mQuit;
+
+	// Binary log (written on Shutdown when recording, read fully up front when replaying)
+	std::string mFileName;
+	std::vector<uint8_t> mLog;
+	size_t mReadPos;
+	float mReplayTimeStep;
+};
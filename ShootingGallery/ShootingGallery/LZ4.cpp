@@ -0,0 +1,202 @@
+#include "LZ4.hpp"
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	const size_t MinMatch = 4;
+	// The format requires the last 5 bytes to be literals and the last match to start 12 bytes before the end
+	const size_t LastLiterals = 5;
+	const size_t MatchLimit = 12;
+	const size_t MaxOffset = 65535;
+	const int HashBits = 14;
+
+	uint32_t Read32(const uint8_t* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	uint32_t HashSequence(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HashBits);
+	}
+
+	// Lengths of 15 and up spill into extra bytes of 255
+	size_t LengthBytes(size_t length)
+	{
+		return length >= 15 ? (length - 15) / 255 + 1 : 0;
+	}
+
+	void WriteLength(uint8_t*& op, size_t length)
+	{
+		length -= 15;
+		while (length >= 255)
+		{
+			*op++ = 255;
+			length -= 255;
+		}
+		*op++ = static_cast<uint8_t>(length);
+	}
+
+	// Literals followed by a match (matchLength 0 for the last sequence, which has no match)
+	bool WriteSequence(uint8_t*& op, const uint8_t* dstEnd, const uint8_t* literals, size_t numLiterals, size_t offset, size_t matchLength)
+	{
+		size_t matchCode = matchLength ? matchLength - MinMatch : 0;
+		size_t needed = 1 + LengthBytes(numLiterals) + numLiterals + (matchLength ? 2 + LengthBytes(matchCode) : 0);
+		if (static_cast<size_t>(dstEnd - op) < needed)
+		{
+			return false;
+		}
+		uint8_t* token = op++;
+		*token = static_cast<uint8_t>((numLiterals >= 15 ? 15 : numLiterals) << 4);
+		if (numLiterals >= 15)
+		{
+			WriteLength(op, numLiterals);
+		}
+		if (numLiterals > 0)
+		{
+			memcpy(op, literals, numLiterals);
+			op += numLiterals;
+		}
+		if (matchLength)
+		{
+			*op++ = static_cast<uint8_t>(offset & 0xFF);
+			*op++ = static_cast<uint8_t>(offset >> 8);
+			*token |= static_cast<uint8_t>(matchCode >= 15 ? 15 : matchCode);
+			if (matchCode >= 15)
+			{
+				WriteLength(op, matchCode);
+			}
+		}
+		return true;
+	}
+
+	bool ReadLength(const uint8_t*& ip, const uint8_t* srcEnd, size_t& length)
+	{
+		uint8_t byte;
+		do
+		{
+			if (ip == srcEnd)
+			{
+				return false;
+			}
+			byte = *ip++;
+			length += byte;
+		} while (byte == 255);
+		return true;
+	}
+}
+
+size_t LZ4::CompressBound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+size_t LZ4::Compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity)
+{
+	uint8_t* op = dst;
+	const uint8_t* dstEnd = dst + dstCapacity;
+	size_t anchor = 0;
+	if (srcSize > MatchLimit)
+	{
+		// Position of the last sequence seen with each hash
+		std::vector<uint32_t> table(1 << HashBits, 0);
+		size_t ip = 1;
+		const size_t lastMatchStart = srcSize - MatchLimit;
+		while (ip <= lastMatchStart)
+		{
+			uint32_t sequence = Read32(src + ip);
+			uint32_t hash = HashSequence(sequence);
+			size_t ref = table[hash];
+			table[hash] = static_cast<uint32_t>(ip);
+			if (ip - ref > MaxOffset || Read32(src + ref) != sequence)
+			{
+				ip++;
+				continue;
+			}
+
+			size_t matchEnd = ip + MinMatch;
+			const size_t maxEnd = srcSize - LastLiterals;
+			while (matchEnd < maxEnd && src[matchEnd] == src[ref + (matchEnd - ip)])
+			{
+				matchEnd++;
+			}
+			if (!WriteSequence(op, dstEnd, src + anchor, ip - anchor, ip - ref, matchEnd - ip))
+			{
+				return 0;
+			}
+			ip = matchEnd;
+			anchor = ip;
+		}
+	}
+	if (!WriteSequence(op, dstEnd, src + anchor, srcSize - anchor, 0, 0))
+	{
+		return 0;
+	}
+	return op - dst;
+}
+
+bool LZ4::Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+{
+	const uint8_t* ip = src;
+	const uint8_t* srcEnd = src + srcSize;
+	size_t op = 0;
+	while (ip < srcEnd)
+	{
+		uint8_t token = *ip++;
+		size_t numLiterals = token >> 4;
+		if (numLiterals == 15 && !ReadLength(ip, srcEnd, numLiterals))
+		{
+			return false;
+		}
+		if (numLiterals > static_cast<size_t>(srcEnd - ip) || numLiterals > dstSize - op)
+		{
+			return false;
+		}
+		if (numLiterals > 0)
+		{
+			memcpy(dst + op, ip, numLiterals);
+			ip += numLiterals;
+			op += numLiterals;
+		}
+		if (ip == srcEnd)
+		{
+			// The last sequence ends after its literals
+			break;
+		}
+
+		if (srcEnd - ip < 2)
+		{
+			return false;
+		}
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(ip, srcEnd, matchLength))
+		{
+			return false;
+		}
+		matchLength += MinMatch;
+		if (offset == 0 || offset > op || matchLength > dstSize - op)
+		{
+			return false;
+		}
+		const uint8_t* match = dst + op - offset;
+		if (offset >= matchLength)
+		{
+			memcpy(dst + op, match, matchLength);
+		}
+		else
+		{
+			// Overlapping matches repeat the last offset bytes
+			for (size_t i = 0; i < matchLength; i++)
+			{
+				dst[op + i] = match[i];
+			}
+		}
+		op += matchLength;
+	}
+	return op == dstSize;
+}
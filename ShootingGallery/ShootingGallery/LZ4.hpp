@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// The LZ4 block format (no frame header), compatible with the reference lz4 library.
+// The compressor is a plain greedy matcher: it gets most of the ratio of LZ4's fast mode
+// and is only used offline by AssetPacker, decompression is what the game pays for.
+namespace LZ4
+{
+	// Largest output Compress can produce for size input bytes
+	size_t CompressBound(size_t size);
+	// Returns the compressed size, or 0 if it doesn't fit in dstCapacity
+	size_t Compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity);
+	// dstSize must be the exact decompressed size. Fails on malformed input instead of reading or writing out of bounds.
+	bool Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
+}
@@ -0,0 +1,409 @@
+#include "Level.hpp"
+#include "Game.hpp"
+#include "PlaneActor.hpp"
+#include "TargetActor.hpp"
+#include "FPSActor.hpp"
+#include "Profiler.hpp"
+#include "VirtualFS.hpp"
+#include <fstream>
+#include <cstring>
+#include <rapidjson/document.h>
+#include <SDL_log.h>
+
+namespace
+{
+	const char LevelMagic[4] = { 'S', 'G', 'L', 'V' };
+	const uint32_t LevelVersion = 1;
+	const char* ArchetypeNames[Level::NumArchetypes] = { "Plane", "Target", "Player" };
+
+	template <typename T>
+	void WriteValue(std::vector<uint8_t>& out, const T& value)
+	{
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+		out.insert(out.end(), bytes, bytes + sizeof(T));
+	}
+
+	template <typename T>
+	bool ReadValue(const FileData& in, size_t& pos, T& outValue)
+	{
+		if (pos + sizeof(T) > in.GetSize())
+		{
+			return false;
+		}
+		memcpy(&outValue, in.GetData() + pos, sizeof(T));
+		pos += sizeof(T);
+		return true;
+	}
+
+	uint32_t HashBytes(const FileData& data)
+	{
+		// FNV-1a
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < data.GetSize(); i++)
+		{
+			hash = (hash ^ data.GetData()[i]) * 16777619u;
+		}
+		return hash;
+	}
+
+	bool IsNumberArray(const rapidjson::Value& value, rapidjson::SizeType size)
+	{
+		if (!value.IsArray() || value.Size() != size)
+		{
+			return false;
+		}
+		for (rapidjson::SizeType i = 0; i < size; i++)
+		{
+			if (!value[i].IsNumber())
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool ReadVector3(const rapidjson::Value& value, Vector3& outVec)
+	{
+		if (!IsNumberArray(value, 3))
+		{
+			return false;
+		}
+		outVec.Set(static_cast<float>(value[0].GetDouble()), static_cast<float>(value[1].GetDouble()), static_cast<float>(value[2].GetDouble()));
+		return true;
+	}
+
+	// Fails if the object has no such member
+	bool ReadVector3(const rapidjson::Value& object, const char* name, Vector3& outVec)
+	{
+		return object.HasMember(name) && ReadVector3(object[name], outVec);
+	}
+
+	bool ReadQuaternion(const rapidjson::Value& value, Quaternion& outQuat)
+	{
+		if (!IsNumberArray(value, 4))
+		{
+			return false;
+		}
+		outQuat.Set(static_cast<float>(value[0].GetDouble()), static_cast<float>(value[1].GetDouble()),
+			static_cast<float>(value[2].GetDouble()), static_cast<float>(value[3].GetDouble()));
+		return true;
+	}
+}
+
+Level::Level():mAmbientLight(Vector3::Zero)
+{
+	mDirLight.mDirection = Vector3::Zero;
+	mDirLight.mDiffuseColor = Vector3::Zero;
+	mDirLight.mSpecColor = Vector3::Zero;
+	for (size_t i = 0; i < NumArchetypes; i++)
+	{
+		mArchetypeCounts[i] = 0;
+	}
+}
+
+bool Level::Load(const std::string& fileName)
+{
+	PROFILE_SCOPE("Level::Load");
+	uint64_t start = Profiler::GetTime();
+
+	FileData contents;
+	if (!VirtualFS::ReadFile(fileName, contents))
+	{
+		SDL_Log("File not found: Level %s", fileName.c_str());
+		return false;
+	}
+
+	uint32_t sourceHash = HashBytes(contents);
+	std::string cookedName = fileName + "bin";
+	bool cooked = LoadBinary(cookedName, sourceHash);
+	if (!cooked)
+	{
+		if (!LoadJson(fileName, contents))
+		{
+			return false;
+		}
+		if (!SaveBinary(cookedName, sourceHash))
+		{
+			SDL_Log("Failed to write cooked level %s", cookedName.c_str());
+		}
+	}
+
+	SDL_Log("Loaded level %s (%zu actors, %s) in %.2f ms", fileName.c_str(), mActors.size(),
+		cooked ? "cooked" : "json", Profiler::ToMilliseconds(Profiler::GetTime() - start));
+	return true;
+}
+
+bool Level::LoadJson(const std::string& fileName, const FileData& contents)
+{
+	rapidjson::Document doc;
+	doc.Parse(contents.GetChars(), contents.GetSize());
+
+	if (!doc.IsObject())
+	{
+		SDL_Log("Level %s is not valid json", fileName.c_str());
+		return false;
+	}
+
+	if (!doc.HasMember("version") || !doc["version"].IsInt() || doc["version"].GetInt() != 1)
+	{
+		SDL_Log("Level %s not version 1", fileName.c_str());
+		return false;
+	}
+
+	// Lights
+	if (doc.HasMember("ambientLight") && !ReadVector3(doc["ambientLight"], mAmbientLight))
+	{
+		SDL_Log("Level %s has an invalid ambient light", fileName.c_str());
+		return false;
+	}
+	if (doc.HasMember("directionalLight"))
+	{
+		const rapidjson::Value& dir = doc["directionalLight"];
+		if (!dir.IsObject() || !ReadVector3(dir, "direction", mDirLight.mDirection) ||
+			!ReadVector3(dir, "diffuseColor", mDirLight.mDiffuseColor) || !ReadVector3(dir, "specColor", mDirLight.mSpecColor))
+		{
+			SDL_Log("Level %s has an invalid directional light", fileName.c_str());
+			return false;
+		}
+	}
+
+	mPointLights.clear();
+	if (doc.HasMember("pointLights"))
+	{
+		const rapidjson::Value& lights = doc["pointLights"];
+		if (!lights.IsArray())
+		{
+			SDL_Log("Level %s has invalid point lights", fileName.c_str());
+			return false;
+		}
+		mPointLights.reserve(lights.Size());
+		for (rapidjson::SizeType i = 0; i < lights.Size(); i++)
+		{
+			const rapidjson::Value& light = lights[i];
+			PointLight pl;
+			if (!light.IsObject() || !ReadVector3(light, "position", pl.Position) ||
+				!ReadVector3(light, "diffuseColor", pl.DiffuseColor) || !ReadVector3(light, "specColor", pl.SpecularColor) ||
+				(light.HasMember("on") && !light["on"].IsBool()))
+			{
+				SDL_Log("Level %s has an invalid point light %u", fileName.c_str(), i);
+				return false;
+			}
+			pl.TurnOn = (light.HasMember("on") && light["on"].GetBool()) ? 1 : 0;
+			mPointLights.emplace_back(pl);
+		}
+	}
+
+	// Actors
+	if (!doc.HasMember("actors") || !doc["actors"].IsArray())
+	{
+		SDL_Log("Level %s has no actors", fileName.c_str());
+		return false;
+	}
+	const rapidjson::Value& actors = doc["actors"];
+
+	mActors.clear();
+	mActors.reserve(actors.Size());
+	for (size_t i = 0; i < NumArchetypes; i++)
+	{
+		mArchetypeCounts[i] = 0;
+	}
+	for (rapidjson::SizeType i = 0; i < actors.Size(); i++)
+	{
+		const rapidjson::Value& actor = actors[i];
+		if (!actor.IsObject() || !actor.HasMember("type") || !actor["type"].IsString())
+		{
+			SDL_Log("Level %s actor %u has no type", fileName.c_str(), i);
+			return false;
+		}
+
+		ActorDesc desc;
+		std::string type = actor["type"].GetString();
+		size_t archetype = 0;
+		while (archetype < NumArchetypes && type != ArchetypeNames[archetype])
+		{
+			archetype++;
+		}
+		if (archetype == NumArchetypes)
+		{
+			SDL_Log("Level %s actor %u has unknown type %s", fileName.c_str(), i, type.c_str());
+			return false;
+		}
+		desc.mType = static_cast<Archetype>(archetype);
+
+		// Missing transform members keep the archetype's defaults
+		desc.mPosition = Vector3::Zero;
+		desc.mRotation = (desc.mType == ETarget) ? Quaternion(Vector3::UnitZ, Math::Pi) : Quaternion::Identity;
+		desc.mScale = (desc.mType == EPlane) ? 10.0f : 1.0f;
+		if ((actor.HasMember("position") && !ReadVector3(actor["position"], desc.mPosition)) ||
+			(actor.HasMember("rotation") && !ReadQuaternion(actor["rotation"], desc.mRotation)) ||
+			(actor.HasMember("scale") && !actor["scale"].IsNumber()))
+		{
+			SDL_Log("Level %s actor %u has an invalid transform", fileName.c_str(), i);
+			return false;
+		}
+		if (actor.HasMember("scale"))
+		{
+			desc.mScale = static_cast<float>(actor["scale"].GetDouble());
+		}
+
+		mActors.emplace_back(desc);
+		mArchetypeCounts[desc.mType]++;
+	}
+
+	return true;
+}
+
+bool Level::LoadBinary(const std::string& fileName, uint32_t sourceHash)
+{
+	// A pack may have a cooked level, but it is usually built before the game first ran.
+	// The one cooked on disk by Load is tried next, the archive has no say over it.
+	FileData data;
+	if (VirtualFS::ReadFile(fileName, data) && ReadBinary(fileName, data, sourceHash))
+	{
+		return true;
+	}
+	return VirtualFS::ReadLooseFile(fileName, data) && ReadBinary(fileName, data, sourceHash);
+}
+
+bool Level::ReadBinary(const std::string& fileName, const FileData& data, uint32_t sourceHash)
+{
+	size_t pos = sizeof(LevelMagic);
+	uint32_t version = 0;
+	uint32_t hash = 0;
+	if (data.GetSize() < sizeof(LevelMagic) || memcmp(data.GetData(), LevelMagic, sizeof(LevelMagic)) != 0 ||
+		!ReadValue(data, pos, version) || version != LevelVersion ||
+		!ReadValue(data, pos, hash) || hash != sourceHash)
+	{
+		// Stale or foreign file, the json gets cooked again
+		return false;
+	}
+
+	uint32_t numLights = 0;
+	if (!ReadValue(data, pos, mAmbientLight) || !ReadValue(data, pos, mDirLight.mDirection) ||
+		!ReadValue(data, pos, mDirLight.mDiffuseColor) || !ReadValue(data, pos, mDirLight.mSpecColor) ||
+		!ReadValue(data, pos, numLights))
+	{
+		SDL_Log("Cooked level %s is truncated", fileName.c_str());
+		return false;
+	}
+
+	mPointLights.resize(numLights);
+	for (auto& light : mPointLights)
+	{
+		int32_t on = 0;
+		if (!ReadValue(data, pos, light.Position) || !ReadValue(data, pos, light.DiffuseColor) ||
+			!ReadValue(data, pos, light.SpecularColor) || !ReadValue(data, pos, on))
+		{
+			SDL_Log("Cooked level %s is truncated", fileName.c_str());
+			return false;
+		}
+		light.TurnOn = on;
+	}
+
+	uint32_t numActors = 0;
+	if (!ReadValue(data, pos, numActors))
+	{
+		SDL_Log("Cooked level %s is truncated", fileName.c_str());
+		return false;
+	}
+
+	mActors.resize(numActors);
+	for (size_t i = 0; i < NumArchetypes; i++)
+	{
+		mArchetypeCounts[i] = 0;
+	}
+	for (auto& desc : mActors)
+	{
+		uint8_t type = 0;
+		if (!ReadValue(data, pos, type) || type >= NumArchetypes || !ReadValue(data, pos, desc.mPosition) ||
+			!ReadValue(data, pos, desc.mRotation) || !ReadValue(data, pos, desc.mScale))
+		{
+			SDL_Log("Cooked level %s is truncated", fileName.c_str());
+			return false;
+		}
+		desc.mType = static_cast<Archetype>(type);
+		mArchetypeCounts[type]++;
+	}
+
+	return true;
+}
+
+bool Level::SaveBinary(const std::string& fileName, uint32_t sourceHash) const
+{
+	std::vector<uint8_t> data;
+	data.reserve(64 + mPointLights.size() * 40 + mActors.size() * 33);
+	data.insert(data.end(), LevelMagic, LevelMagic + sizeof(LevelMagic));
+	WriteValue(data, LevelVersion);
+	WriteValue(data, sourceHash);
+
+	WriteValue(data, mAmbientLight);
+	WriteValue(data, mDirLight.mDirection);
+	WriteValue(data, mDirLight.mDiffuseColor);
+	WriteValue(data, mDirLight.mSpecColor);
+	WriteValue(data, static_cast<uint32_t>(mPointLights.size()));
+	for (const auto& light : mPointLights)
+	{
+		WriteValue(data, light.Position);
+		WriteValue(data, light.DiffuseColor);
+		WriteValue(data, light.SpecularColor);
+		WriteValue(data, static_cast<int32_t>(light.TurnOn));
+	}
+
+	WriteValue(data, static_cast<uint32_t>(mActors.size()));
+	for (const auto& desc : mActors)
+	{
+		WriteValue(data, static_cast<uint8_t>(desc.mType));
+		WriteValue(data, desc.mPosition);
+		WriteValue(data, desc.mRotation);
+		WriteValue(data, desc.mScale);
+	}
+
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	return file.good();
+}
+
+FPSActor* Level::Spawn(Game* game) const
+{
+	PROFILE_SCOPE("Level::Spawn");
+	// Size every container once instead of growing it per actor
+	game->ReserveActors(mActors.size(), mArchetypeCounts[EPlane]);
+
+	FPSActor* player = nullptr;
+	for (const auto& desc : mActors)
+	{
+		Actor* a = nullptr;
+		switch (desc.mType)
+		{
+		case EPlane:
+			a = new PlaneActor(game);
+			break;
+		case ETarget:
+			a = new TargetActor(game);
+			break;
+		case EPlayer:
+			player = new FPSActor(game);
+			a = player;
+			break;
+		default:
+			continue;
+		}
+		a->SetPosition(desc.mPosition);
+		a->SetRotation(desc.mRotation);
+		a->SetScale(desc.mScale);
+	}
+
+	Renderer* renderer = game->GetRenderer();
+	renderer->SetAmbientLight(mAmbientLight);
+	renderer->GetDirectionalLight() = mDirLight;
+	for (auto light : mPointLights)
+	{
+		renderer->AddPointLight(light);
+	}
+
+	return player;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "Math.hpp"
+#include "Renderer.hpp"
+
+// A level is a list of actor archetypes with transforms plus the lighting setup.
+// Levels are authored as json (.gplevel); the first load cooks them into a binary file next
+// to the json (.gplevelbin) which later loads use for as long as the json is unchanged.
+class Level
+{
+public:
+	enum Archetype : uint8_t
+	{
+		EPlane,
+		ETarget,
+		EPlayer,
+		NumArchetypes
+	};
+
+	struct ActorDesc
+	{
+		Archetype mType;
+		Vector3 mPosition;
+		Quaternion mRotation;
+		float mScale;
+	};
+
+	Level();
+
+	// Loads the cooked file if it matches the json, otherwise parses the json and cooks it
+	bool Load(const std::string& fileName);
+	bool LoadJson(const std::string& fileName, const class FileData& contents);
+	bool LoadBinary(const std::string& fileName, uint32_t sourceHash);
+	bool ReadBinary(const std::string& fileName, const class FileData& data, uint32_t sourceHash);
+	bool SaveBinary(const std::string& fileName, uint32_t sourceHash) const;
+
+	// Creates every actor and sets up the lights, returns the player (if the level has one)
+	class FPSActor* Spawn(class Game* game) const;
+
+	const std::vector<ActorDesc>& GetActors() const { return mActors; }
+	size_t GetArchetypeCount(Archetype type) const { return mArchetypeCounts[type]; }
+
+private:
+	Vector3 mAmbientLight;
+	DirectionalLight mDirLight;
+	std::vector<PointLight> mPointLights;
+	std::vector<ActorDesc> mActors;
+	size_t mArchetypeCounts[NumArchetypes];
+};
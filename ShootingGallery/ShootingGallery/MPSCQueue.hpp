@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue for many producers and a single consumer.
+// Every cell carries a sequence number that tells producers whether it is free and the consumer
+// whether it holds a value, so pushing is one compare-exchange and popping needs no atomic RMW.
+// Nothing is allocated after construction; Push fails when all Capacity cells are in use.
+// T should be a small POD, it is copied in and out.
+template <typename T, size_t Capacity>
+class MPSCQueue
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+	MPSCQueue():mEnqueuePos(0), mDequeuePos(0)
+	{
+		for (size_t i = 0; i < Capacity; i++)
+		{
+			mCells[i].mSequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	// Safe to call from any number of threads at once
+	bool Push(const T& value)
+	{
+		size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell& cell = mCells[pos & (Capacity - 1)];
+			size_t sequence = cell.mSequence.load(std::memory_order_acquire);
+			ptrdiff_t diff = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(pos);
+			if (diff == 0)
+			{
+				// The cell is free for this position, claim it
+				if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					cell.mValue = value;
+					cell.mSequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				// The consumer hasn't freed this cell yet: full
+				return false;
+			}
+			else
+			{
+				// Another producer took the position
+				pos = mEnqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// Only the consumer thread may call this
+	bool Pop(T& outValue)
+	{
+		Cell& cell = mCells[mDequeuePos & (Capacity - 1)];
+		size_t sequence = cell.mSequence.load(std::memory_order_acquire);
+		if (sequence != mDequeuePos + 1)
+		{
+			return false;
+		}
+		outValue = cell.mValue;
+		cell.mSequence.store(mDequeuePos + Capacity, std::memory_order_release);
+		mDequeuePos++;
+		return true;
+	}
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> mSequence;
+		T mValue;
+	};
+
+	Cell mCells[Capacity];
+	// Producers and the consumer each get their own cache line
+	char mPad0[64];
+	std::atomic<size_t> mEnqueuePos;
+	char mPad1[64];
+	size_t mDequeuePos;
+};
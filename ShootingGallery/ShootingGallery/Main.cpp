@@ -1,16 +1,320 @@
 #include "Game.hpp"
+#include "Profiler.hpp"
+#include "Benchmark.hpp"
+#include "MatchServer.hpp"
+#include "Replication.hpp"
+#include "VirtualFS.hpp"
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
 
 int main(int argc, char** argv)
 {
+	// Command line options:
+	// -headless        run the simulation without a window/GPU at uncapped speed
+	// -frames N        quit after N frames
+	// -uncapped        don't limit the frame rate
+	// -record file     record input to file (runs with a fixed timestep)
+	// -replay file     replay input recorded with -record
+	// -trace file      write profiler zones as a Chrome trace on exit
+	// -benchmark file  run the stress scene and write timing percentiles to file, scene options:
+	//                  -planes N -targets M -balls K -lights L -frames F (add -window to render)
+	// -server N        host N headless matches on a thread pool and log per match costs, options:
+	//                  -threads T -tickrate R -frames F (ticks per match), -uncapped ticks as fast as possible
+	// -replicate N     stream delta compressed snapshots to N loopback clients and log bandwidth, options:
+	//                  -loss P (0-1) -latency T (ticks) -frames F
+	// -level file      load this level instead of Assets/Gallery.gplevel
+	// -pack file       read assets and shaders from this archive (ShootingGallery.gpak is used when it exists)
+	// -loosefiles      files in Assets/ and Shaders/ override the archive (default in debug builds)
+	// -mdi             draw static meshes with multi-draw-indirect (GL 4.3, falls back to 3.3)
+	// -compactverts    store meshes with quantized positions, octahedral normals and 16 bit uvs
+	// -nomeshopt       upload meshes in file order, without welding, vertex cache optimization or LODs
+	// -noshadercache   always compile shaders instead of loading cached program binaries
+	// -renderthread    draw on a separate thread while the next frame is simulated
+	// -assetbudget C G cache up to C MB of CPU and G MB of GPU memory in unreferenced meshes and textures
+	// -nostreaming     upload every texture with all its mips instead of streaming the finer ones
+	// -vrambudget MB   streamed texture mips are evicted above this much GPU memory (default 128)
+	// -lagcomp N       shots hit targets where they were N ticks ago (lag compensation)
+	// -nobake          draw the planes one by one instead of baking them into static chunks
+	bool headless = false;
+	bool uncapped = false;
+	bool bakeStatic = true;
+	bool multiDrawIndirect = false;
+	bool compactVertices = false;
+	bool optimizeMeshes = true;
+	bool shaderCache = true;
+	bool renderThread = false;
+	int lagCompensation = 0;
+	int assetCPUBudget = 64;
+	int assetGPUBudget = 256;
+	bool textureStreaming = true;
+	int vramBudget = 128;
+	int maxFrames = 0;
+	const char* recordFile = nullptr;
+	const char* replayFile = nullptr;
+	const char* traceFile = nullptr;
+	const char* levelFile = nullptr;
+	const char* packFile = nullptr;
+	bool looseFiles = false;
+	bool runBenchmark = false;
+	bool runServer = false;
+	MatchServer::Settings server;
+	bool runReplication = false;
+	ReplicationBenchmark::Settings replication;
+	Benchmark::Settings benchmark;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-headless") == 0)
+		{
+			headless = true;
+		}
+		else if (strcmp(argv[i], "-uncapped") == 0)
+		{
+			uncapped = true;
+		}
+		else if (strcmp(argv[i], "-frames") == 0 && i + 1 < argc)
+		{
+			maxFrames = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-record") == 0 && i + 1 < argc)
+		{
+			recordFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "-replay") == 0 && i + 1 < argc)
+		{
+			replayFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "-trace") == 0 && i + 1 < argc)
+		{
+			traceFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "-benchmark") == 0 && i + 1 < argc)
+		{
+			runBenchmark = true;
+			benchmark.mOutputFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "-planes") == 0 && i + 1 < argc)
+		{
+			benchmark.mPlanes = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-targets") == 0 && i + 1 < argc)
+		{
+			benchmark.mTargets = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-balls") == 0 && i + 1 < argc)
+		{
+			benchmark.mBalls = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-lights") == 0 && i + 1 < argc)
+		{
+			benchmark.mLights = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-window") == 0)
+		{
+			benchmark.mHeadless = false;
+		}
+		else if (strcmp(argv[i], "-server") == 0 && i + 1 < argc)
+		{
+			runServer = true;
+			server.mMatches = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+		{
+			server.mThreads = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-tickrate") == 0 && i + 1 < argc)
+		{
+			server.mTickRate = Math::Max(atoi(argv[++i]), 1);
+		}
+		else if (strcmp(argv[i], "-replicate") == 0 && i + 1 < argc)
+		{
+			runReplication = true;
+			replication.mClients = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-loss") == 0 && i + 1 < argc)
+		{
+			replication.mLossRate = static_cast<float>(atof(argv[++i]));
+		}
+		else if (strcmp(argv[i], "-latency") == 0 && i + 1 < argc)
+		{
+			replication.mLatencyTicks = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-level") == 0 && i + 1 < argc)
+		{
+			levelFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "-pack") == 0 && i + 1 < argc)
+		{
+			packFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "-loosefiles") == 0)
+		{
+			looseFiles = true;
+		}
+		else if (strcmp(argv[i], "-mdi") == 0)
+		{
+			multiDrawIndirect = true;
+		}
+		else if (strcmp(argv[i], "-compactverts") == 0)
+		{
+			compactVertices = true;
+		}
+		else if (strcmp(argv[i], "-nomeshopt") == 0)
+		{
+			optimizeMeshes = false;
+		}
+		else if (strcmp(argv[i], "-noshadercache") == 0)
+		{
+			shaderCache = false;
+		}
+		else if (strcmp(argv[i], "-renderthread") == 0)
+		{
+			renderThread = true;
+		}
+		else if (strcmp(argv[i], "-assetbudget") == 0 && i + 2 < argc)
+		{
+			assetCPUBudget = Math::Max(atoi(argv[++i]), 0);
+			assetGPUBudget = Math::Max(atoi(argv[++i]), 0);
+		}
+		else if (strcmp(argv[i], "-nostreaming") == 0)
+		{
+			textureStreaming = false;
+		}
+		else if (strcmp(argv[i], "-vrambudget") == 0 && i + 1 < argc)
+		{
+			vramBudget = Math::Max(atoi(argv[++i]), 0);
+		}
+		else if (strcmp(argv[i], "-lagcomp") == 0 && i + 1 < argc)
+		{
+			lagCompensation = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-nobake") == 0)
+		{
+			bakeStatic = false;
+			benchmark.mBakeStatic = false;
+		}
+	}
+
+	if (looseFiles)
+	{
+		VirtualFS::SetLooseOverride(true);
+	}
+	if (packFile)
+	{
+		if (!VirtualFS::Mount(packFile))
+		{
+			return 1;
+		}
+	}
+	else if (std::ifstream("ShootingGallery.gpak").good())
+	{
+		VirtualFS::Mount("ShootingGallery.gpak");
+	}
+
+	if (runBenchmark)
+	{
+		if (maxFrames > 0)
+		{
+			benchmark.mFrames = maxFrames;
+		}
+		Benchmark bench(benchmark);
+		bool success = bench.Run();
+		if (traceFile)
+		{
+			Profiler::ExportChromeTrace(traceFile);
+		}
+		return success ? 0 : 1;
+	}
+
+	if (runServer)
+	{
+		if (maxFrames > 0)
+		{
+			server.mTicks = maxFrames;
+		}
+		server.mUncapped = uncapped;
+		if (levelFile)
+		{
+			server.mLevelFile = levelFile;
+		}
+		MatchServer host(server);
+		bool success = host.Run();
+		if (traceFile)
+		{
+			Profiler::ExportChromeTrace(traceFile);
+		}
+		return success ? 0 : 1;
+	}
+
+	if (runReplication)
+	{
+		if (maxFrames > 0)
+		{
+			replication.mTicks = maxFrames;
+		}
+		if (levelFile)
+		{
+			replication.mLevelFile = levelFile;
+		}
+		ReplicationBenchmark bench(replication);
+		return bench.Run() ? 0 : 1;
+	}
+
 	Game game;
-	bool success = game.Initialize();
+	if (headless)
+	{
+		game.SetFixedTimestep(1.0f / 60.0f);
+		uncapped = true;
+	}
+	game.SetUncapped(uncapped);
+	game.SetMaxFrames(maxFrames);
+	game.SetBakeStaticGeometry(bakeStatic);
+	game.SetMultiDrawIndirect(multiDrawIndirect);
+	game.SetCompactVertices(compactVertices);
+	game.SetOptimizeMeshes(optimizeMeshes);
+	game.SetShaderCache(shaderCache);
+	game.SetRenderThread(renderThread);
+	game.SetLagCompensation(lagCompensation);
+	game.SetAssetBudget(static_cast<size_t>(assetCPUBudget) * 1024 * 1024, static_cast<size_t>(assetGPUBudget) * 1024 * 1024);
+	game.SetTextureStreaming(textureStreaming);
+	game.SetVRAMBudget(static_cast<size_t>(vramBudget) * 1024 * 1024);
+	if (levelFile)
+	{
+		game.SetLevelFile(levelFile);
+	}
+
+	bool success = game.Initialize(headless);
+	if (success && replayFile)
+	{
+		success = game.StartReplay(replayFile);
+	}
+	else if (success && recordFile)
+	{
+		success = game.StartRecording(recordFile);
+	}
+
 	if (success)
 	{
+		Uint64 start = SDL_GetPerformanceCounter();
 		game.RunLoop();
+		double seconds = static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+		if (headless || replayFile)
+		{
+			SDL_Log("Simulated %d frames in %.3f s (%.1f frames/s)", game.GetFrameCount(), seconds, game.GetFrameCount() / seconds);
+		}
+		if (replayFile || recordFile)
+		{
+			SDL_Log("Final state hash: %08x", game.ComputeStateHash());
+		}
 	}
 	game.Shutdown();
 
+	if (traceFile)
+	{
+		Profiler::ExportChromeTrace(traceFile);
+	}
+
 	// Uncomment if debugging, this will stop console with output from disappearing upon end
 	//system("pause");
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,190 @@
+#include "MatchServer.hpp"
+#include "Game.hpp"
+#include "Level.hpp"
+#include "Profiler.hpp"
+#include "MemoryStats.hpp"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace
+{
+	struct Match
+	{
+		int mIndex;
+		Game* mGame;
+		MatchServer::MatchStats mStats;
+		std::chrono::steady_clock::time_point mNextTick;
+	};
+}
+
+MatchServer::MatchServer(const Settings& settings):mSettings(settings)
+{
+}
+
+bool MatchServer::Run()
+{
+	int numWorkers = mSettings.mThreads;
+	if (numWorkers <= 0)
+	{
+		numWorkers = Math::Max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+	}
+	numWorkers = Math::Min(numWorkers, mSettings.mMatches);
+	mStats.assign(mSettings.mMatches, MatchStats());
+	mFailed.assign(mSettings.mMatches, 0);
+
+	// Cook the level once up front, so the matches only ever read the cooked file
+	Level level;
+	if (!level.Load(mSettings.mLevelFile))
+	{
+		return false;
+	}
+
+	SDL_Log("Hosting %d matches on %d threads at %d ticks/s", mSettings.mMatches, numWorkers, mSettings.mTickRate);
+	uint64_t start = Profiler::GetTime();
+	std::vector<std::thread> workers;
+	for (int i = 0; i < numWorkers; i++)
+	{
+		workers.emplace_back(&MatchServer::RunWorker, this, i, numWorkers);
+	}
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	double wallMs = Profiler::ToMilliseconds(Profiler::GetTime() - start);
+
+	LogStats(wallMs, numWorkers);
+	return std::find(mFailed.begin(), mFailed.end(), 1) == mFailed.end();
+}
+
+void MatchServer::RunWorker(int worker, int numWorkers)
+{
+	using Clock = std::chrono::steady_clock;
+	const Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / mSettings.mTickRate));
+	const float deltaTime = 1.0f / mSettings.mTickRate;
+
+	// Matches are created, ticked and deleted on this thread only
+	std::vector<Match> matches;
+	for (int i = worker; i < mSettings.mMatches; i += numWorkers)
+	{
+		Match match;
+		match.mIndex = i;
+		uint64_t bytes = MemoryStats::GetAllocatedBytes() - MemoryStats::GetFreedBytes();
+		match.mGame = new Game();
+		match.mGame->SetHosted(true);
+		match.mGame->SetFixedTimestep(deltaTime);
+		match.mGame->SetUncapped(true);
+		match.mGame->SetMaxFrames(mSettings.mTicks);
+		match.mGame->SetLevelFile(mSettings.mLevelFile);
+		if (!match.mGame->Initialize(true))
+		{
+			SDL_Log("Match %d failed to start", i);
+			mFailed[i] = 1;
+			match.mGame->Shutdown();
+			delete match.mGame;
+			continue;
+		}
+		match.mStats.mLoadBytes = MemoryStats::GetAllocatedBytes() - MemoryStats::GetFreedBytes() - bytes;
+		match.mStats.mLiveBytes = match.mStats.mLoadBytes;
+		match.mStats.mPeakBytes = match.mStats.mLoadBytes;
+		matches.emplace_back(match);
+	}
+
+	// Spread the matches' ticks over the period instead of running them all at once
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < matches.size(); i++)
+	{
+		matches[i].mNextTick = start + period * i / matches.size();
+	}
+
+	size_t running = matches.size();
+	while (running > 0)
+	{
+		// The match whose tick is due first
+		Match* next = nullptr;
+		for (auto& match : matches)
+		{
+			if (match.mGame->IsRunning() && (next == nullptr || match.mNextTick < next->mNextTick))
+			{
+				next = &match;
+			}
+		}
+
+		if (!mSettings.mUncapped)
+		{
+			std::this_thread::sleep_until(next->mNextTick);
+			if (Clock::now() - next->mNextTick > period)
+			{
+				next->mStats.mLateTicks++;
+			}
+		}
+		next->mNextTick += period;
+
+		MatchStats& stats = next->mStats;
+		uint64_t tickStart = Profiler::GetTime();
+		uint64_t allocations = MemoryStats::GetAllocationCount();
+		uint64_t bytes = MemoryStats::GetAllocatedBytes();
+		uint64_t freed = MemoryStats::GetFreedBytes();
+		if (mSettings.mShotInterval > 0 && stats.mTicks % mSettings.mShotInterval == 0)
+		{
+			next->mGame->FirePlayerWeapon();
+		}
+		next->mGame->Tick();
+		double ms = Profiler::ToMilliseconds(Profiler::GetTime() - tickStart);
+		stats.mTicks++;
+		stats.mBusyMs += ms;
+		stats.mMaxTickMs = Math::Max(stats.mMaxTickMs, ms);
+		stats.mTickAllocations += MemoryStats::GetAllocationCount() - allocations;
+		stats.mTickBytes += MemoryStats::GetAllocatedBytes() - bytes;
+		// Whatever a tick frees on this thread belonged to this match, matches never share memory
+		stats.mLiveBytes += MemoryStats::GetAllocatedBytes() - bytes;
+		stats.mLiveBytes -= MemoryStats::GetFreedBytes() - freed;
+		stats.mPeakBytes = Math::Max(stats.mPeakBytes, stats.mLiveBytes);
+
+		if (!next->mGame->IsRunning())
+		{
+			stats.mPoolBytes = ComponentPools::GetCapacityBytes(next->mGame);
+			running--;
+		}
+	}
+
+	for (auto& match : matches)
+	{
+		match.mGame->Shutdown();
+		delete match.mGame;
+		mStats[match.mIndex] = match.mStats;
+	}
+}
+
+void MatchServer::LogStats(double wallMs, int numWorkers) const
+{
+	double busyMs = 0.0;
+	int ticks = 0;
+	int matches = 0;
+	uint64_t peakBytes = 0;
+	for (size_t i = 0; i < mStats.size(); i++)
+	{
+		const MatchStats& stats = mStats[i];
+		if (stats.mTicks == 0)
+		{
+			continue;
+		}
+		SDL_Log("Match %zu: %d ticks, %.3f ms/tick (max %.3f), %d late, live %.1f KB (load %.1f, peak %.1f, component pools %.1f), %.1f allocations/tick (%.1f KB)",
+			i, stats.mTicks, stats.mBusyMs / stats.mTicks, stats.mMaxTickMs, stats.mLateTicks, stats.mLiveBytes / 1024.0, stats.mLoadBytes / 1024.0,
+			stats.mPeakBytes / 1024.0, stats.mPoolBytes / 1024.0, static_cast<double>(stats.mTickAllocations) / stats.mTicks, stats.mTickBytes / 1024.0 / stats.mTicks);
+		busyMs += stats.mBusyMs;
+		ticks += stats.mTicks;
+		matches++;
+		peakBytes += stats.mPeakBytes;
+	}
+	if (ticks == 0)
+	{
+		return;
+	}
+
+	// How many matches one core could keep at the tick rate, from the measured cost per tick
+	double tickMs = busyMs / ticks;
+	double matchesPerCore = 1000.0 / (mSettings.mTickRate * tickMs);
+	SDL_Log("%d ticks in %.1f ms on %d threads: %.3f ms/tick, workers %.0f%% busy, about %.0f matches per core, %.1f KB peak per match",
+		ticks, wallMs, numWorkers, tickMs, 100.0 * busyMs / (wallMs * numWorkers), matchesPerCore, peakBytes / 1024.0 / matches);
+}
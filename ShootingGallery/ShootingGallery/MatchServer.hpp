@@ -0,0 +1,60 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Hosts many headless matches in one process, for bots and leaderboard sessions.
+// Each match is its own Game (actors, components, PhysWorld, null renderer) ticking at a fixed rate.
+// Matches are spread over a pool of worker threads and stay on their worker for their whole life,
+// since component pools are per thread. Per match CPU time and memory are reported at the end.
+class MatchServer
+{
+public:
+	struct Settings
+	{
+		int mMatches = 16;
+		// 0 uses one worker per hardware thread
+		int mThreads = 0;
+		int mTickRate = 60;
+		// Ticks every match runs before it ends
+		int mTicks = 600;
+		// Ticks between the bot's shots (0 never shoots)
+		int mShotInterval = 30;
+		// Tick as fast as possible instead of at mTickRate
+		bool mUncapped = false;
+		std::string mLevelFile = "Assets/Gallery.gplevel";
+	};
+
+	struct MatchStats
+	{
+		int mTicks = 0;
+		// Time spent in the match's ticks
+		double mBusyMs = 0.0;
+		double mMaxTickMs = 0.0;
+		// Ticks that started more than a tick period after they were due
+		int mLateTicks = 0;
+		// Bytes the match holds (allocated minus freed) once loaded, after its last tick and at most
+		uint64_t mLoadBytes = 0;
+		uint64_t mLiveBytes = 0;
+		uint64_t mPeakBytes = 0;
+		// Part of mLiveBytes: chunks of the match's component pools, used or not
+		uint64_t mPoolBytes = 0;
+		// Allocation churn while ticking, not netted against frees
+		uint64_t mTickAllocations = 0;
+		uint64_t mTickBytes = 0;
+	};
+
+	MatchServer(const Settings& settings);
+	// Runs every match to its end, returns false if one failed to start
+	bool Run();
+	const std::vector<MatchStats>& GetStats() const { return mStats; }
+
+private:
+	void RunWorker(int worker, int numWorkers);
+	void LogStats(double wallMs, int numWorkers) const;
+
+	Settings mSettings;
+	// One entry per match, each only written by the match's worker
+	std::vector<MatchStats> mStats;
+	std::vector<char> mFailed;
+};
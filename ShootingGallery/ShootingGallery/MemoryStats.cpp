@@ -0,0 +1,114 @@
+#include "MemoryStats.hpp"
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	thread_local uint64_t tAllocationCount = 0;
+	thread_local uint64_t tAllocatedBytes = 0;
+	thread_local uint64_t tFreedBytes = 0;
+
+	// Every block starts with its size, so frees are counted even through unsized delete.
+	// The header is as big as malloc's alignment, which the returned pointer keeps.
+	const size_t HeaderSize = alignof(std::max_align_t);
+
+	void* CountedAlloc(size_t size)
+	{
+		void* block = malloc(HeaderSize + size);
+		if (block == nullptr)
+		{
+			return nullptr;
+		}
+		*static_cast<size_t*>(block) = size;
+		tAllocationCount++;
+		tAllocatedBytes += size;
+		return static_cast<char*>(block) + HeaderSize;
+	}
+
+	void CountedFree(void* p)
+	{
+		if (p == nullptr)
+		{
+			return;
+		}
+		void* block = static_cast<char*>(p) - HeaderSize;
+		tFreedBytes += *static_cast<size_t*>(block);
+		free(block);
+	}
+}
+
+uint64_t MemoryStats::GetAllocationCount()
+{
+	return tAllocationCount;
+}
+
+uint64_t MemoryStats::GetAllocatedBytes()
+{
+	return tAllocatedBytes;
+}
+
+uint64_t MemoryStats::GetFreedBytes()
+{
+	return tFreedBytes;
+}
+
+void* operator new(size_t size)
+{
+	void* p = CountedAlloc(size);
+	if (p == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	void* p = CountedAlloc(size);
+	if (p == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAlloc(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	CountedFree(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	CountedFree(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	CountedFree(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	CountedFree(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	CountedFree(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	CountedFree(p);
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+
+// Counts heap allocations made through the global operator new.
+// Counters are per thread, so they are cheap and can be attributed
+// to whatever that thread is working on.
+namespace MemoryStats
+{
+	// Number of allocations made by the calling thread
+	uint64_t GetAllocationCount();
+	// Bytes requested by the calling thread
+	uint64_t GetAllocatedBytes();
+	// Bytes freed by the calling thread, so allocated minus freed is what its work still holds
+	uint64_t GetFreedBytes();
+}
@@ -2,13 +2,13 @@
 #include "Renderer.hpp"
 #include "Texture.hpp"
 #include "VertexArray.hpp"
-#include <fstream>
-#include <sstream>
+#include "VirtualFS.hpp"
 #include <rapidjson/document.h>
 #include <SDL_log.h>
 #include "Math.hpp"
+#include "MeshOptimizer.hpp"
 
-Mesh::Mesh():mBox(Vector3::Infinity, Vector3::NegInfinity), mVertexArray(nullptr), mRadius(0.0f), mSpecPower(100.0f)
+Mesh::Mesh():mBox(Vector3::Infinity, Vector3::NegInfinity), mVertexArray(nullptr), mVertexSize(8), mRadius(0.0f), mSpecPower(100.0f)
 {
 }
 
@@ -18,19 +18,15 @@ Mesh::~Mesh()
 
 bool Mesh::Load(const std::string& fileName, Renderer* renderer)
 {
-	std::ifstream file(fileName);
-	if (!file.is_open())
+	FileData file;
+	if (!VirtualFS::ReadFile(fileName, file))
 	{
 		SDL_Log("File not found: Mesh %s", fileName.c_str());
 		return false;
 	}
 
-	std::stringstream fileStream;
-	fileStream << file.rdbuf();
-	std::string contents = fileStream.str();
-	rapidjson::StringStream jsonStr(contents.c_str());
 	rapidjson::Document doc;
-	doc.ParseStream(jsonStr);
+	doc.Parse(file.GetChars(), file.GetSize());
 
 	if (!doc.IsObject())
 	{
@@ -51,6 +47,7 @@ bool Mesh::Load(const std::string& fileName, Renderer* renderer)
 
 	// Skip the vertex format/shader for now
 	size_t vertSize = 8;
+	mVertexSize = vertSize;
 
 	// Load textures
 	const rapidjson::Value& textures = doc["textures"];
@@ -66,18 +63,18 @@ bool Mesh::Load(const std::string& fileName, Renderer* renderer)
 	{
 		// Is this texture already loaded?
 		std::string texName = textures[i].GetString();
-		Texture* t = renderer->GetTexture(texName);
-		if (t == nullptr)
+		AssetHandle<Texture> t = renderer->GetTexture(texName);
+		if (!t)
 		{
 			// Try loading the texture
 			t = renderer->GetTexture(texName);
-			if (t == nullptr)
+			if (!t)
 			{
 				// If it's still null, just use the default texture
 				t = renderer->GetTexture("Assets/Default.png");
 			}
 		}
-		mTextures.emplace_back(t);
+		mTextures.emplace_back(std::move(t));
 	}
 
 	// Load in the vertices
@@ -88,7 +85,8 @@ bool Mesh::Load(const std::string& fileName, Renderer* renderer)
 		return false;
 	}
 
-	std::vector<float> vertices;
+	std::vector<float>& vertices = mVertices;
+	vertices.clear();
 	vertices.reserve(vertsJson.Size() * vertSize);
 	mRadius = 0.0f;
 	for (rapidjson::SizeType i = 0; i < vertsJson.Size(); i++)
@@ -123,8 +121,10 @@ bool Mesh::Load(const std::string& fileName, Renderer* renderer)
 		return false;
 	}
 
-	std::vector<unsigned int> indices;
+	std::vector<unsigned int>& indices = mIndices;
+	indices.clear();
 	indices.reserve(indJson.Size() * 3);
+	const unsigned int numVerts = vertsJson.Size();
 	for (rapidjson::SizeType i = 0; i < indJson.Size(); i++)
 	{
 		const rapidjson::Value& ind = indJson[i];
@@ -134,27 +134,101 @@ bool Mesh::Load(const std::string& fileName, Renderer* renderer)
 			return false;
 		}
 
-		indices.emplace_back(ind[0].GetUint());
-		indices.emplace_back(ind[1].GetUint());
-		indices.emplace_back(ind[2].GetUint());
+		for (rapidjson::SizeType j = 0; j < 3; j++)
+		{
+			// The optimizer and the GPU index straight into the vertices, so a bad file must not get that far
+			if (!ind[j].IsUint() || ind[j].GetUint() >= numVerts)
+			{
+				SDL_Log("Index out of range in triangle %u of %s (%u vertices)", i, fileName.c_str(), numVerts);
+				return false;
+			}
+			indices.emplace_back(ind[j].GetUint());
+		}
+	}
+
+	if (renderer->GetOptimizeMeshes())
+	{
+		MeshOptimizer::Stats before, after;
+		MeshOptimizer::Optimize(vertices, indices, vertSize, before, after);
+		SDL_Log("Optimized mesh %s: %zu -> %zu verts, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", fileName.c_str(),
+			before.mNumVerts, after.mNumVerts, before.mACMR, after.mACMR, before.mATVR, after.mATVR);
+	}
+
+	mLODs.clear();
+	mLODs.push_back({ 0, static_cast<unsigned>(indices.size()) });
+
+	// Headless renderers have no GL context, so only keep the CPU-side data
+	if (renderer->IsHeadless())
+	{
+		return true;
+	}
+
+	std::vector<unsigned int> lodIndices(indices);
+	if (renderer->GetOptimizeMeshes())
+	{
+		GenerateLODs(lodIndices);
+		if (mLODs.size() > 1)
+		{
+			SDL_Log("Generated %zu LODs for %s: %u -> %u triangles", mLODs.size() - 1, fileName.c_str(),
+				mLODs.front().mNumIndices / 3, mLODs.back().mNumIndices / 3);
+		}
 	}
 
 	// Now create a vertex array
-	mVertexArray = new VertexArray(vertices.data(), static_cast<unsigned>(vertices.size()) / vertSize, indices.data(), static_cast<unsigned>(indices.size()));
+	mVertexArray = new VertexArray(vertices.data(), static_cast<unsigned>(vertices.size()) / vertSize, lodIndices.data(), static_cast<unsigned>(lodIndices.size()),
+		renderer->GetCompactVertices() ? VertexArray::ECompact : VertexArray::EFloat);
 	return true;
 }
 
+void Mesh::GenerateLODs(std::vector<unsigned int>& lodIndices)
+{
+	// Small meshes aren't worth the extra draw state
+	const size_t minTriangles = 64;
+	const size_t maxLODs = 4;
+	// Each LOD simplifies the previous one rather than the full mesh
+	std::vector<unsigned int> previous(mIndices);
+	for (size_t lod = 1; lod < maxLODs && previous.size() / 3 >= minTriangles; lod++)
+	{
+		// Each LOD halves the triangle count and is used at half the screen size of the previous one
+		// (see MeshComponent::SelectLOD), so the allowed error doubles too
+		float maxError = mRadius * static_cast<float>(1 << lod) / 32.0f;
+		std::vector<unsigned int> simplified = MeshOptimizer::Simplify(mVertices, previous, mVertexSize, previous.size() / 2, maxError);
+		// Stop once the simplifier is stuck on seams/borders
+		if (simplified.size() * 4 > previous.size() * 3)
+		{
+			break;
+		}
+		MeshOptimizer::OptimizeVertexCache(simplified, mVertices.size() / mVertexSize);
+
+		mLODs.push_back({ static_cast<unsigned>(lodIndices.size()), static_cast<unsigned>(simplified.size()) });
+		lodIndices.insert(lodIndices.end(), simplified.begin(), simplified.end());
+		previous.swap(simplified);
+	}
+}
+
 void Mesh::Unload()
 {
 	delete mVertexArray;
 	mVertexArray = nullptr;
+	mTextures.clear();
+}
+
+size_t Mesh::GetCPUBytes() const
+{
+	return sizeof(Mesh) + mVertices.capacity() * sizeof(float) + mIndices.capacity() * sizeof(unsigned int) +
+		mLODs.capacity() * sizeof(LOD) + mShaderName.capacity();
+}
+
+size_t Mesh::GetGPUBytes() const
+{
+	return mVertexArray ? mVertexArray->GetBufferSize() : 0;
 }
 
 Texture* Mesh::GetTexture(size_t index)
 {
 	if (index < mTextures.size())
 	{
-		return mTextures[index];
+		return mTextures[index].Get();
 	}
 	else
 	{
@@ -3,24 +3,52 @@
 #include <vector>
 #include <string>
 #include "Collision.hpp"
+#include "AssetCache.hpp"
 
 class Mesh
 {
 public:
+	// A level of detail is a range of the shared index buffer, all LODs use the same vertices
+	struct LOD
+	{
+		unsigned int mFirstIndex;
+		unsigned int mNumIndices;
+	};
+
 	Mesh();
 	~Mesh();
 	bool Load(const std::string& fileName, class Renderer* renderer);
+	// Also drops the texture references
 	void Unload();
+	// Lets go of the textures without touching GL, so the rest can be unloaded on the render thread
+	void ReleaseTextures() { mTextures.clear(); }
 	class VertexArray* GetVertexArray() { return mVertexArray; }
 	class Texture* GetTexture(size_t index);
 	const std::string& GetShaderName() const { return mShaderName; }
 	float GetRadius() const { return mRadius; }
 	const AABB& GetBox() const { return mBox; }
 	float GetSpecPower() const { return mSpecPower; }
+	// CPU-side copies of the vertex/index data (kept for headless mode and tools)
+	const std::vector<float>& GetVertices() const { return mVertices; }
+	const std::vector<unsigned int>& GetIndices() const { return mIndices; }
+	size_t GetVertexSize() const { return mVertexSize; }
+	// LOD 0 is the full mesh (GetIndices), higher LODs have fewer triangles
+	size_t GetNumLODs() const { return mLODs.size(); }
+	const LOD& GetLOD(size_t index) const { return mLODs[index]; }
+	// Memory held by the mesh itself, not counting its textures
+	size_t GetCPUBytes() const;
+	size_t GetGPUBytes() const;
 private:
+	// Appends simplified copies of mIndices to lodIndices and records their ranges
+	void GenerateLODs(std::vector<unsigned int>& lodIndices);
+
 	AABB mBox;
-	std::vector<class Texture*> mTextures;
+	std::vector<AssetHandle<class Texture>> mTextures;
 	class VertexArray* mVertexArray;
+	std::vector<float> mVertices;
+	std::vector<unsigned int> mIndices;
+	std::vector<LOD> mLODs;
+	size_t mVertexSize;
 	std::string mShaderName;
 	float mRadius;
 	float mSpecPower;
@@ -1,13 +1,11 @@
 #include "MeshComponent.hpp"
-#include "Shader.hpp"
 #include "Mesh.hpp"
+#include "Texture.hpp"
 #include "Actor.hpp"
 #include "Game.hpp"
 #include "Renderer.hpp"
-#include "Texture.hpp"
-#include "VertexArray.hpp"
 
-MeshComponent::MeshComponent(Actor* owner):Component(owner), mMesh(nullptr), mTextureIndex(0), mVisible(true)
+MeshComponent::MeshComponent(Actor* owner):Component(owner), mMesh(nullptr), mTextureIndex(0), mVisible(true), mLOD(0), mBaked(false)
 {
 	mOwner->GetGame()->GetRenderer()->AddMeshComp(this);
 }
@@ -17,19 +15,49 @@ MeshComponent::~MeshComponent()
 	mOwner->GetGame()->GetRenderer()->RemoveMeshComp(this);
 }
 
-void MeshComponent::Draw(Shader* shader)
+namespace
+{
+	// LOD n is used below this projected radius (in pixels) divided by 2^(n-1)
+	const float LODRadius = 64.0f;
+	const float LODHysteresis = 0.1f;
+
+	float LODThreshold(size_t lod)
+	{
+		return LODRadius / static_cast<float>(1 << (lod - 1));
+	}
+}
+
+void MeshComponent::SelectLOD(const Vector3& cameraPos, float pixelsPerUnit)
+{
+	if (mMesh == nullptr || mMesh->GetNumLODs() <= 1)
+	{
+		mLOD = 0;
+		return;
+	}
+
+	float distance = Math::Max((mOwner->GetPosition() - cameraPos).Length(), 1.0f);
+	float radius = mMesh->GetRadius() * mOwner->GetScale() * pixelsPerUnit / distance;
+	size_t lod = Math::Min(mLOD, mMesh->GetNumLODs() - 1);
+	// A coarser LOD has to be clearly below its threshold, a finer one clearly above
+	while (lod + 1 < mMesh->GetNumLODs() && radius < LODThreshold(lod + 1) * (1.0f - LODHysteresis))
+	{
+		lod++;
+	}
+	while (lod > 0 && radius > LODThreshold(lod) * (1.0f + LODHysteresis))
+	{
+		lod--;
+	}
+	mLOD = lod;
+}
+
+void MeshComponent::RequestTextureDetail(const Vector3& cameraPos, float pixelsPerUnit)
 {
-	if (mMesh)
+	Texture* texture = mMesh ? mMesh->GetTexture(mTextureIndex) : nullptr;
+	if (texture == nullptr)
 	{
-		shader->SetMatrixUniform("uWorldTransform", mOwner->GetWorldTransform());
-		shader->SetFloatUniform("uSpecPower", mMesh->GetSpecPower());
-		Texture* t = mMesh->GetTexture(mTextureIndex);
-		if (t)
-		{
-			t->SetActive();
-		}
-		VertexArray* va = mMesh->GetVertexArray();
-		va->SetActive();
-		glDrawElements(GL_TRIANGLES, va->GetNumIndices(), GL_UNSIGNED_INT, nullptr);
+		return;
 	}
+	// Assumes the texture is stretched once across the bounding sphere's diameter
+	float distance = Math::Max((mOwner->GetPosition() - cameraPos).Length(), 1.0f);
+	texture->RequestPixels(2.0f * mMesh->GetRadius() * mOwner->GetScale() * pixelsPerUnit / distance);
 }
\ No newline at end of file
@@ -1,20 +1,37 @@
 #pragma once
 #include "Component.hpp"
+#include "Math.hpp"
+#include "AssetCache.hpp"
 #include <cstddef>
 
 class MeshComponent : public Component
 {
+	POOLED_COMPONENT(MeshComponent)
 public:
 	MeshComponent(class Actor* owner);
 	~MeshComponent();
-	virtual void Draw(class Shader* shader);
-	virtual void SetMesh(class Mesh* mesh) { mMesh = mesh; }
+	// Keeps the mesh loaded for as long as the component uses it
+	virtual void SetMesh(const AssetHandle<class Mesh>& mesh) { mMeshRef = mesh; mMesh = mesh.Get(); }
+	class Mesh* GetMesh() const { return mMesh; }
 	void SetTextureIndex(size_t index) { mTextureIndex = index; }
+	size_t GetTextureIndex() const { return mTextureIndex; }
 	void SetVisible(bool visible) { mVisible = visible; }
 	bool GetVisible() const { return mVisible; }
+	// Picks the mesh LOD from the projected size of the bounding sphere, with some hysteresis
+	// so a mesh sitting on a threshold doesn't flicker between two LODs
+	void SelectLOD(const Vector3& cameraPos, float pixelsPerUnit);
+	size_t GetLOD() const { return mLOD; }
+	// Tells a streamed texture how many pixels the mesh covers, so it can load the mips that need
+	void RequestTextureDetail(const Vector3& cameraPos, float pixelsPerUnit);
+	// Baked into the renderer's static geometry, so it's no longer drawn on its own
+	void SetBaked(bool baked) { mBaked = baked; }
+	bool IsBaked() const { return mBaked; }
 
 protected:
 	class Mesh* mMesh;
+	AssetHandle<class Mesh> mMeshRef;
 	size_t mTextureIndex;
 	bool mVisible;
+	size_t mLOD;
+	bool mBaked;
 };
\ No newline at end of file
@@ -0,0 +1,492 @@
+#include "MeshOptimizer.hpp"
+#include <unordered_map>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <queue>
+
+namespace
+{
+	// Forsyth's scoring constants
+	const int CacheSize = 32;
+	const float CacheDecayPower = 1.5f;
+	const float LastTriScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+
+	struct VertexData
+	{
+		int mCachePos = -1;
+		float mScore = 0.0f;
+		// Triangles using this vertex that haven't been emitted
+		std::vector<unsigned int> mTriangles;
+	};
+
+	float VertexScore(const VertexData& v)
+	{
+		if (v.mTriangles.empty())
+		{
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (v.mCachePos >= 0)
+		{
+			if (v.mCachePos < 3)
+			{
+				// Used by the last triangle, a fixed score avoids preferring any of its edges
+				score = LastTriScore;
+			}
+			else
+			{
+				float scaler = 1.0f / (CacheSize - 3);
+				score = powf(1.0f - (v.mCachePos - 3) * scaler, CacheDecayPower);
+			}
+		}
+
+		// Boost vertices with few triangles left, so lone triangles don't get stranded
+		score += ValenceBoostScale * powf(static_cast<float>(v.mTriangles.size()), -ValenceBoostPower);
+		return score;
+	}
+}
+
+void MeshOptimizer::Optimize(std::vector<float>& vertices, std::vector<unsigned int>& indices, size_t vertSize, Stats& outBefore, Stats& outAfter)
+{
+	outBefore = Analyze(indices, vertices.size() / vertSize);
+	WeldVertices(vertices, indices, vertSize);
+	OptimizeVertexCache(indices, vertices.size() / vertSize);
+	OptimizeVertexFetch(vertices, indices, vertSize);
+	outAfter = Analyze(indices, vertices.size() / vertSize);
+}
+
+void MeshOptimizer::WeldVertices(std::vector<float>& vertices, std::vector<unsigned int>& indices, size_t vertSize)
+{
+	const size_t numVerts = vertices.size() / vertSize;
+	const size_t vertBytes = vertSize * sizeof(float);
+	std::unordered_map<std::string, unsigned int> unique;
+	unique.reserve(numVerts);
+	std::vector<unsigned int> remap(numVerts);
+	std::vector<float> welded;
+	welded.reserve(vertices.size());
+
+	for (size_t i = 0; i < numVerts; i++)
+	{
+		const float* v = &vertices[i * vertSize];
+		std::string key(reinterpret_cast<const char*>(v), vertBytes);
+		auto result = unique.emplace(key, static_cast<unsigned int>(welded.size() / vertSize));
+		if (result.second)
+		{
+			welded.insert(welded.end(), v, v + vertSize);
+		}
+		remap[i] = result.first->second;
+	}
+
+	for (auto& index : indices)
+	{
+		index = remap[index];
+	}
+	vertices.swap(welded);
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<unsigned int>& indices, size_t numVerts)
+{
+	const size_t numTris = indices.size() / 3;
+	if (numTris == 0)
+	{
+		return;
+	}
+
+	std::vector<VertexData> verts(numVerts);
+	for (size_t t = 0; t < numTris; t++)
+	{
+		for (size_t k = 0; k < 3; k++)
+		{
+			verts[indices[t * 3 + k]].mTriangles.emplace_back(static_cast<unsigned int>(t));
+		}
+	}
+	for (auto& v : verts)
+	{
+		v.mScore = VertexScore(v);
+	}
+
+	std::vector<float> triScores(numTris);
+	std::vector<bool> emitted(numTris, false);
+	for (size_t t = 0; t < numTris; t++)
+	{
+		triScores[t] = verts[indices[t * 3]].mScore + verts[indices[t * 3 + 1]].mScore + verts[indices[t * 3 + 2]].mScore;
+	}
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	// LRU cache, three extra slots for the vertices pushed out by the newest triangle
+	std::vector<unsigned int> cache;
+	cache.reserve(CacheSize + 3);
+
+	size_t bestTri = std::max_element(triScores.begin(), triScores.end()) - triScores.begin();
+	size_t scanStart = 0;
+	while (bestTri < numTris)
+	{
+		emitted[bestTri] = true;
+		unsigned int tri[3] = { indices[bestTri * 3], indices[bestTri * 3 + 1], indices[bestTri * 3 + 2] };
+		output.insert(output.end(), tri, tri + 3);
+
+		// Move the triangle's vertices to the front of the cache
+		for (int k = 2; k >= 0; k--)
+		{
+			VertexData& v = verts[tri[k]];
+			auto& tris = v.mTriangles;
+			tris.erase(std::find(tris.begin(), tris.end(), static_cast<unsigned int>(bestTri)));
+			auto cached = std::find(cache.begin(), cache.end(), tri[k]);
+			if (cached != cache.end())
+			{
+				cache.erase(cached);
+			}
+			cache.insert(cache.begin(), tri[k]);
+		}
+
+		// Rescore everything in the cache, evicted vertices drop to cache position -1
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			verts[cache[i]].mCachePos = i < static_cast<size_t>(CacheSize) ? static_cast<int>(i) : -1;
+		}
+		std::vector<unsigned int> touched(cache.begin(), cache.end());
+		if (cache.size() > static_cast<size_t>(CacheSize))
+		{
+			cache.resize(CacheSize);
+		}
+
+		// The next triangle is the best one touching the cache
+		float bestScore = -1.0f;
+		bestTri = numTris;
+		for (unsigned int vi : touched)
+		{
+			VertexData& v = verts[vi];
+			float newScore = VertexScore(v);
+			float delta = newScore - v.mScore;
+			v.mScore = newScore;
+			for (unsigned int t : v.mTriangles)
+			{
+				triScores[t] += delta;
+			}
+		}
+		for (unsigned int vi : cache)
+		{
+			for (unsigned int t : verts[vi].mTriangles)
+			{
+				if (triScores[t] > bestScore)
+				{
+					bestScore = triScores[t];
+					bestTri = t;
+				}
+			}
+		}
+
+		// Nothing in the cache has triangles left, continue with the next unemitted triangle
+		if (bestTri == numTris)
+		{
+			while (scanStart < numTris && emitted[scanStart])
+			{
+				scanStart++;
+			}
+			bestTri = scanStart;
+		}
+	}
+
+	indices.swap(output);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<float>& vertices, std::vector<unsigned int>& indices, size_t vertSize)
+{
+	const unsigned int unused = ~0u;
+	std::vector<unsigned int> remap(vertices.size() / vertSize, unused);
+	std::vector<float> ordered;
+	ordered.reserve(vertices.size());
+
+	for (auto& index : indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = static_cast<unsigned int>(ordered.size() / vertSize);
+			const float* v = &vertices[index * vertSize];
+			ordered.insert(ordered.end(), v, v + vertSize);
+		}
+		index = remap[index];
+	}
+	vertices.swap(ordered);
+}
+
+MeshOptimizer::Stats MeshOptimizer::Analyze(const std::vector<unsigned int>& indices, size_t numVerts, size_t cacheSize)
+{
+	Stats stats;
+	stats.mNumVerts = numVerts;
+	stats.mNumTriangles = indices.size() / 3;
+	if (stats.mNumTriangles == 0 || numVerts == 0)
+	{
+		return stats;
+	}
+
+	// FIFO cache, like most hardware: hits don't move a vertex
+	std::vector<size_t> insertedAt(numVerts, 0);
+	size_t misses = 0;
+	for (unsigned int index : indices)
+	{
+		if (insertedAt[index] == 0 || misses + 1 - insertedAt[index] > cacheSize)
+		{
+			misses++;
+			insertedAt[index] = misses;
+		}
+	}
+
+	stats.mACMR = static_cast<float>(misses) / stats.mNumTriangles;
+	stats.mATVR = static_cast<float>(misses) / numVerts;
+	return stats;
+}
+
+namespace
+{
+	// Symmetric 4x4 matrix, the sum of squared distances to a set of planes
+	struct Quadric
+	{
+		double a[10] = {};
+
+		void AddPlane(double x, double y, double z, double d)
+		{
+			a[0] += x * x; a[1] += x * y; a[2] += x * z; a[3] += x * d;
+			a[4] += y * y; a[5] += y * z; a[6] += y * d;
+			a[7] += z * z; a[8] += z * d;
+			a[9] += d * d;
+		}
+
+		void Add(const Quadric& q)
+		{
+			for (int i = 0; i < 10; i++)
+			{
+				a[i] += q.a[i];
+			}
+		}
+
+		double Error(const float* p) const
+		{
+			double x = p[0], y = p[1], z = p[2];
+			return a[0] * x * x + 2.0 * a[1] * x * y + 2.0 * a[2] * x * z + 2.0 * a[3] * x
+				+ a[4] * y * y + 2.0 * a[5] * y * z + 2.0 * a[6] * y
+				+ a[7] * z * z + 2.0 * a[8] * z + a[9];
+		}
+	};
+
+	struct Collapse
+	{
+		double mCost;
+		unsigned int mFrom;
+		unsigned int mTo;
+		unsigned int mFromVersion;
+		unsigned int mToVersion;
+
+		bool operator<(const Collapse& other) const { return mCost > other.mCost; }
+	};
+
+	void Cross(const float* a, const float* b, const float* c, double* out)
+	{
+		double e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		double e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		out[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		out[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		out[2] = e1[0] * e2[1] - e1[1] * e2[0];
+	}
+}
+
+std::vector<unsigned int> MeshOptimizer::Simplify(const std::vector<float>& vertices, const std::vector<unsigned int>& indices, size_t vertSize,
+	size_t targetIndexCount, float maxError)
+{
+	const size_t numVerts = vertices.size() / vertSize;
+	const size_t numTris = indices.size() / 3;
+	auto position = [&vertices, vertSize](unsigned int v) { return &vertices[v * vertSize]; };
+
+	// Vertices sharing a position with a different normal/uv sit on a seam and can't move
+	std::vector<bool> locked(numVerts, false);
+	{
+		std::unordered_map<std::string, unsigned int> firstAtPosition;
+		for (unsigned int v = 0; v < numVerts; v++)
+		{
+			std::string key(reinterpret_cast<const char*>(position(v)), 3 * sizeof(float));
+			auto result = firstAtPosition.emplace(key, v);
+			if (!result.second)
+			{
+				locked[v] = true;
+				locked[result.first->second] = true;
+			}
+		}
+	}
+
+	// So can vertices on an open border (an edge used by one triangle)
+	std::unordered_map<unsigned long long, int> edgeUses;
+	auto edgeKey = [](unsigned int a, unsigned int b)
+	{
+		return a < b ? (static_cast<unsigned long long>(a) << 32) | b : (static_cast<unsigned long long>(b) << 32) | a;
+	};
+	for (size_t t = 0; t < numTris; t++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			edgeUses[edgeKey(indices[t * 3 + k], indices[t * 3 + (k + 1) % 3])]++;
+		}
+	}
+	for (const auto& edge : edgeUses)
+	{
+		if (edge.second == 1)
+		{
+			locked[edge.first >> 32] = true;
+			locked[edge.first & 0xffffffffull] = true;
+		}
+	}
+
+	std::vector<Quadric> quadrics(numVerts);
+	std::vector<std::vector<unsigned int>> vertTris(numVerts);
+	std::vector<unsigned int> tris(indices);
+	std::vector<bool> alive(numTris, true);
+	for (size_t t = 0; t < numTris; t++)
+	{
+		double n[3];
+		Cross(position(tris[t * 3]), position(tris[t * 3 + 1]), position(tris[t * 3 + 2]), n);
+		double len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		for (int k = 0; k < 3; k++)
+		{
+			vertTris[tris[t * 3 + k]].emplace_back(static_cast<unsigned int>(t));
+		}
+		if (len <= 0.0)
+		{
+			continue;
+		}
+		n[0] /= len; n[1] /= len; n[2] /= len;
+		const float* p = position(tris[t * 3]);
+		double d = -(n[0] * p[0] + n[1] * p[1] + n[2] * p[2]);
+		for (int k = 0; k < 3; k++)
+		{
+			quadrics[tris[t * 3 + k]].AddPlane(n[0], n[1], n[2], d);
+		}
+	}
+
+	std::vector<unsigned int> versions(numVerts, 0);
+	std::priority_queue<Collapse> queue;
+	auto pushEdges = [&](unsigned int v)
+	{
+		for (unsigned int t : vertTris[v])
+		{
+			if (!alive[t])
+			{
+				continue;
+			}
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int from = tris[t * 3 + k];
+				unsigned int to = tris[t * 3 + (k + 1) % 3];
+				for (int dir = 0; dir < 2; dir++)
+				{
+					if (!locked[from])
+					{
+						Quadric q = quadrics[from];
+						q.Add(quadrics[to]);
+						queue.push({ q.Error(position(to)), from, to, versions[from], versions[to] });
+					}
+					std::swap(from, to);
+				}
+			}
+		}
+	};
+	for (unsigned int v = 0; v < numVerts; v++)
+	{
+		pushEdges(v);
+	}
+
+	const double maxCost = static_cast<double>(maxError) * maxError;
+	size_t liveTris = numTris;
+	while (liveTris * 3 > targetIndexCount && !queue.empty())
+	{
+		Collapse c = queue.top();
+		queue.pop();
+		if (c.mCost > maxCost)
+		{
+			break;
+		}
+		if (c.mFromVersion != versions[c.mFrom] || c.mToVersion != versions[c.mTo])
+		{
+			continue;
+		}
+
+		// Moving the vertex must not flip any triangle that survives the collapse
+		bool flips = false;
+		for (unsigned int t : vertTris[c.mFrom])
+		{
+			if (!alive[t])
+			{
+				continue;
+			}
+			unsigned int* tri = &tris[t * 3];
+			if (tri[0] == c.mTo || tri[1] == c.mTo || tri[2] == c.mTo)
+			{
+				continue;
+			}
+			const float* p[3];
+			for (int k = 0; k < 3; k++)
+			{
+				p[k] = position(tri[k] == c.mFrom ? c.mTo : tri[k]);
+			}
+			double before[3], after[3];
+			Cross(position(tri[0]), position(tri[1]), position(tri[2]), before);
+			Cross(p[0], p[1], p[2], after);
+			double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+			double lenSq = (before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) *
+				(after[0] * after[0] + after[1] * after[1] + after[2] * after[2]);
+			if (dot <= 0.0 || dot * dot < 0.04 * lenSq)
+			{
+				flips = true;
+				break;
+			}
+		}
+		if (flips)
+		{
+			continue;
+		}
+
+		// Collapse: triangles on the edge disappear, the rest now use the target vertex
+		for (unsigned int t : vertTris[c.mFrom])
+		{
+			if (!alive[t])
+			{
+				continue;
+			}
+			unsigned int* tri = &tris[t * 3];
+			if (tri[0] == c.mTo || tri[1] == c.mTo || tri[2] == c.mTo)
+			{
+				alive[t] = false;
+				liveTris--;
+				continue;
+			}
+			for (int k = 0; k < 3; k++)
+			{
+				if (tri[k] == c.mFrom)
+				{
+					tri[k] = c.mTo;
+				}
+			}
+			vertTris[c.mTo].emplace_back(t);
+		}
+		vertTris[c.mFrom].clear();
+		quadrics[c.mTo].Add(quadrics[c.mFrom]);
+		versions[c.mFrom]++;
+		versions[c.mTo]++;
+		pushEdges(c.mTo);
+	}
+
+	std::vector<unsigned int> result;
+	result.reserve(liveTris * 3);
+	for (size_t t = 0; t < numTris; t++)
+	{
+		if (alive[t])
+		{
+			result.insert(result.end(), &tris[t * 3], &tris[t * 3] + 3);
+		}
+	}
+	return result;
+}
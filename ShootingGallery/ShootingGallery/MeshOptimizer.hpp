@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+// Mesh processing run on the CPU-side vertex/index data before it is uploaded.
+// Vertices are interleaved floats (vertSize per vertex), indices are triangle lists.
+class MeshOptimizer
+{
+public:
+	struct Stats
+	{
+		size_t mNumVerts = 0;
+		size_t mNumTriangles = 0;
+		// Average cache miss ratio: transformed vertices per triangle (0.5 is ideal for large grids, 3 is worst)
+		float mACMR = 0.0f;
+		// Average transform to vertex ratio: transformed vertices per unique vertex (1 is ideal)
+		float mATVR = 0.0f;
+	};
+
+	// Weld, reorder triangles for the vertex cache and reorder vertices for fetch, returns the stats before and after
+	static void Optimize(std::vector<float>& vertices, std::vector<unsigned int>& indices, size_t vertSize, Stats& outBefore, Stats& outAfter);
+
+	// Merge bit-identical vertices
+	static void WeldVertices(std::vector<float>& vertices, std::vector<unsigned int>& indices, size_t vertSize);
+	// Tom Forsyth's linear-speed vertex cache optimization
+	static void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t numVerts);
+	// Order vertices by first use so fetches walk the vertex buffer linearly, unused vertices are dropped
+	static void OptimizeVertexFetch(std::vector<float>& vertices, std::vector<unsigned int>& indices, size_t vertSize);
+
+	// Quadric error edge collapse. Returns a new index list for the same vertices with at most targetIndexCount
+	// indices, stopping early once a collapse would move the surface by more than maxError.
+	// Borders and uv/normal seams are kept so the lower detail mesh doesn't crack.
+	static std::vector<unsigned int> Simplify(const std::vector<float>& vertices, const std::vector<unsigned int>& indices, size_t vertSize,
+		size_t targetIndexCount, float maxError);
+
+	// Simulates a FIFO post-transform cache
+	static Stats Analyze(const std::vector<unsigned int>& indices, size_t numVerts, size_t cacheSize = 16);
+};
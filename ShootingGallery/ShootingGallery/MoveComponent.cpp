@@ -3,6 +3,7 @@
 
 MoveComponent::MoveComponent(class Actor* owner, int updateOrder):Component(owner, updateOrder), mAngularSpeed(0.0f), mForwardSpeed(0.0f), mStrafeSpeed(0.0f)
 {
+	SetTicking(true);
 
 }
 
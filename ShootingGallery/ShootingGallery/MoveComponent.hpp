@@ -3,6 +3,7 @@
 
 class MoveComponent : public Component
 {
+	POOLED_COMPONENT(MoveComponent)
 public:
 	MoveComponent(class Actor* owner, int updateOrder = 10);
 	void Update(float deltaTime) override;
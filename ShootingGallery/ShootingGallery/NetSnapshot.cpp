@@ -0,0 +1,467 @@
+#include "NetSnapshot.hpp"
+#include <algorithm>
+
+namespace
+{
+	const float PositionScale = 16.0f;
+	const int PositionBits = 20;
+	// Position changes up to this many steps are sent as small deltas (a ball moves 400 per tick)
+	const int SmallDeltaBits = 12;
+	const int SmallDeltaLimit = (1 << (SmallDeltaBits - 1)) - 1;
+	const int RotationBits = 10;
+	const int RotationLimit = (1 << (RotationBits - 1)) - 1;
+	const float ScaleSteps = 64.0f;
+	const int ScaleBits = 12;
+
+	// Changed fields of an actor that was in the baseline
+	enum FieldBits
+	{
+		FieldPosition = 1 << 0,
+		FieldRotation = 1 << 1,
+		FieldScale = 1 << 2,
+		FieldLifeSpan = 1 << 3,
+		FieldHits = 1 << 4,
+		NumFields = 5
+	};
+
+	int32_t SignExtend(uint32_t value, int bits)
+	{
+		uint32_t sign = 1u << (bits - 1);
+		return static_cast<int32_t>((value ^ sign) - sign);
+	}
+
+	uint32_t ChangedFields(const NetActorState& a, const NetActorState& b)
+	{
+		uint32_t fields = 0;
+		if (a.mPosition[0] != b.mPosition[0] || a.mPosition[1] != b.mPosition[1] || a.mPosition[2] != b.mPosition[2])
+		{
+			fields |= FieldPosition;
+		}
+		if (a.mRotLargest != b.mRotLargest || a.mRotation[0] != b.mRotation[0] || a.mRotation[1] != b.mRotation[1] || a.mRotation[2] != b.mRotation[2])
+		{
+			fields |= FieldRotation;
+		}
+		if (a.mScale != b.mScale)
+		{
+			fields |= FieldScale;
+		}
+		if (a.mLifeSpan != b.mLifeSpan)
+		{
+			fields |= FieldLifeSpan;
+		}
+		if (a.mHits != b.mHits)
+		{
+			fields |= FieldHits;
+		}
+		return fields;
+	}
+
+	void WriteFields(const NetActorState& actor, const NetActorState* base, uint32_t fields, BitWriter& out)
+	{
+		if (fields & FieldPosition)
+		{
+			// Moving actors usually only move a few steps per tick
+			bool small = base != nullptr;
+			for (int i = 0; i < 3 && small; i++)
+			{
+				int32_t delta = actor.mPosition[i] - base->mPosition[i];
+				small = delta >= -SmallDeltaLimit && delta <= SmallDeltaLimit;
+			}
+			if (base)
+			{
+				out.WriteBool(small);
+			}
+			for (int i = 0; i < 3; i++)
+			{
+				if (small)
+				{
+					out.WriteSigned(actor.mPosition[i] - base->mPosition[i], SmallDeltaBits);
+				}
+				else
+				{
+					out.WriteSigned(actor.mPosition[i], PositionBits);
+				}
+			}
+		}
+		if (fields & FieldRotation)
+		{
+			out.Write(actor.mRotLargest, 2);
+			for (int i = 0; i < 3; i++)
+			{
+				out.WriteSigned(actor.mRotation[i], RotationBits);
+			}
+		}
+		if (fields & FieldScale)
+		{
+			out.Write(actor.mScale, ScaleBits);
+		}
+		if (fields & FieldLifeSpan)
+		{
+			out.Write(actor.mLifeSpan, 8);
+		}
+		if (fields & FieldHits)
+		{
+			out.Write(actor.mHits, 8);
+		}
+	}
+
+	void ReadFields(NetActorState& actor, bool delta, uint32_t fields, BitReader& in)
+	{
+		if (fields & FieldPosition)
+		{
+			bool small = delta && in.ReadBool();
+			for (int i = 0; i < 3; i++)
+			{
+				if (small)
+				{
+					actor.mPosition[i] += in.ReadSigned(SmallDeltaBits);
+				}
+				else
+				{
+					actor.mPosition[i] = in.ReadSigned(PositionBits);
+				}
+			}
+		}
+		if (fields & FieldRotation)
+		{
+			actor.mRotLargest = static_cast<uint8_t>(in.Read(2));
+			for (int i = 0; i < 3; i++)
+			{
+				actor.mRotation[i] = static_cast<int16_t>(in.ReadSigned(RotationBits));
+			}
+		}
+		if (fields & FieldScale)
+		{
+			actor.mScale = static_cast<uint16_t>(in.Read(ScaleBits));
+		}
+		if (fields & FieldLifeSpan)
+		{
+			actor.mLifeSpan = static_cast<uint8_t>(in.Read(8));
+		}
+		if (fields & FieldHits)
+		{
+			actor.mHits = static_cast<uint8_t>(in.Read(8));
+		}
+	}
+
+	bool ReadHeader(BitReader& in, uint32_t& outTick, bool& outHasBaseline, uint32_t& outBaselineTick)
+	{
+		outTick = in.Read(32);
+		outHasBaseline = in.ReadBool();
+		outBaselineTick = outHasBaseline ? in.Read(32) : 0;
+		return in.IsValid();
+	}
+}
+
+BitWriter::BitWriter():mScratch(0), mScratchBits(0)
+{
+}
+
+void BitWriter::Reset()
+{
+	mData.clear();
+	mScratch = 0;
+	mScratchBits = 0;
+}
+
+void BitWriter::Write(uint32_t value, int bits)
+{
+	uint64_t mask = (1ull << bits) - 1;
+	mScratch |= (value & mask) << mScratchBits;
+	mScratchBits += bits;
+	while (mScratchBits >= 8)
+	{
+		mData.emplace_back(static_cast<uint8_t>(mScratch));
+		mScratch >>= 8;
+		mScratchBits -= 8;
+	}
+}
+
+void BitWriter::WriteVar(uint32_t value)
+{
+	if (value < (1u << 4))
+	{
+		Write(0, 2);
+		Write(value, 4);
+	}
+	else if (value < (1u << 8))
+	{
+		Write(1, 2);
+		Write(value, 8);
+	}
+	else if (value < (1u << 16))
+	{
+		Write(2, 2);
+		Write(value, 16);
+	}
+	else
+	{
+		Write(3, 2);
+		Write(value, 32);
+	}
+}
+
+void BitWriter::Finish()
+{
+	if (mScratchBits > 0)
+	{
+		mData.emplace_back(static_cast<uint8_t>(mScratch));
+		mScratch = 0;
+		mScratchBits = 0;
+	}
+}
+
+BitReader::BitReader(const uint8_t* data, size_t size):mData(data), mSize(size), mBitPos(0), mValid(true)
+{
+}
+
+uint32_t BitReader::Read(int bits)
+{
+	if (mBitPos + bits > mSize * 8)
+	{
+		mValid = false;
+		return 0;
+	}
+	uint64_t value = 0;
+	int read = 0;
+	while (read < bits)
+	{
+		size_t byte = mBitPos / 8;
+		int offset = static_cast<int>(mBitPos % 8);
+		int count = Math::Min(8 - offset, bits - read);
+		uint64_t chunk = (mData[byte] >> offset) & ((1u << count) - 1);
+		value |= chunk << read;
+		read += count;
+		mBitPos += count;
+	}
+	return static_cast<uint32_t>(value);
+}
+
+int32_t BitReader::ReadSigned(int bits)
+{
+	return SignExtend(Read(bits), bits);
+}
+
+uint32_t BitReader::ReadVar()
+{
+	static const int widths[4] = { 4, 8, 16, 32 };
+	return Read(widths[Read(2)]);
+}
+
+void NetActorState::SetTransform(const Vector3& position, const Quaternion& rotation, float scale)
+{
+	const float limit = static_cast<float>((1 << (PositionBits - 1)) - 1);
+	mPosition[0] = static_cast<int32_t>(Math::Clamp(roundf(position.x * PositionScale), -limit, limit));
+	mPosition[1] = static_cast<int32_t>(Math::Clamp(roundf(position.y * PositionScale), -limit, limit));
+	mPosition[2] = static_cast<int32_t>(Math::Clamp(roundf(position.z * PositionScale), -limit, limit));
+
+	// q and -q are the same rotation, so the largest component can be made positive and left out
+	float q[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+	int largest = 0;
+	for (int i = 1; i < 4; i++)
+	{
+		if (Math::Abs(q[i]) > Math::Abs(q[largest]))
+		{
+			largest = i;
+		}
+	}
+	float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+	mRotLargest = static_cast<uint8_t>(largest);
+	for (int i = 0, j = 0; i < 4; i++)
+	{
+		if (i != largest)
+		{
+			// The others are at most 1/sqrt(2) in magnitude
+			float scaled = q[i] * sign * Math::Sqrt(2.0f) * RotationLimit;
+			mRotation[j++] = static_cast<int16_t>(Math::Clamp(roundf(scaled), static_cast<float>(-RotationLimit), static_cast<float>(RotationLimit)));
+		}
+	}
+
+	mScale = static_cast<uint16_t>(Math::Clamp(roundf(scale * ScaleSteps), 0.0f, static_cast<float>((1 << ScaleBits) - 1)));
+}
+
+Vector3 NetActorState::GetPosition() const
+{
+	return Vector3(mPosition[0] / PositionScale, mPosition[1] / PositionScale, mPosition[2] / PositionScale);
+}
+
+Quaternion NetActorState::GetRotation() const
+{
+	float q[4];
+	float sumSq = 0.0f;
+	for (int i = 0, j = 0; i < 4; i++)
+	{
+		if (i != mRotLargest)
+		{
+			q[i] = mRotation[j++] / (Math::Sqrt(2.0f) * RotationLimit);
+			sumSq += q[i] * q[i];
+		}
+	}
+	q[mRotLargest] = Math::Sqrt(Math::Max(0.0f, 1.0f - sumSq));
+	Quaternion rotation;
+	rotation.Set(q[0], q[1], q[2], q[3]);
+	return rotation;
+}
+
+float NetActorState::GetScale() const
+{
+	return mScale / ScaleSteps;
+}
+
+bool NetActorState::operator==(const NetActorState& other) const
+{
+	return mID == other.mID && mType == other.mType && ChangedFields(*this, other) == 0;
+}
+
+void SnapshotCodec::Encode(const NetSnapshot& snapshot, const NetSnapshot* baseline, BitWriter& out)
+{
+	out.Write(snapshot.mTick, 32);
+	out.WriteBool(baseline != nullptr);
+	if (baseline)
+	{
+		out.Write(baseline->mTick, 32);
+	}
+
+	// Both lists are sorted by id, so one merge finds removed, new and changed actors
+	static const std::vector<NetActorState> empty;
+	const std::vector<NetActorState>& base = baseline ? baseline->mActors : empty;
+	const std::vector<NetActorState>& actors = snapshot.mActors;
+
+	// Removed actors, ids as deltas from the previous one
+	uint32_t removed = 0;
+	for (size_t i = 0, j = 0; i < base.size(); i++)
+	{
+		while (j < actors.size() && actors[j].mID < base[i].mID)
+		{
+			j++;
+		}
+		if (j == actors.size() || actors[j].mID != base[i].mID)
+		{
+			removed++;
+		}
+	}
+	out.WriteVar(removed);
+	uint32_t lastID = 0;
+	for (size_t i = 0, j = 0; i < base.size(); i++)
+	{
+		while (j < actors.size() && actors[j].mID < base[i].mID)
+		{
+			j++;
+		}
+		if (j == actors.size() || actors[j].mID != base[i].mID)
+		{
+			out.WriteVar(base[i].mID - lastID);
+			lastID = base[i].mID;
+		}
+	}
+
+	// New and changed actors, each with a bit for new and the mask of changed fields
+	lastID = 0;
+	for (size_t i = 0, j = 0; i < actors.size(); i++)
+	{
+		const NetActorState& actor = actors[i];
+		while (j < base.size() && base[j].mID < actor.mID)
+		{
+			j++;
+		}
+		const NetActorState* prev = (j < base.size() && base[j].mID == actor.mID) ? &base[j] : nullptr;
+		uint32_t fields = prev ? ChangedFields(actor, *prev) : (1u << NumFields) - 1;
+		if (fields == 0)
+		{
+			continue;
+		}
+
+		out.WriteBool(true);
+		out.WriteVar(actor.mID - lastID);
+		lastID = actor.mID;
+		out.WriteBool(prev == nullptr);
+		if (prev == nullptr)
+		{
+			out.Write(actor.mType, 2);
+		}
+		else
+		{
+			out.Write(fields, NumFields);
+		}
+		WriteFields(actor, prev, fields, out);
+	}
+	out.WriteBool(false);
+	out.Finish();
+}
+
+bool SnapshotCodec::PeekBaseline(const uint8_t* data, size_t size, uint32_t& outTick)
+{
+	BitReader in(data, size);
+	uint32_t tick;
+	bool hasBaseline;
+	return ReadHeader(in, tick, hasBaseline, outTick) && hasBaseline;
+}
+
+bool SnapshotCodec::Decode(const uint8_t* data, size_t size, const NetSnapshot* baseline, NetSnapshot& outSnapshot)
+{
+	BitReader in(data, size);
+	uint32_t tick;
+	bool hasBaseline;
+	uint32_t baselineTick;
+	if (!ReadHeader(in, tick, hasBaseline, baselineTick) || hasBaseline != (baseline != nullptr) ||
+		(baseline && baseline->mTick != baselineTick))
+	{
+		return false;
+	}
+
+	outSnapshot.mTick = tick;
+	std::vector<NetActorState>& actors = outSnapshot.mActors;
+	actors.clear();
+	if (baseline)
+	{
+		actors = baseline->mActors;
+	}
+	auto find = [&actors](uint32_t id)
+	{
+		return std::lower_bound(actors.begin(), actors.end(), id,
+			[](const NetActorState& a, uint32_t value) { return a.mID < value; });
+	};
+
+	uint32_t removed = in.ReadVar();
+	uint32_t id = 0;
+	for (uint32_t i = 0; i < removed && in.IsValid(); i++)
+	{
+		id += in.ReadVar();
+		auto iter = find(id);
+		if (iter == actors.end() || iter->mID != id)
+		{
+			return false;
+		}
+		actors.erase(iter);
+	}
+
+	id = 0;
+	while (in.ReadBool())
+	{
+		id += in.ReadVar();
+		auto iter = find(id);
+		if (in.ReadBool())
+		{
+			// Ids stay unique, a new actor can't reuse one that exists
+			if (iter != actors.end() && iter->mID == id)
+			{
+				return false;
+			}
+			NetActorState actor = {};
+			actor.mID = id;
+			actor.mType = static_cast<NetActorState::Type>(in.Read(2));
+			ReadFields(actor, false, (1u << NumFields) - 1, in);
+			actors.insert(iter, actor);
+		}
+		else
+		{
+			uint32_t fields = in.Read(NumFields);
+			if (iter == actors.end() || iter->mID != id)
+			{
+				return false;
+			}
+			ReadFields(*iter, true, fields, in);
+		}
+	}
+	return in.IsValid();
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Math.hpp"
+
+// Appends values of 1 to 32 bits to a byte buffer, least significant bit first
+class BitWriter
+{
+public:
+	BitWriter();
+	void Reset();
+	void Write(uint32_t value, int bits);
+	void WriteSigned(int32_t value, int bits) { Write(static_cast<uint32_t>(value), bits); }
+	void WriteBool(bool value) { Write(value ? 1 : 0, 1); }
+	// Small numbers in few bits: 2 bits pick a width of 4, 8, 16 or 32 bits
+	void WriteVar(uint32_t value);
+	// Pads the last byte, call before sending the data
+	void Finish();
+
+	const std::vector<uint8_t>& GetData() const { return mData; }
+	size_t GetBitCount() const { return mData.size() * 8 + mScratchBits; }
+
+private:
+	std::vector<uint8_t> mData;
+	uint64_t mScratch;
+	int mScratchBits;
+};
+
+// Reads what a BitWriter wrote. Reading past the end returns zeros and marks the reader invalid.
+class BitReader
+{
+public:
+	BitReader(const uint8_t* data, size_t size);
+	uint32_t Read(int bits);
+	int32_t ReadSigned(int bits);
+	bool ReadBool() { return Read(1) != 0; }
+	uint32_t ReadVar();
+	bool IsValid() const { return mValid; }
+
+private:
+	const uint8_t* mData;
+	size_t mSize;
+	size_t mBitPos;
+	bool mValid;
+};
+
+// One actor as it is replicated: quantized, so encoder and decoder agree bit for bit
+struct NetActorState
+{
+	enum Type : uint8_t
+	{
+		EOther,
+		EPlayer,
+		ETarget,
+		EBall
+	};
+
+	uint32_t mID;
+	Type mType;
+	// Position in 1/16 units
+	int32_t mPosition[3];
+	// Smallest three: index of the dropped (largest) component and the other three
+	uint8_t mRotLargest;
+	int16_t mRotation[3];
+	// Scale in 1/64 steps
+	uint16_t mScale;
+	// Remaining ball lifetime in ticks of 1/60 s
+	uint8_t mLifeSpan;
+	// Times a target was hit (wraps)
+	uint8_t mHits;
+
+	void SetTransform(const Vector3& position, const Quaternion& rotation, float scale);
+	Vector3 GetPosition() const;
+	Quaternion GetRotation() const;
+	float GetScale() const;
+	bool operator==(const NetActorState& other) const;
+};
+
+// The replicated state of every actor at one tick, sorted by id
+struct NetSnapshot
+{
+	uint32_t mTick = 0;
+	std::vector<NetActorState> mActors;
+};
+
+namespace SnapshotCodec
+{
+	// Writes snapshot as a delta against baseline (a full snapshot if baseline is null).
+	// Only actors that were added, removed or changed since the baseline are written.
+	void Encode(const NetSnapshot& snapshot, const NetSnapshot* baseline, BitWriter& out);
+	// Reads the baseline tick a packet was encoded against, returns false for full snapshots
+	bool PeekBaseline(const uint8_t* data, size_t size, uint32_t& outTick);
+	// Rebuilds the snapshot from a packet and the baseline it names (null for a full snapshot)
+	bool Decode(const uint8_t* data, size_t size, const NetSnapshot* baseline, NetSnapshot& outSnapshot);
+}
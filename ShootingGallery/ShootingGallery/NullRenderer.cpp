@@ -0,0 +1,26 @@
+#include "NullRenderer.hpp"
+
+NullRenderer::NullRenderer(Game* game):Renderer(game)
+{
+}
+
+bool NullRenderer::Initialize(float screenWidth, float screenHeight)
+{
+	mScreenWidth = screenWidth;
+	mScreenHeight = screenHeight;
+
+	// Same matrices as the GL renderer, so Unproject (used for shooting) behaves identically
+	mView = Matrix4::CreateLookAt(Vector3::Zero, Vector3::UnitX, Vector3::UnitZ);
+	mProjection = Matrix4::CreatePerspectiveFOV(Math::ToRadians(70.0f), mScreenWidth, mScreenHeight, 10.0f, 10000.0f);
+
+	return true;
+}
+
+void NullRenderer::Shutdown()
+{
+}
+
+void NullRenderer::Draw()
+{
+	// Nothing is drawn, so GetLastSubmitMs stays 0 (benchmarks leave draw times out of headless results)
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "Renderer.hpp"
+
+// Renderer backend that never creates a window or GL context.
+// Meshes and textures still load their CPU-side data (bounds, radius, vertices),
+// so gameplay and physics can run on machines without a GPU.
+class NullRenderer : public Renderer
+{
+public:
+	NullRenderer(class Game* game);
+
+	bool Initialize(float screenWidth, float screenHeight) override;
+	void Shutdown() override;
+	void Draw() override;
+
+	bool IsHeadless() const override { return true; }
+};
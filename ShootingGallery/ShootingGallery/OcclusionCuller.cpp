@@ -0,0 +1,352 @@
+#include "OcclusionCuller.hpp"
+#include "MeshComponent.hpp"
+#include "Mesh.hpp"
+#include "Actor.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+
+namespace
+{
+	// Boxes have to be this much (in NDC depth) behind an occluder to be hidden
+	const float DepthBias = 1e-6f;
+}
+
+OcclusionCuller::OcclusionCuller(int width, int height)
+	:mWidth(width), mHeight(height), mTilesX((width + TileSize - 1) / TileSize), mTilesY((height + TileSize - 1) / TileSize), mNumTested(0), mNumCulled(0)
+{
+	mDepth.assign(mWidth * mHeight, 1.0f);
+	mTileMaxDepth.assign(mTilesX * mTilesY, 1.0f);
+}
+
+void OcclusionCuller::SetOccluders(const std::vector<MeshComponent*>& meshes, float minSize)
+{
+	mOccluders.clear();
+	for (auto mc : meshes)
+	{
+		Mesh* mesh = mc->GetMesh();
+		if (mesh == nullptr)
+		{
+			continue;
+		}
+		const Matrix4& world = mc->GetOwner()->GetWorldTransform();
+		const AABB& box = mesh->GetBox();
+
+		Vector3 localSize = box.mMax - box.mMin;
+		Vector3 worldSize = Vector3::Transform(localSize, world, 0.0f);
+		float extent = Math::Max(Math::Abs(worldSize.x), Math::Max(Math::Abs(worldSize.y), Math::Abs(worldSize.z)));
+		if (extent < minSize)
+		{
+			continue;
+		}
+
+		// A flat box is exactly the mesh's outline, so two triangles are enough
+		float sizes[3] = { localSize.x, localSize.y, localSize.z };
+		float maxSize = Math::Max(sizes[0], Math::Max(sizes[1], sizes[2]));
+		int flatAxis = -1;
+		for (int i = 0; i < 3; i++)
+		{
+			if (sizes[i] <= maxSize * 0.001f)
+			{
+				flatAxis = i;
+			}
+		}
+
+		if (flatAxis >= 0)
+		{
+			int u = (flatAxis + 1) % 3;
+			int v = (flatAxis + 2) % 3;
+			Vector3 corners[4];
+			for (int i = 0; i < 4; i++)
+			{
+				float c[3];
+				c[flatAxis] = box.mMin.GetAsFloatPtr()[flatAxis];
+				c[u] = (i == 1 || i == 2) ? box.mMax.GetAsFloatPtr()[u] : box.mMin.GetAsFloatPtr()[u];
+				c[v] = (i >= 2) ? box.mMax.GetAsFloatPtr()[v] : box.mMin.GetAsFloatPtr()[v];
+				corners[i] = Vector3::Transform(Vector3(c[0], c[1], c[2]), world);
+			}
+			mOccluders.insert(mOccluders.end(), { corners[0], corners[1], corners[2], corners[0], corners[2], corners[3] });
+		}
+		else
+		{
+			const std::vector<float>& verts = mesh->GetVertices();
+			const size_t vertSize = mesh->GetVertexSize();
+			for (unsigned int index : mesh->GetIndices())
+			{
+				const float* v = &verts[index * vertSize];
+				mOccluders.emplace_back(Vector3::Transform(Vector3(v[0], v[1], v[2]), world));
+			}
+		}
+	}
+}
+
+void OcclusionCuller::ClearOccluders()
+{
+	mOccluders.clear();
+}
+
+OcclusionCuller::ClipVertex OcclusionCuller::ToClip(const Vector3& pos, const Matrix4& m) const
+{
+	// Row vector times matrix, same as the shaders
+	ClipVertex out;
+	out.x = pos.x * m.mat[0][0] + pos.y * m.mat[1][0] + pos.z * m.mat[2][0] + m.mat[3][0];
+	out.y = pos.x * m.mat[0][1] + pos.y * m.mat[1][1] + pos.z * m.mat[2][1] + m.mat[3][1];
+	out.z = pos.x * m.mat[0][2] + pos.y * m.mat[1][2] + pos.z * m.mat[2][2] + m.mat[3][2];
+	out.w = pos.x * m.mat[0][3] + pos.y * m.mat[1][3] + pos.z * m.mat[2][3] + m.mat[3][3];
+	return out;
+}
+
+void OcclusionCuller::RenderOccluders(const Matrix4& viewProj)
+{
+	PROFILE_SCOPE("OcclusionCuller::RenderOccluders");
+	mViewProj = viewProj;
+	mNumTested = 0;
+	mNumCulled = 0;
+	std::fill(mDepth.begin(), mDepth.end(), 1.0f);
+
+	for (size_t i = 0; i + 2 < mOccluders.size(); i += 3)
+	{
+		RasterizeTriangle(ToClip(mOccluders[i], viewProj), ToClip(mOccluders[i + 1], viewProj), ToClip(mOccluders[i + 2], viewProj));
+	}
+
+	BuildTileMaxDepth();
+}
+
+void OcclusionCuller::RasterizeTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c)
+{
+	// Clip against the near plane (z >= -w), which leaves at most a quad
+	const ClipVertex in[3] = { a, b, c };
+	ClipVertex poly[4];
+	int count = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		const ClipVertex& p = in[i];
+		const ClipVertex& q = in[(i + 1) % 3];
+		float dp = p.z + p.w;
+		float dq = q.z + q.w;
+		if (dp >= 0.0f)
+		{
+			poly[count++] = p;
+		}
+		if ((dp >= 0.0f) != (dq >= 0.0f))
+		{
+			float t = dp / (dp - dq);
+			ClipVertex& r = poly[count++];
+			r.x = p.x + (q.x - p.x) * t;
+			r.y = p.y + (q.y - p.y) * t;
+			r.z = p.z + (q.z - p.z) * t;
+			r.w = p.w + (q.w - p.w) * t;
+		}
+	}
+	if (count < 3)
+	{
+		return;
+	}
+
+	// To pixels, depth is z/w
+	float sx[4], sy[4], sz[4];
+	for (int i = 0; i < count; i++)
+	{
+		float invW = 1.0f / poly[i].w;
+		sx[i] = (poly[i].x * invW * 0.5f + 0.5f) * mWidth;
+		sy[i] = (poly[i].y * invW * 0.5f + 0.5f) * mHeight;
+		sz[i] = poly[i].z * invW;
+	}
+	for (int i = 1; i + 1 < count; i++)
+	{
+		RasterizeScreenTriangle(sx[0], sy[0], sz[0], sx[i], sy[i], sz[i], sx[i + 1], sy[i + 1], sz[i + 1]);
+	}
+}
+
+void OcclusionCuller::RasterizeScreenTriangle(float x0, float y0, float z0, float x1, float y1, float z1, float x2, float y2, float z2)
+{
+	float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+	if (Math::NearZero(area, 1e-6f))
+	{
+		return;
+	}
+	// Occluders are two sided, flip clockwise triangles
+	if (area < 0.0f)
+	{
+		std::swap(x1, x2);
+		std::swap(y1, y2);
+		std::swap(z1, z2);
+		area = -area;
+	}
+
+	int minX = Math::Max(0, static_cast<int>(floorf(Math::Min(x0, Math::Min(x1, x2)))));
+	int maxX = Math::Min(mWidth - 1, static_cast<int>(ceilf(Math::Max(x0, Math::Max(x1, x2)))));
+	int minY = Math::Max(0, static_cast<int>(floorf(Math::Min(y0, Math::Min(y1, y2)))));
+	int maxY = Math::Min(mHeight - 1, static_cast<int>(ceilf(Math::Max(y0, Math::Max(y1, y2)))));
+	if (minX > maxX || minY > maxY)
+	{
+		return;
+	}
+
+	// Edge functions at the first pixel center of each row. Each edge function is linear in x,
+	// so the covered span of a row is solved directly and only covered pixels are visited.
+	// Depth is a plane in screen space, the span loop has no dependencies between pixels and vectorizes.
+	float invArea = 1.0f / area;
+	float px = minX + 0.5f;
+	float dx[3] = { y1 - y2, y2 - y0, y0 - y1 };
+	float dy[3] = { x2 - x1, x0 - x2, x1 - x0 };
+	float rowE[3];
+	float py = minY + 0.5f;
+	rowE[0] = (x2 - x1) * (py - y1) - (y2 - y1) * (px - x1);
+	rowE[1] = (x0 - x2) * (py - y2) - (y0 - y2) * (px - x2);
+	rowE[2] = (x1 - x0) * (py - y0) - (y1 - y0) * (px - x0);
+	float dzdx = (dx[0] * z0 + dx[1] * z1 + dx[2] * z2) * invArea;
+
+	for (int y = minY; y <= maxY; y++)
+	{
+		// e(x) = rowE + dx * (x - minX) >= 0 for all three edges
+		float spanStart = 0.0f;
+		float spanEnd = static_cast<float>(maxX - minX);
+		for (int i = 0; i < 3; i++)
+		{
+			if (dx[i] > 0.0f)
+			{
+				spanStart = Math::Max(spanStart, -rowE[i] / dx[i]);
+			}
+			else if (dx[i] < 0.0f)
+			{
+				spanEnd = Math::Min(spanEnd, -rowE[i] / dx[i]);
+			}
+			else if (rowE[i] < 0.0f)
+			{
+				spanEnd = -1.0f;
+			}
+		}
+
+		if (spanStart <= spanEnd)
+		{
+			int start = minX + static_cast<int>(ceilf(spanStart));
+			int end = minX + static_cast<int>(floorf(spanEnd));
+			float z = (rowE[0] * z0 + rowE[1] * z1 + rowE[2] * z2) * invArea + dzdx * (start - minX);
+			float* row = &mDepth[y * mWidth];
+			for (int x = start; x <= end; x++)
+			{
+				row[x] = Math::Min(row[x], z + dzdx * (x - start));
+			}
+		}
+
+		rowE[0] += dy[0];
+		rowE[1] += dy[1];
+		rowE[2] += dy[2];
+	}
+}
+
+void OcclusionCuller::BuildTileMaxDepth()
+{
+	for (int ty = 0; ty < mTilesY; ty++)
+	{
+		for (int tx = 0; tx < mTilesX; tx++)
+		{
+			float maxDepth = -1.0f;
+			int endY = Math::Min(mHeight, (ty + 1) * TileSize);
+			int endX = Math::Min(mWidth, (tx + 1) * TileSize);
+			for (int y = ty * TileSize; y < endY; y++)
+			{
+				const float* row = &mDepth[y * mWidth];
+				for (int x = tx * TileSize; x < endX; x++)
+				{
+					maxDepth = Math::Max(maxDepth, row[x]);
+				}
+			}
+			mTileMaxDepth[ty * mTilesX + tx] = maxDepth;
+		}
+	}
+}
+
+bool OcclusionCuller::IsVisible(const AABB& box, const Matrix4& world) const
+{
+	return TestBox(box, world * mViewProj);
+}
+
+bool OcclusionCuller::IsVisible(const AABB& worldBox) const
+{
+	return TestBox(worldBox, mViewProj);
+}
+
+bool OcclusionCuller::TestBox(const AABB& box, const Matrix4& worldViewProj) const
+{
+	mNumTested++;
+
+	// Screen rectangle and nearest depth of the box
+	float minX = Math::Infinity, maxX = Math::NegInfinity;
+	float minY = Math::Infinity, maxY = Math::NegInfinity;
+	float minZ = Math::Infinity;
+	int numBehind = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		Vector3 corner((i & 1) ? box.mMax.x : box.mMin.x, (i & 2) ? box.mMax.y : box.mMin.y, (i & 4) ? box.mMax.z : box.mMin.z);
+		ClipVertex clip = ToClip(corner, worldViewProj);
+		if (clip.z + clip.w < 0.0f)
+		{
+			numBehind++;
+			continue;
+		}
+		float invW = 1.0f / clip.w;
+		float sx = (clip.x * invW * 0.5f + 0.5f) * mWidth;
+		float sy = (clip.y * invW * 0.5f + 0.5f) * mHeight;
+		minX = Math::Min(minX, sx);
+		maxX = Math::Max(maxX, sx);
+		minY = Math::Min(minY, sy);
+		maxY = Math::Max(maxY, sy);
+		minZ = Math::Min(minZ, clip.z * invW);
+	}
+
+	// Entirely behind the camera
+	if (numBehind == 8)
+	{
+		mNumCulled++;
+		return false;
+	}
+	// Crosses the near plane, too close to bother
+	if (numBehind > 0)
+	{
+		return true;
+	}
+
+	// Outside the view or beyond the far plane
+	if (maxX < 0.0f || maxY < 0.0f || minX > mWidth || minY > mHeight || minZ > 1.0f)
+	{
+		mNumCulled++;
+		return false;
+	}
+
+	int x0 = Math::Max(0, static_cast<int>(floorf(minX)));
+	int x1 = Math::Min(mWidth - 1, static_cast<int>(floorf(maxX)));
+	int y0 = Math::Max(0, static_cast<int>(floorf(minY)));
+	int y1 = Math::Min(mHeight - 1, static_cast<int>(floorf(maxY)));
+	float threshold = minZ - DepthBias;
+
+	for (int ty = y0 / TileSize; ty <= y1 / TileSize; ty++)
+	{
+		for (int tx = x0 / TileSize; tx <= x1 / TileSize; tx++)
+		{
+			// Every pixel of this tile is in front of the box
+			if (mTileMaxDepth[ty * mTilesX + tx] <= threshold)
+			{
+				continue;
+			}
+			int startY = Math::Max(y0, ty * TileSize);
+			int endY = Math::Min(y1, (ty + 1) * TileSize - 1);
+			int startX = Math::Max(x0, tx * TileSize);
+			int endX = Math::Min(x1, (tx + 1) * TileSize - 1);
+			for (int y = startY; y <= endY; y++)
+			{
+				const float* row = &mDepth[y * mWidth];
+				for (int x = startX; x <= endX; x++)
+				{
+					if (row[x] > threshold)
+					{
+						return true;
+					}
+				}
+			}
+		}
+	}
+
+	mNumCulled++;
+	return false;
+}
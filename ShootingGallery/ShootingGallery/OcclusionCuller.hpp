@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include "Math.hpp"
+#include "Collision.hpp"
+
+// Software occlusion culling.
+// Large static meshes are rasterized into a small CPU depth buffer every frame,
+// and a max-depth tile pyramid on top of it lets most box tests finish after a few tiles.
+// Boxes entirely behind the occluders (or outside the view) are reported as hidden.
+class OcclusionCuller
+{
+public:
+	OcclusionCuller(int width = 256, int height = 192);
+
+	// Static meshes at least minSize units across become occluders.
+	// Flat meshes (like the planes) are reduced to the two triangles of their box.
+	void SetOccluders(const std::vector<class MeshComponent*>& meshes, float minSize = 100.0f);
+	void ClearOccluders();
+
+	// Rasterize the occluders for this frame's camera
+	void RenderOccluders(const Matrix4& viewProj);
+
+	// Test an object space box under a world transform, or a world space box
+	bool IsVisible(const AABB& box, const Matrix4& world) const;
+	bool IsVisible(const AABB& worldBox) const;
+
+	// Counters for the last frame
+	size_t GetNumTested() const { return mNumTested; }
+	size_t GetNumCulled() const { return mNumCulled; }
+	size_t GetNumOccluderTriangles() const { return mOccluders.size() / 3; }
+
+private:
+	struct ClipVertex
+	{
+		float x, y, z, w;
+	};
+
+	ClipVertex ToClip(const Vector3& pos, const Matrix4& worldViewProj) const;
+	bool TestBox(const AABB& box, const Matrix4& worldViewProj) const;
+	void RasterizeTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c);
+	void RasterizeScreenTriangle(float x0, float y0, float z0, float x1, float y1, float z1, float x2, float y2, float z2);
+	void BuildTileMaxDepth();
+
+	static const int TileSize = 8;
+
+	int mWidth;
+	int mHeight;
+	int mTilesX;
+	int mTilesY;
+	// NDC depth (z/w), smaller is closer. Cleared to 1 (far plane).
+	std::vector<float> mDepth;
+	// Farthest depth in each tile
+	std::vector<float> mTileMaxDepth;
+
+	// World space occluder triangles
+	std::vector<Vector3> mOccluders;
+	Matrix4 mViewProj;
+
+	mutable size_t mNumTested;
+	mutable size_t mNumCulled;
+};
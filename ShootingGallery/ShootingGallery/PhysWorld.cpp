@@ -1,51 +1,195 @@
 #include "PhysWorld.hpp"
 #include <algorithm>
 #include "BoxComponent.hpp"
+#include "Actor.hpp"
 #include <SDL.h>
+#include "Profiler.hpp"
 
-PhysWorld::PhysWorld(Game* game):mGame(game)
+PhysWorld::PhysWorld(Game* game):mGame(game), mCollisionTime(0), mDroppedHits(0), mHistoryCapacity(0), mNextTick(0), mRecordedTicks(0)
 {
 }
 
-bool PhysWorld::SegmentCast(const LineSegment& l, CollisionInfo& outColl)
+PhysWorld::CollisionTimer::CollisionTimer(PhysWorld* phys):mPhys(phys), mStart(Profiler::GetTime())
 {
+}
+
+PhysWorld::CollisionTimer::~CollisionTimer()
+{
+	mPhys->mCollisionTime += Profiler::GetTime() - mStart;
+}
+
+bool PhysWorld::SegmentCast(const LineSegment& l, CollisionInfo& outColl, Actor* ignoreActor)
+{
+	PROFILE_SCOPE("PhysWorld::SegmentCast");
+	CollisionTimer timer(this);
 	bool collided = false;
 	float closestT = Math::Infinity;
-	Vector3 norm;
 	// Test against all boxes.
 	for (auto box : mBoxes)
 	{
-		float t;
-		// Does the segment intersect with the box?
-		if (Intersect(l, box->GetWorldBox(), t, norm))
+		if (box->GetOwner() != ignoreActor)
+		{
+			TestBox(l, box->GetWorldBox(), box, closestT, outColl, collided);
+		}
+	}
+	for (auto box : mStaticBoxes)
+	{
+		if (box->GetOwner() != ignoreActor)
+		{
+			TestBox(l, box->GetWorldBox(), box, closestT, outColl, collided);
+		}
+	}
+	return collided;
+}
+
+bool PhysWorld::SegmentCastAtTick(const LineSegment& l, uint32_t tick, CollisionInfo& outColl, Actor* ignoreActor)
+{
+	if (mRecordedTicks == 0)
+	{
+		return SegmentCast(l, outColl, ignoreActor);
+	}
+
+	PROFILE_SCOPE("PhysWorld::SegmentCastAtTick");
+	CollisionTimer timer(this);
+	tick = Math::Clamp(tick, mNextTick - mRecordedTicks, mNextTick - 1);
+	size_t base = (tick % HistoryTicks) * mHistoryCapacity;
+	bool collided = false;
+	float closestT = Math::Infinity;
+	for (size_t i = 0; i < mBoxes.size(); i++)
+	{
+		if (mFirstTick[i] <= tick && mBoxes[i]->GetOwner() != ignoreActor)
+		{
+			TestBox(l, AABB(mHistoryMin[base + i], mHistoryMax[base + i]), mBoxes[i], closestT, outColl, collided);
+		}
+	}
+	for (auto box : mStaticBoxes)
+	{
+		if (box->GetOwner() != ignoreActor)
 		{
-			// Is this closer than previous intersection?
-			if (t < closestT)
-			{
-				outColl.mPoint = l.PointOnSegment(t);
-				outColl.mNormal = norm;
-				outColl.mBox = box;
-				outColl.mActor = box->GetOwner();
-				collided = true;
-			}
+			TestBox(l, box->GetWorldBox(), box, closestT, outColl, collided);
 		}
 	}
 	return collided;
 }
 
+void PhysWorld::PushHit(const HitEvent& hit)
+{
+	if (!mHits.Push(hit))
+	{
+		mDroppedHits++;
+	}
+}
+
+void PhysWorld::TestBox(const LineSegment& l, const AABB& worldBox, BoxComponent* box, float& closestT, CollisionInfo& outColl, bool& collided)
+{
+	float t;
+	Vector3 norm;
+	// Does the segment intersect with the box, closer than the previous intersection?
+	if (Intersect(l, worldBox, t, norm) && t < closestT)
+	{
+		closestT = t;
+		outColl.mPoint = l.PointOnSegment(t);
+		outColl.mNormal = norm;
+		outColl.mBox = box;
+		outColl.mActor = box->GetOwner();
+		collided = true;
+	}
+}
+
+void PhysWorld::RecordHistory(uint32_t tick)
+{
+	PROFILE_SCOPE("PhysWorld::RecordHistory");
+	size_t base = (tick % HistoryTicks) * mHistoryCapacity;
+	for (size_t i = 0; i < mBoxes.size(); i++)
+	{
+		const AABB& box = mBoxes[i]->GetWorldBox();
+		mHistoryMin[base + i] = box.mMin;
+		mHistoryMax[base + i] = box.mMax;
+	}
+	mNextTick = tick + 1;
+	if (mRecordedTicks < HistoryTicks)
+	{
+		mRecordedTicks++;
+	}
+}
 
 void PhysWorld::AddBox(BoxComponent* box)
 {
+	if (mBoxes.size() == mHistoryCapacity)
+	{
+		GrowHistory(Math::Max(mHistoryCapacity * 2, static_cast<size_t>(64)));
+	}
 	mBoxes.emplace_back(box);
+	// Not recorded yet, so it didn't exist for any earlier tick
+	mFirstTick.emplace_back(mNextTick);
 }
 
 void PhysWorld::RemoveBox(BoxComponent* box)
 {
 	auto iter = std::find(mBoxes.begin(), mBoxes.end(), box);
 	if (iter != mBoxes.end())
+	{
+		RemoveMovingBox(iter - mBoxes.begin());
+		return;
+	}
+	iter = std::find(mStaticBoxes.begin(), mStaticBoxes.end(), box);
+	if (iter != mStaticBoxes.end())
 	{
 		// Swap to end of vector and pop off (avoid erase copies)
-		std::iter_swap(iter, mBoxes.end() - 1);
-		mBoxes.pop_back();
+		std::iter_swap(iter, mStaticBoxes.end() - 1);
+		mStaticBoxes.pop_back();
+	}
+}
+
+void PhysWorld::ReserveBoxes(size_t count)
+{
+	mBoxes.reserve(mBoxes.size() + count);
+	mFirstTick.reserve(mBoxes.size() + count);
+	if (mBoxes.size() + count > mHistoryCapacity)
+	{
+		GrowHistory(mBoxes.size() + count);
+	}
+}
+
+void PhysWorld::SeparateStaticBoxes()
+{
+	for (size_t i = mBoxes.size(); i > 0; i--)
+	{
+		BoxComponent* box = mBoxes[i - 1];
+		if (box->GetOwner()->IsStatic())
+		{
+			mStaticBoxes.emplace_back(box);
+			RemoveMovingBox(i - 1);
+		}
+	}
+}
+
+void PhysWorld::GrowHistory(size_t capacity)
+{
+	std::vector<Vector3> historyMin(capacity * HistoryTicks);
+	std::vector<Vector3> historyMax(capacity * HistoryTicks);
+	for (size_t slot = 0; slot < HistoryTicks; slot++)
+	{
+		std::copy_n(mHistoryMin.begin() + slot * mHistoryCapacity, mBoxes.size(), historyMin.begin() + slot * capacity);
+		std::copy_n(mHistoryMax.begin() + slot * mHistoryCapacity, mBoxes.size(), historyMax.begin() + slot * capacity);
+	}
+	mHistoryMin.swap(historyMin);
+	mHistoryMax.swap(historyMax);
+	mHistoryCapacity = capacity;
+}
+
+void PhysWorld::RemoveMovingBox(size_t index)
+{
+	// Swap the last box (and its history) into the hole
+	size_t last = mBoxes.size() - 1;
+	for (size_t slot = 0; slot < HistoryTicks; slot++)
+	{
+		size_t base = slot * mHistoryCapacity;
+		mHistoryMin[base + index] = mHistoryMin[base + last];
+		mHistoryMax[base + index] = mHistoryMax[base + last];
 	}
+	mBoxes[index] = mBoxes[last];
+	mFirstTick[index] = mFirstTick[last];
+	mBoxes.pop_back();
+	mFirstTick.pop_back();
 }
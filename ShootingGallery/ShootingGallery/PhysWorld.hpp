@@ -1,8 +1,10 @@
 #pragma once
 #include <vector>
 #include <functional>
+#include <cstdint>
 #include "Math.hpp"
 #include "Collision.hpp"
+#include "MPSCQueue.hpp"
 
 class PhysWorld
 {
@@ -22,14 +24,88 @@ public:
 	};
 
 	// Test a line segment against boxes
-	// Returns true if it collides against a box
-	bool SegmentCast(const LineSegment& l, CollisionInfo& outColl);
+	// Returns true if it collides against a box, outColl holds the closest hit.
+	// Boxes owned by ignoreActor are skipped.
+	bool SegmentCast(const LineSegment& l, CollisionInfo& outColl, class Actor* ignoreActor = nullptr);
+	// Same test against the moving boxes as they were at the end of tick (for lag compensation).
+	// The tick is clamped to the recorded history, boxes created after it are skipped.
+	bool SegmentCastAtTick(const LineSegment& l, uint32_t tick, CollisionInfo& outColl, class Actor* ignoreActor = nullptr);
+
+	// Moving boxes' world boxes are kept for this many ticks (about half a second at 60 Hz)
+	static const uint32_t HistoryTicks = 32;
+	// Stores every moving box's world box for this tick, call once per tick after everything moved
+	void RecordHistory(uint32_t tick);
+	uint32_t GetNewestTick() const { return mNextTick > 0 ? mNextTick - 1 : 0; }
 
 	// Add/remove box components from world
 	void AddBox(class BoxComponent* box);
 	void RemoveBox(class BoxComponent* box);
+	void ReserveBoxes(size_t count);
+	// Moves the boxes of static actors out of the history, call after the level is baked
+	void SeparateStaticBoxes();
+
+	// A ball hitting something, reacted to by gameplay after the physics phase
+	struct HitEvent
+	{
+		class Actor* mBall;
+		class Actor* mTarget;
+		Vector3 mPoint;
+		Vector3 mNormal;
+		uint32_t mTick;
+	};
+	// Safe to call from several threads, hits beyond HitQueueSize in one tick are dropped (and counted)
+	void PushHit(const HitEvent& hit);
+	// Calls func(const HitEvent&) for every queued hit in push order, on the game thread
+	template <typename Func>
+	void DispatchHits(Func func)
+	{
+		HitEvent hit;
+		while (mHits.Pop(hit))
+		{
+			func(hit);
+		}
+	}
+	uint64_t GetDroppedHits() const { return mDroppedHits; }
+
+	// Time spent in collision queries since the last reset (in Profiler ticks)
+	uint64_t GetCollisionTime() const { return mCollisionTime; }
+	void ResetCollisionTime() { mCollisionTime = 0; }
+
+	// Adds the lifetime of the scope to the collision time
+	class CollisionTimer
+	{
+	public:
+		CollisionTimer(PhysWorld* phys);
+		~CollisionTimer();
+	private:
+		PhysWorld* mPhys;
+		uint64_t mStart;
+	};
 
 private:
+	// Keeps the hit if it is closer than closestT
+	void TestBox(const LineSegment& l, const AABB& worldBox, class BoxComponent* box, float& closestT, CollisionInfo& outColl, bool& collided);
+	void GrowHistory(size_t capacity);
+	void RemoveMovingBox(size_t index);
+
 	class Game* mGame;
+	uint64_t mCollisionTime;
+	static const size_t HitQueueSize = 1024;
+	MPSCQueue<HitEvent, HitQueueSize> mHits;
+	std::atomic<uint64_t> mDroppedHits;
+	// Boxes that can move, in the same order as their history
 	std::vector<class BoxComponent*> mBoxes;
+	// Boxes of static actors never move, so they have no history
+	std::vector<class BoxComponent*> mStaticBoxes;
+
+	// Ring of HistoryTicks slots, slot (tick % HistoryTicks) starts at slot * mHistoryCapacity.
+	// Corners are stored in separate arrays so a query walks two flat arrays of one tick.
+	// Only grows with the number of moving boxes, recording and queries never allocate.
+	std::vector<Vector3> mHistoryMin;
+	std::vector<Vector3> mHistoryMax;
+	// First tick each moving box was recorded on
+	std::vector<uint32_t> mFirstTick;
+	size_t mHistoryCapacity;
+	uint32_t mNextTick;
+	uint32_t mRecordedTicks;
 };
\ No newline at end of file
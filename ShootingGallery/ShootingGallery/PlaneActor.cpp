@@ -5,11 +5,11 @@
 #include "BoxComponent.hpp"
 #include "Mesh.hpp"
 
-PlaneActor::PlaneActor(Game* game):Actor(game)
+PlaneActor::PlaneActor(Game* game):Actor(game, EPlane)
 {
 	SetScale(10.0f);
 	MeshComponent* mc = new MeshComponent(this);
-	Mesh* mesh = GetGame()->GetRenderer()->GetMesh("Assets/Plane.gpmesh");
+	AssetHandle<Mesh> mesh = GetGame()->GetRenderer()->GetMesh("Assets/Plane.gpmesh");
 	mc->SetMesh(mesh);
 	// Add collision box
 	mBox = new BoxComponent(this);
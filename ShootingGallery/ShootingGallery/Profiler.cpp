@@ -0,0 +1,169 @@
+#include "Profiler.hpp"
+#include <SDL.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <algorithm>
+#include <cstdint>
+
+namespace
+{
+	const size_t ZoneCapacity = 1 << 16;
+	const size_t FrameHistory = 120;
+	const size_t GpuCapacity = 1 << 13;
+
+	// Single producer ring buffer, only the owning thread writes to it.
+	// When full the oldest zones are overwritten.
+	struct ThreadBuffer
+	{
+		ThreadBuffer(int threadID):mThreadID(threadID), mCount(0) {}
+
+		Profiler::ZoneEvent mEvents[ZoneCapacity];
+		int mThreadID;
+		std::atomic<uint64_t> mCount;
+	};
+
+	struct GpuSample
+	{
+		const char* mName;
+		uint64_t mTime;
+		double mMilliseconds;
+	};
+
+	// Only touched the first time a thread records a zone, and when exporting
+	std::mutex sRegistryMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> sThreadBuffers;
+
+	std::mutex sGpuMutex;
+	std::vector<GpuSample> sGpuSamples;
+	size_t sGpuCount = 0;
+
+	ThreadBuffer* GetThreadBuffer()
+	{
+		thread_local ThreadBuffer* buffer = nullptr;
+		if (buffer == nullptr)
+		{
+			std::lock_guard<std::mutex> lock(sRegistryMutex);
+			sThreadBuffers.emplace_back(new ThreadBuffer(static_cast<int>(sThreadBuffers.size())));
+			buffer = sThreadBuffers.back().get();
+		}
+		return buffer;
+	}
+
+	double ToMicroseconds(uint64_t ticks)
+	{
+		return Profiler::ToMilliseconds(ticks) * 1000.0;
+	}
+}
+
+std::vector<float> Profiler::sFrameTimes(FrameHistory, 0.0f);
+size_t Profiler::sFrameIndex = 0;
+uint64_t Profiler::sLastFrameTime = 0;
+
+uint64_t Profiler::GetTime()
+{
+	return SDL_GetPerformanceCounter();
+}
+
+double Profiler::ToMilliseconds(uint64_t ticks)
+{
+	static const double frequency = static_cast<double>(SDL_GetPerformanceFrequency());
+	return ticks * 1000.0 / frequency;
+}
+
+void Profiler::RecordZone(const char* name, uint64_t start, uint64_t end)
+{
+	ThreadBuffer* buffer = GetThreadBuffer();
+	uint64_t count = buffer->mCount.load(std::memory_order_relaxed);
+	ZoneEvent& e = buffer->mEvents[count % ZoneCapacity];
+	e.mName = name;
+	e.mStart = start;
+	e.mEnd = end;
+	// Publish the event to readers
+	buffer->mCount.store(count + 1, std::memory_order_release);
+}
+
+void Profiler::RecordGpuTime(const char* name, double milliseconds)
+{
+	std::lock_guard<std::mutex> lock(sGpuMutex);
+	GpuSample sample{ name, GetTime(), milliseconds };
+	if (sGpuSamples.size() < GpuCapacity)
+	{
+		sGpuSamples.emplace_back(sample);
+	}
+	else
+	{
+		sGpuSamples[sGpuCount % GpuCapacity] = sample;
+	}
+	sGpuCount++;
+}
+
+void Profiler::EndFrame()
+{
+	uint64_t now = GetTime();
+	if (sLastFrameTime != 0)
+	{
+		sFrameIndex = (sFrameIndex + 1) % sFrameTimes.size();
+		sFrameTimes[sFrameIndex] = static_cast<float>(ToMilliseconds(now - sLastFrameTime));
+	}
+	sLastFrameTime = now;
+}
+
+bool Profiler::ExportChromeTrace(const std::string& fileName)
+{
+	std::ofstream file(fileName);
+	if (!file.is_open())
+	{
+		SDL_Log("Failed to write trace %s", fileName.c_str());
+		return false;
+	}
+
+	// Timestamps are relative to the earliest recorded zone
+	uint64_t base = UINT64_MAX;
+	std::lock_guard<std::mutex> lock(sRegistryMutex);
+	for (auto& buffer : sThreadBuffers)
+	{
+		uint64_t count = buffer->mCount.load(std::memory_order_acquire);
+		uint64_t first = count > ZoneCapacity ? count - ZoneCapacity : 0;
+		for (uint64_t i = first; i < count; i++)
+		{
+			base = std::min(base, buffer->mEvents[i % ZoneCapacity].mStart);
+		}
+	}
+	if (base == UINT64_MAX)
+	{
+		base = 0;
+	}
+
+	file << "{\"traceEvents\":[\n";
+	bool firstEvent = true;
+	for (auto& buffer : sThreadBuffers)
+	{
+		uint64_t count = buffer->mCount.load(std::memory_order_acquire);
+		uint64_t first = count > ZoneCapacity ? count - ZoneCapacity : 0;
+		for (uint64_t i = first; i < count; i++)
+		{
+			const ZoneEvent& e = buffer->mEvents[i % ZoneCapacity];
+			file << (firstEvent ? "" : ",\n");
+			file << "{\"name\":\"" << e.mName << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->mThreadID
+				<< ",\"ts\":" << ToMicroseconds(e.mStart - base) << ",\"dur\":" << ToMicroseconds(e.mEnd - e.mStart) << "}";
+			firstEvent = false;
+		}
+	}
+
+	std::lock_guard<std::mutex> gpuLock(sGpuMutex);
+	for (auto& sample : sGpuSamples)
+	{
+		if (sample.mTime < base)
+		{
+			continue;
+		}
+		file << (firstEvent ? "" : ",\n");
+		file << "{\"name\":\"GPU " << sample.mName << "\",\"ph\":\"C\",\"pid\":0,\"ts\":" << ToMicroseconds(sample.mTime - base)
+			<< ",\"args\":{\"ms\":" << sample.mMilliseconds << "}}";
+		firstEvent = false;
+	}
+	file << "\n]}\n";
+	return true;
+}
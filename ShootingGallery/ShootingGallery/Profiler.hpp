@@ -0,0 +1,64 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Scoped CPU zones are compiled in for debug builds,
+// release builds opt in by defining SG_PROFILE.
+#if !defined(NDEBUG) && !defined(SG_PROFILE)
+#define SG_PROFILE
+#endif
+
+class Profiler
+{
+public:
+	struct ZoneEvent
+	{
+		const char* mName;
+		uint64_t mStart;
+		uint64_t mEnd;
+	};
+
+	// High resolution timestamp used for zones and frame times
+	static uint64_t GetTime();
+	static double ToMilliseconds(uint64_t ticks);
+
+	// Records a finished zone into the calling thread's ring buffer (no locks).
+	// name must be a string literal (only the pointer is stored).
+	static void RecordZone(const char* name, uint64_t start, uint64_t end);
+	// Records a GPU pass time (from timer queries) as a counter
+	static void RecordGpuTime(const char* name, double milliseconds);
+
+	// Called once per frame by the game loop, keeps a rolling frame time history
+	static void EndFrame();
+	static const std::vector<float>& GetFrameTimes() { return sFrameTimes; }
+	static size_t GetFrameIndex() { return sFrameIndex; }
+
+	// Writes all buffered zones as a Chrome trace (chrome://tracing, Perfetto)
+	static bool ExportChromeTrace(const std::string& fileName);
+
+private:
+	static std::vector<float> sFrameTimes;
+	static size_t sFrameIndex;
+	static uint64_t sLastFrameTime;
+};
+
+// RAII marker, use through PROFILE_SCOPE so it compiles out in release
+class ProfileScope
+{
+public:
+	ProfileScope(const char* name):mName(name), mStart(Profiler::GetTime()) {}
+	~ProfileScope() { Profiler::RecordZone(mName, mStart, Profiler::GetTime()); }
+private:
+	const char* mName;
+	uint64_t mStart;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef SG_PROFILE
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#endif
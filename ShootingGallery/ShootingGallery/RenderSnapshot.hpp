@@ -0,0 +1,45 @@
+#pragma once
+#include <vector>
+#include "Math.hpp"
+#include "Renderer.hpp"
+
+// One mesh of a snapshot, with its LOD already picked by the simulation
+struct MeshDraw
+{
+	Matrix4 mWorld;
+	class Mesh* mMesh;
+	class Texture* mTexture;
+	size_t mLOD;
+};
+
+// One sprite of a snapshot
+struct SpriteDraw
+{
+	// Includes the scale to the texture size
+	Matrix4 mWorld;
+	class Texture* mTexture;
+};
+
+// Everything the renderer needs to draw one frame, copied from the simulation at the end of a tick.
+// The render thread only ever reads a snapshot, never actors or components, so the simulation can
+// move on to the next frame while this one is drawn. The vectors keep their capacity between frames.
+struct RenderSnapshot
+{
+	Matrix4 mView;
+	Vector3 mCameraPos;
+	Vector3 mAmbientLight;
+	DirectionalLight mDirLight;
+	std::vector<PointLight> mPointLights;
+
+	std::vector<MeshDraw> mMeshes;
+	// In draw order
+	std::vector<SpriteDraw> mSprites;
+	// Oldest first, only filled while the frame graph is shown
+	std::vector<float> mFrameTimes;
+
+	bool mOcclusionCulling;
+	bool mDepthPrepass;
+	bool mSortFrontToBack;
+	bool mShowOverdraw;
+	bool mShowFrameGraph;
+};
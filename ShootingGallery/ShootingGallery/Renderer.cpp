@@ -2,18 +2,42 @@
 #include "Texture.hpp"
 #include "Mesh.hpp"
 #include <algorithm>
+#include <future>
 #include "Shader.hpp"
 #include "VertexArray.hpp"
 #include "SpriteComponent.hpp"
 #include "MeshComponent.hpp"
+#include "Profiler.hpp"
+#include "StaticGeometry.hpp"
+#include "IndirectBatch.hpp"
+#include "OcclusionCuller.hpp"
+#include "ShaderCache.hpp"
+#include "RenderSnapshot.hpp"
+#include "Actor.hpp"
+#include "TextureStreamer.hpp"
 #include <GL/glew.h>
 
-Renderer::Renderer(Game* game):mGame(game), mSpriteShader(nullptr), mMeshShader(nullptr)
+const int Renderer::MaxPointLights;
+
+Renderer::Renderer(Game* game):mTextures([this](const std::string& fileName) { return LoadTexture(fileName); }, [this](Texture* texture) { UnloadTexture(texture); }), mMeshes([this](const std::string& fileName) { return LoadMesh(fileName); }, [this](Mesh* mesh) { UnloadMesh(mesh); }), mCPUBudget(64 * 1024 * 1024), mGPUBudget(256 * 1024 * 1024), mStreamer(nullptr), mTextureStreaming(true), mVRAMBudget(128 * 1024 * 1024), mStaticGeometry(new StaticGeometry()), mUseIndirect(false), mCompactVertices(false), mOptimizeMeshes(true), mIndirectBatch(nullptr), mIndirectShader(nullptr), mCuller(new OcclusionCuller()), mOcclusionCulling(true), mDepthPrepass(false), mSortFrontToBack(false), mShowOverdraw(false), mOverdrawShader(nullptr), mIndirectDepthShader(nullptr), mIndirectOverdrawShader(nullptr), mGame(game), mSpriteShader(nullptr), mMeshShader(nullptr), mShaderCache(nullptr), mUseShaderCache(true), mLitShader(nullptr), mLitIndirectShader(nullptr), mLitLightCount(-1), mGpuTimerFrame(0), mGpuTimerFramesIssued(0), mLastSubmitMs(0.0), mShowFrameGraph(false), mGraphTexture(nullptr), mGraphSlowTexture(nullptr), mWriteSlot(0), mReadSlot(2), mReadySlot(1), mRenderThreadQuit(false), mRenderWake(nullptr)
 {
+	for (int i = 0; i < 3; i++)
+	{
+		mSnapshots[i] = new RenderSnapshot();
+	}
+	// Snapshots still waiting for the render thread may point at assets that lost their last handle
+	mTextures.SetEvictionDelay(3);
+	mMeshes.SetEvictionDelay(3);
 }
 
 Renderer::~Renderer()
 {
+	delete mStaticGeometry;
+	delete mCuller;
+	for (int i = 0; i < 3; i++)
+	{
+		delete mSnapshots[i];
+	}
 }
 
 bool Renderer::Initialize(float screenWidth, float screenHeight)
@@ -22,7 +46,7 @@ bool Renderer::Initialize(float screenWidth, float screenHeight)
 	mScreenHeight = screenHeight;
 
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, mUseIndirect ? 4 : 3);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
 	SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
 	SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
@@ -41,6 +65,17 @@ bool Renderer::Initialize(float screenWidth, float screenHeight)
 	}
 
 	mContext = SDL_GL_CreateContext(mWindow);
+	if (!mContext && mUseIndirect)
+	{
+		SDL_Log("No GL 4.3 context (%s), falling back to 3.3", SDL_GetError());
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+		mContext = SDL_GL_CreateContext(mWindow);
+	}
+	if (!mContext)
+	{
+		SDL_Log("Failed to create GL context: %s", SDL_GetError());
+		return false;
+	}
 
 	glewExperimental = GL_TRUE;
 	if (glewInit() != GLEW_OK)
@@ -50,19 +85,74 @@ bool Renderer::Initialize(float screenWidth, float screenHeight)
 	}
 	glGetError();
 
+	uint64_t shaderStart = Profiler::GetTime();
+	if (mUseShaderCache)
+	{
+		mShaderCache = new ShaderCache();
+		mShaderCache->Initialize();
+	}
 	if (!LoadShaders())
 	{
 		SDL_Log("Failed to load shaders.");
 		return false;
 	}
 
+	if (mUseIndirect)
+	{
+		if (IndirectBatch::IsSupported())
+		{
+			mIndirectShader = new Shader();
+			mIndirectDepthShader = new Shader();
+			mIndirectOverdrawShader = new Shader();
+			if (mIndirectShader->Load("Shaders/PhongIndirect.vert", "Shaders/Phong.frag", {}, mShaderCache) &&
+				mIndirectDepthShader->Load("Shaders/PhongIndirect.vert", "Shaders/SimpleDepth.frag", {}, mShaderCache) &&
+				mIndirectOverdrawShader->Load("Shaders/PhongIndirect.vert", "Shaders/Overdraw.frag", {}, mShaderCache))
+			{
+				mIndirectBatch = new IndirectBatch();
+			}
+			else
+			{
+				mIndirectShader->Unload();
+				delete mIndirectShader;
+				mIndirectShader = nullptr;
+				mIndirectDepthShader->Unload();
+				delete mIndirectDepthShader;
+				mIndirectDepthShader = nullptr;
+				mIndirectOverdrawShader->Unload();
+				delete mIndirectOverdrawShader;
+				mIndirectOverdrawShader = nullptr;
+			}
+		}
+		SDL_Log("Multi-draw-indirect %s (GL %s)", mIndirectBatch ? "enabled" : "unavailable, using the GL 3.3 path",
+			reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+	}
+	LogShaderLoad(shaderStart);
+
 	CreateSpriteVerts();
+	CreateGpuTimers();
+
+	// 1x1 textures for the frame time graph bars
+	const unsigned char green[] = { 0, 220, 0, 200 };
+	mGraphTexture = new Texture();
+	mGraphTexture->CreateFromPixels(green, 1, 1);
+	const unsigned char red[] = { 220, 0, 0, 200 };
+	mGraphSlowTexture = new Texture();
+	mGraphSlowTexture->CreateFromPixels(red, 1, 1);
+
+	if (mTextureStreaming)
+	{
+		mStreamer = new TextureStreamer([this](std::function<void()> command) { RunOnRenderThread(command, false); },
+			[this](AssetID id) { mTextures.UpdateBytes(id); }, mVRAMBudget);
+	}
 
 	return true;
 }
 
 void Renderer::Shutdown()
 {
+	StopRenderThread();
+	delete mStreamer;
+	mStreamer = nullptr;
 	delete mSpriteVerts;
 	mSpriteShader->Unload();
 	delete mSpriteShader;
@@ -70,63 +160,460 @@ void Renderer::Shutdown()
 	delete mMeshShader;
 	simpleDepthShader->Unload();
 	delete simpleDepthShader;
+	mOverdrawShader->Unload();
+	delete mOverdrawShader;
+	for (auto i : mShaderVariants)
+	{
+		if (i.second)
+		{
+			i.second->Unload();
+			delete i.second;
+		}
+	}
+	mShaderVariants.clear();
+	mLitShader = nullptr;
+	mLitIndirectShader = nullptr;
+	mLitLightCount = -1;
+	delete mShaderCache;
+	mShaderCache = nullptr;
+	if (mIndirectBatch)
+	{
+		delete mIndirectBatch;
+		mIndirectBatch = nullptr;
+		mIndirectShader->Unload();
+		delete mIndirectShader;
+		mIndirectShader = nullptr;
+		mIndirectDepthShader->Unload();
+		delete mIndirectDepthShader;
+		mIndirectDepthShader = nullptr;
+		mIndirectOverdrawShader->Unload();
+		delete mIndirectOverdrawShader;
+		mIndirectOverdrawShader = nullptr;
+	}
+	mGraphTexture->Unload();
+	delete mGraphTexture;
+	mGraphSlowTexture->Unload();
+	delete mGraphSlowTexture;
+	glDeleteQueries(NumTimerFrames * NumGpuPasses, &mGpuTimers[0][0]);
 	SDL_GL_DeleteContext(mContext);
 	SDL_DestroyWindow(mWindow);
 }
 
 void Renderer::UnloadData()
 {
-	for (auto i : mTextures)
+	mStaticGeometry->Unload();
+	mCuller->ClearOccluders();
+	if (mIndirectBatch)
 	{
-		i.second->Unload();
-		delete i.second;
+		mIndirectBatch->Unload();
 	}
-	mTextures.clear();
 
-	for (auto i : mMeshes)
+	// Meshes first, they hold references to their textures
+	mMeshes.Clear();
+	mTextures.Clear();
+}
+
+void Renderer::Draw()
+{
+	PROFILE_SCOPE("Renderer::Draw");
+	uint64_t start = Profiler::GetTime();
+	RenderSnapshot& snapshot = *mSnapshots[mWriteSlot];
+	BuildSnapshot(snapshot);
+
+	if (IsRenderThreadRunning())
 	{
-		i.second->Unload();
-		delete i.second;
+		// Hand the snapshot over and take back whichever slot the render thread isn't using
+		mWriteSlot = mReadySlot.exchange(mWriteSlot | NewSnapshotBit, std::memory_order_acq_rel) & ~NewSnapshotBit;
+		SDL_SemPost(mRenderWake);
+		mLastSubmitMs = Profiler::ToMilliseconds(Profiler::GetTime() - start);
+		return;
 	}
-	mMeshes.clear();
+
+	RenderFrame(snapshot);
+	mLastSubmitMs = Profiler::ToMilliseconds(Profiler::GetTime() - start);
+	SDL_GL_SwapWindow(mWindow);
 }
 
-void Renderer::Draw()
+void Renderer::BuildSnapshot(RenderSnapshot& snapshot)
+{
+	PROFILE_SCOPE("Renderer::BuildSnapshot");
+	Matrix4 invView = mView;
+	invView.Invert();
+	snapshot.mView = mView;
+	snapshot.mCameraPos = invView.GetTranslation();
+	snapshot.mAmbientLight = mAmbientLight;
+	snapshot.mDirLight = mDirLight;
+	snapshot.mPointLights = pointLights;
+
+	snapshot.mOcclusionCulling = mOcclusionCulling;
+	snapshot.mDepthPrepass = mDepthPrepass;
+	snapshot.mSortFrontToBack = mSortFrontToBack;
+	snapshot.mShowOverdraw = mShowOverdraw;
+	snapshot.mShowFrameGraph = mShowFrameGraph;
+
+	// Projected radius in pixels of a unit sphere at distance 1
+	float pixelsPerUnit = mProjection.mat[1][1] * mScreenHeight * 0.5f;
+	snapshot.mMeshes.clear();
+	auto gather = [this, &snapshot, pixelsPerUnit](MeshComponent& mc)
+	{
+		if (mc.IsBaked())
+		{
+			// Drawn from mStaticGeometry, but its textures still stream by distance
+			if (mStreamer)
+			{
+				mc.RequestTextureDetail(snapshot.mCameraPos, pixelsPerUnit);
+			}
+			return;
+		}
+		Mesh* mesh = mc.GetMesh();
+		if (mc.GetVisible() && mesh)
+		{
+			mc.SelectLOD(snapshot.mCameraPos, pixelsPerUnit);
+			if (mStreamer)
+			{
+				mc.RequestTextureDetail(snapshot.mCameraPos, pixelsPerUnit);
+			}
+			MeshDraw draw = { mc.GetOwner()->GetWorldTransform(), mesh, mesh->GetTexture(mc.GetTextureIndex()), mc.GetLOD() };
+			snapshot.mMeshes.emplace_back(draw);
+		}
+	};
+	ComponentPool<MeshComponent>::Get(mGame).ForEach(gather);
+	for (auto mc : mUnpooledMeshComps)
+	{
+		gather(*mc);
+	}
+
+	snapshot.mSprites.clear();
+	for (auto sprite : mSprites)
+	{
+		if (sprite->GetVisible() && sprite->GetTexture())
+		{
+			Matrix4 world = Matrix4::CreateScale(static_cast<float>(sprite->GetTexWidth()), static_cast<float>(sprite->GetTexHeight()), 1.0f);
+			world *= sprite->GetOwner()->GetWorldTransform();
+			// Sprites are drawn one texel per pixel
+			sprite->GetTexture()->RequestPixels(static_cast<float>(Math::Max(sprite->GetTexWidth(), sprite->GetTexHeight())));
+			SpriteDraw draw = { world, sprite->GetTexture() };
+			snapshot.mSprites.emplace_back(draw);
+		}
+	}
+
+	snapshot.mFrameTimes.clear();
+	if (mShowFrameGraph)
+	{
+		const std::vector<float>& frameTimes = Profiler::GetFrameTimes();
+		size_t newest = Profiler::GetFrameIndex();
+		for (size_t i = 0; i < frameTimes.size(); i++)
+		{
+			snapshot.mFrameTimes.emplace_back(frameTimes[(newest + 1 + i) % frameTimes.size()]);
+		}
+	}
+}
+
+void Renderer::RenderFrame(const RenderSnapshot& snapshot)
 {
+	PROFILE_SCOPE("Renderer::RenderFrame");
+	ReadGpuTimers();
+
 	//glViewport(0, 0, mScreenWidth, mScreenHeight);
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	// Draw mesh components
-	glEnable(GL_DEPTH_TEST);
-	glDisable(GL_BLEND);
-	mMeshShader->SetActive();
-	mMeshShader->SetMatrixUniform("uViewProj", mView * mProjection);
-	SetLightUniforms(mMeshShader);
-	for (auto mc : mMeshComps)
+	// Occluders are drawn for the current camera before any mesh is submitted
+	OcclusionCuller* culler = nullptr;
+	if (snapshot.mOcclusionCulling)
 	{
-		if (mc->GetVisible())
+		mCuller->RenderOccluders(snapshot.mView * mProjection);
+		culler = mCuller;
+	}
+
+	UpdateLitShaders(snapshot.mPointLights.size());
+
+	// Gather what survives culling once, every mesh pass draws the same list
+	mVisibleMeshes.clear();
+	for (const MeshDraw& draw : snapshot.mMeshes)
+	{
+		if (culler == nullptr || culler->IsVisible(draw.mMesh->GetBox(), draw.mWorld))
 		{
-			mc->Draw(mMeshShader);
+			mVisibleMeshes.emplace_back(&draw);
 		}
 	}
+	if (mIndirectBatch)
+	{
+		mIndirectBatch->Cull(culler);
+	}
+	if (snapshot.mSortFrontToBack)
+	{
+		const Vector3& cameraPos = snapshot.mCameraPos;
+		std::sort(mVisibleMeshes.begin(), mVisibleMeshes.end(), [&cameraPos](const MeshDraw* a, const MeshDraw* b)
+		{
+			return (a->mWorld.GetTranslation() - cameraPos).LengthSq() < (b->mWorld.GetTranslation() - cameraPos).LengthSq();
+		});
+		mStaticGeometry->SortFrontToBack(cameraPos);
+	}
+
+	glEnable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+
+	// Depth only, the shading pass then only passes the nearest fragment of each pixel
+	BeginGpuTimer(EDepthPass);
+	if (snapshot.mDepthPrepass)
+	{
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		DrawMeshPass(simpleDepthShader, mIndirectDepthShader, culler, false, snapshot);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glDepthMask(GL_FALSE);
+		glDepthFunc(GL_EQUAL);
+	}
+	EndGpuTimer();
+
+	// Draw mesh components
+	BeginGpuTimer(EMeshPass);
+	if (snapshot.mShowOverdraw)
+	{
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_ONE, GL_ONE);
+		DrawMeshPass(mOverdrawShader, mIndirectOverdrawShader, culler, false, snapshot);
+	}
+	else
+	{
+		DrawMeshPass(mLitShader, mLitIndirectShader, culler, true, snapshot);
+	}
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LESS);
+	EndGpuTimer();
 
 	// Draw all sprite components
+	BeginGpuTimer(ESpritePass);
 	glDisable(GL_DEPTH_TEST);
 	glEnable(GL_BLEND);
 	glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
 	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
 	mSpriteShader->SetActive();
 	mSpriteVerts->SetActive();
-	for (auto sprite : mSprites)
+	for (const SpriteDraw& sprite : snapshot.mSprites)
+	{
+		mSpriteShader->SetMatrixUniform("uWorldTransform", sprite.mWorld);
+		sprite.mTexture->SetActive();
+		glDrawElements(GL_TRIANGLES, 6, mSpriteVerts->GetIndexType(), nullptr);
+	}
+	if (snapshot.mShowFrameGraph)
 	{
-		if (sprite->GetVisible())
+		DrawFrameGraph(snapshot);
+	}
+	EndGpuTimer();
+
+	mGpuTimerFrame = (mGpuTimerFrame + 1) % NumTimerFrames;
+	mGpuTimerFramesIssued++;
+}
+
+void Renderer::DrawMeshPass(Shader* shader, Shader* indirectShader, const OcclusionCuller* culler, bool lit, const RenderSnapshot& snapshot)
+{
+	Matrix4 viewProj = snapshot.mView * mProjection;
+	if (mIndirectBatch)
+	{
+		indirectShader->SetActive();
+		indirectShader->SetMatrixUniform("uViewProj", viewProj);
+		if (lit)
 		{
-			sprite->Draw(mSpriteShader);
+			SetLightUniforms(indirectShader, snapshot);
 		}
+		mIndirectBatch->Draw(indirectShader);
 	}
 
-	SDL_GL_SwapWindow(mWindow);
+	shader->SetActive();
+	shader->SetMatrixUniform("uViewProj", viewProj);
+	if (lit)
+	{
+		SetLightUniforms(shader, snapshot);
+	}
+	mStaticGeometry->Draw(shader, culler);
+	for (const MeshDraw* draw : mVisibleMeshes)
+	{
+		shader->SetMatrixUniform("uWorldTransform", draw->mWorld);
+		shader->SetFloatUniform("uSpecPower", draw->mMesh->GetSpecPower());
+		if (draw->mTexture)
+		{
+			draw->mTexture->SetActive();
+		}
+		VertexArray* va = draw->mMesh->GetVertexArray();
+		va->SetActive();
+		va->SetFormatUniforms(shader);
+		const Mesh::LOD& lod = draw->mMesh->GetLOD(Math::Min(draw->mLOD, draw->mMesh->GetNumLODs() - 1));
+		glDrawElements(GL_TRIANGLES, lod.mNumIndices, va->GetIndexType(),
+			reinterpret_cast<const void*>(static_cast<size_t>(lod.mFirstIndex) * va->GetIndexSize()));
+	}
+}
+
+void Renderer::DrawFrameGraph(const RenderSnapshot& snapshot)
+{
+	// Sprite shader and quad are already active.
+	// One bar per frame, oldest on the left, red when slower than 60 fps.
+	const float barWidth = 3.0f;
+	const float pixelsPerMs = 4.0f;
+	const float left = -mScreenWidth * 0.5f + 10.0f;
+	const float bottom = -mScreenHeight * 0.5f + 10.0f;
+	for (size_t i = 0; i < snapshot.mFrameTimes.size(); i++)
+	{
+		float ms = snapshot.mFrameTimes[i];
+		float height = Math::Max(1.0f, ms * pixelsPerMs);
+		Matrix4 world = Matrix4::CreateScale(barWidth, height, 1.0f);
+		world *= Matrix4::CreateTranslation(Vector3(left + i * barWidth, bottom + height * 0.5f, 0.0f));
+		mSpriteShader->SetMatrixUniform("uWorldTransform", world);
+		if (ms > 1000.0f / 60.0f)
+		{
+			mGraphSlowTexture->SetActive();
+		}
+		else
+		{
+			mGraphTexture->SetActive();
+		}
+		glDrawElements(GL_TRIANGLES, 6, mSpriteVerts->GetIndexType(), nullptr);
+	}
+}
+
+bool Renderer::StartRenderThread()
+{
+	if (IsHeadless() || IsRenderThreadRunning())
+	{
+		return false;
+	}
+	mRenderWake = SDL_CreateSemaphore(0);
+	if (!mRenderWake)
+	{
+		SDL_Log("Failed to create the render thread semaphore: %s", SDL_GetError());
+		return false;
+	}
+
+	// The context can only be current on one thread at a time
+	SDL_GL_MakeCurrent(mWindow, nullptr);
+	mRenderThreadQuit = false;
+	mRenderThread = std::thread(&Renderer::RenderThreadMain, this);
+	mRenderThreadID = mRenderThread.get_id();
+	SDL_Log("Rendering on a separate thread");
+	return true;
+}
+
+void Renderer::StopRenderThread()
+{
+	if (!IsRenderThreadRunning())
+	{
+		return;
+	}
+	mRenderThreadQuit = true;
+	SDL_SemPost(mRenderWake);
+	mRenderThread.join();
+	mRenderThreadID = std::thread::id();
+	SDL_DestroySemaphore(mRenderWake);
+	mRenderWake = nullptr;
+
+	// Back to the main thread for unloading and shutdown
+	SDL_GL_MakeCurrent(mWindow, mContext);
+}
+
+void Renderer::RenderThreadMain()
+{
+	SDL_GL_MakeCurrent(mWindow, mContext);
+	while (!mRenderThreadQuit)
+	{
+		SDL_SemWait(mRenderWake);
+		RunRenderCommands();
+
+		// Several posts can arrive for one snapshot, only draw when there is a new one
+		if ((mReadySlot.load(std::memory_order_acquire) & NewSnapshotBit) == 0)
+		{
+			continue;
+		}
+		mReadSlot = mReadySlot.exchange(mReadSlot, std::memory_order_acq_rel) & ~NewSnapshotBit;
+		RenderFrame(*mSnapshots[mReadSlot]);
+		SDL_GL_SwapWindow(mWindow);
+	}
+	RunRenderCommands();
+	SDL_GL_MakeCurrent(mWindow, nullptr);
+}
+
+void Renderer::RunOnRenderThread(std::function<void()> command, bool wait)
+{
+	if (!IsRenderThreadRunning() || std::this_thread::get_id() == mRenderThreadID)
+	{
+		command();
+		return;
+	}
+
+	std::promise<void> done;
+	std::future<void> finished = done.get_future();
+	{
+		std::lock_guard<std::mutex> lock(mCommandMutex);
+		if (wait)
+		{
+			mCommands.emplace_back([&command, &done]() { command(); done.set_value(); });
+		}
+		else
+		{
+			mCommands.emplace_back(std::move(command));
+		}
+	}
+	SDL_SemPost(mRenderWake);
+	if (wait)
+	{
+		finished.wait();
+	}
+}
+
+void Renderer::RunRenderCommands()
+{
+	std::vector<std::function<void()>> commands;
+	{
+		std::lock_guard<std::mutex> lock(mCommandMutex);
+		commands.swap(mCommands);
+	}
+	for (auto& command : commands)
+	{
+		command();
+	}
+}
+
+void Renderer::CreateGpuTimers()
+{
+	glGenQueries(NumTimerFrames * NumGpuPasses, &mGpuTimers[0][0]);
+}
+
+void Renderer::BeginGpuTimer(GpuPass pass)
+{
+#ifdef SG_PROFILE
+	glBeginQuery(GL_TIME_ELAPSED, mGpuTimers[mGpuTimerFrame][pass]);
+#endif
+}
+
+void Renderer::EndGpuTimer()
+{
+#ifdef SG_PROFILE
+	glEndQuery(GL_TIME_ELAPSED);
+#endif
+}
+
+void Renderer::ReadGpuTimers()
+{
+#ifdef SG_PROFILE
+	// The queries in this slot were issued NumTimerFrames frames ago
+	if (mGpuTimerFramesIssued < NumTimerFrames)
+	{
+		return;
+	}
+
+	static const char* passNames[NumGpuPasses] = { "Depth pre-pass", "Mesh pass", "Sprite pass" };
+	for (int pass = 0; pass < NumGpuPasses; pass++)
+	{
+		GLuint query = mGpuTimers[mGpuTimerFrame][pass];
+		GLint available = 0;
+		glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available)
+		{
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+			Profiler::RecordGpuTime(passNames[pass], elapsed / 1000000.0);
+		}
+	}
+#endif
 }
 
 void Renderer::GenerateShadowMap()
@@ -190,66 +677,200 @@ void Renderer::RemoveSprite(SpriteComponent* sprite)
 void Renderer::AddMeshComp(MeshComponent* mesh)
 {
 	mMeshComps.emplace_back(mesh);
+	if (!ComponentPool<MeshComponent>::Get(mGame).Contains(mesh))
+	{
+		mUnpooledMeshComps.emplace_back(mesh);
+	}
 }
 
 void Renderer::RemoveMeshComp(MeshComponent* mesh)
 {
-	auto iter = std::find(mMeshComps.begin(), mMeshComps.end(), mesh);
-	mMeshComps.erase(iter);
+	auto iter = std::find(mUnpooledMeshComps.begin(), mUnpooledMeshComps.end(), mesh);
+	if (iter != mUnpooledMeshComps.end())
+	{
+		mUnpooledMeshComps.erase(iter);
+	}
+	// Baked static meshes are no longer in the list
+	if (!mesh->IsBaked())
+	{
+		iter = std::find(mMeshComps.begin(), mMeshComps.end(), mesh);
+		if (iter != mMeshComps.end())
+		{
+			mMeshComps.erase(iter);
+		}
+		return;
+	}
+	if (mIndirectBatch)
+	{
+		// The batch's buffers are drawn by the render thread
+		RunOnRenderThread([this, mesh]() { mIndirectBatch->Remove(mesh); }, true);
+	}
 }
 
-Texture* Renderer::GetTexture(const std::string& fileName)
+void Renderer::BakeStaticGeometry()
 {
-	Texture* tex = nullptr;
-	auto iter = mTextures.find(fileName);
-	if (iter != mTextures.end())
-	{
-		tex = iter->second;
-	}
-	else
+	std::vector<MeshComponent*> staticMeshes;
+	auto iter = mMeshComps.begin();
+	while (iter != mMeshComps.end())
 	{
-		tex = new Texture();
-		if (tex->Load(fileName))
+		if ((*iter)->GetOwner()->IsStatic() && (*iter)->GetVisible())
 		{
-			mTextures.emplace(fileName, tex);
+			(*iter)->SetBaked(true);
+			staticMeshes.emplace_back(*iter);
+			iter = mMeshComps.erase(iter);
 		}
 		else
 		{
-			delete tex;
-			tex = nullptr;
+			++iter;
 		}
 	}
+
+	mCuller->SetOccluders(staticMeshes);
+	if (mIndirectBatch)
+	{
+		mIndirectBatch->Build(staticMeshes);
+		SDL_Log("Built %zu indirect draws for static meshes", mIndirectBatch->GetNumObjects());
+		return;
+	}
+
+	mStaticGeometry->Bake(staticMeshes, !IsHeadless());
+	SDL_Log("Baked %zu static meshes into %zu chunks", staticMeshes.size(), mStaticGeometry->GetChunks().size());
+}
+
+AssetHandle<Texture> Renderer::GetTexture(AssetID id)
+{
+	return mTextures.Acquire(id);
+}
+
+AssetHandle<Mesh> Renderer::GetMesh(AssetID id)
+{
+	return mMeshes.Acquire(id);
+}
+
+Texture* Renderer::LoadTexture(const std::string& fileName)
+{
+	// Uploads need the GL context, which the render thread owns while it runs
+	Texture* tex = new Texture();
+	bool loaded = false;
+	bool streamed = mStreamer != nullptr;
+	RunOnRenderThread([this, tex, &fileName, &loaded, streamed]() { loaded = tex->Load(fileName, !IsHeadless(), streamed); }, true);
+	if (!loaded)
+	{
+		delete tex;
+		tex = nullptr;
+	}
+	else if (mStreamer)
+	{
+		mStreamer->Register(tex, AssetNames::Intern(fileName));
+	}
 	return tex;
 }
 
-Mesh* Renderer::GetMesh(const std::string & fileName)
+void Renderer::UnloadTexture(Texture* texture)
 {
-	Mesh* m = nullptr;
-	auto iter = mMeshes.find(fileName);
-	if (iter != mMeshes.end())
+	if (mStreamer)
 	{
-		m = iter->second;
+		mStreamer->Unregister(texture);
 	}
-	else
+	RunOnRenderThread([texture]() { texture->Unload(); delete texture; }, false);
+}
+
+Mesh* Renderer::LoadMesh(const std::string& fileName)
+{
+	Mesh* m = new Mesh();
+	bool loaded = false;
+	RunOnRenderThread([this, m, &fileName, &loaded]() { loaded = m->Load(fileName, this); }, true);
+	if (!loaded)
 	{
-		m = new Mesh();
-		if (m->Load(fileName, this))
-		{
-			mMeshes.emplace(fileName, m);
-		}
-		else
+		delete m;
+		m = nullptr;
+	}
+	return m;
+}
+
+void Renderer::UnloadMesh(Mesh* mesh)
+{
+	// The texture caches belong to this thread, only the GL part goes to the render thread
+	mesh->ReleaseTextures();
+	RunOnRenderThread([mesh]() { mesh->Unload(); delete mesh; }, false);
+}
+
+namespace
+{
+	size_t Remaining(size_t budget, size_t used)
+	{
+		return used < budget ? budget - used : 0;
+	}
+
+	template <typename T>
+	void LogCache(const char* kind, const AssetCache<T>& cache)
+	{
+		const typename AssetCache<T>::Stats& stats = cache.GetStats();
+		uint64_t lookups = stats.mHits + stats.mMisses;
+		SDL_Log("%s: %zu loaded (%zu referenced), %.2f MB CPU, %.2f MB GPU (%.2f MB and %.2f MB unreferenced), %llu lookups, %.1f%% hits, %llu evictions", kind,
+			stats.mLoaded, stats.mReferenced, stats.mCPUBytes / (1024.0 * 1024.0), stats.mGPUBytes / (1024.0 * 1024.0),
+			stats.mUnreferencedCPUBytes / (1024.0 * 1024.0), stats.mUnreferencedGPUBytes / (1024.0 * 1024.0),
+			static_cast<unsigned long long>(lookups), lookups ? 100.0 * stats.mHits / lookups : 0.0,
+			static_cast<unsigned long long>(stats.mEvictions));
+		for (size_t id = 0; id < cache.GetNumIDs(); id++)
 		{
-			delete m;
-			m = nullptr;
+			const typename AssetCache<T>::AssetStats& asset = cache.GetAssetStats(static_cast<AssetID>(id));
+			uint64_t assetLookups = asset.mHits + asset.mMisses;
+			if (assetLookups == 0)
+			{
+				continue;
+			}
+			SDL_Log("  %s: %s, %d refs, %.1f KB CPU, %.1f KB GPU, %.1f%% hits of %llu, evicted %llu times",
+				AssetNames::GetPath(static_cast<AssetID>(id)).c_str(), asset.mAsset ? "loaded" : "unloaded", asset.mRefs,
+				asset.mCPUBytes / 1024.0, asset.mGPUBytes / 1024.0, 100.0 * asset.mHits / assetLookups,
+				static_cast<unsigned long long>(assetLookups), static_cast<unsigned long long>(asset.mEvictions));
 		}
 	}
-	return m;
+}
+
+void Renderer::UpdateAssets()
+{
+	PROFILE_SCOPE("Renderer::UpdateAssets");
+	// One budget for both caches. Meshes go first since evicting one can free its textures.
+	mMeshes.Trim(Remaining(mCPUBudget, mTextures.GetStats().mUnreferencedCPUBytes), Remaining(mGPUBudget, mTextures.GetStats().mUnreferencedGPUBytes));
+	mTextures.Trim(Remaining(mCPUBudget, mMeshes.GetStats().mUnreferencedCPUBytes), Remaining(mGPUBudget, mMeshes.GetStats().mUnreferencedGPUBytes));
+	if (mStreamer)
+	{
+		mStreamer->Update();
+	}
+}
+
+void Renderer::LogAssetStats() const
+{
+	LogCache("Meshes", mMeshes);
+	LogCache("Textures", mTextures);
+}
+
+void Renderer::SetVRAMBudget(size_t bytes)
+{
+	mVRAMBudget = bytes;
+	if (mStreamer)
+	{
+		mStreamer->SetBudget(bytes);
+	}
+}
+
+void Renderer::LogStreamingStats() const
+{
+	if (mStreamer)
+	{
+		mStreamer->LogStats();
+	}
+	else
+	{
+		SDL_Log("Texture streaming is off");
+	}
 }
 
 bool Renderer::LoadShaders()
 {
 	mSpriteShader = new Shader();
-	if (!mSpriteShader->Load("Shaders/Sprite.vert", "Shaders/Sprite.frag"))
+	if (!mSpriteShader->Load("Shaders/Sprite.vert", "Shaders/Sprite.frag", {}, mShaderCache))
 	{
 		return false;
 	}
@@ -258,7 +879,7 @@ bool Renderer::LoadShaders()
 	mSpriteShader->SetMatrixUniform("uViewProj", viewProj);
 
 	mMeshShader = new Shader();
-	if (!mMeshShader->Load("Shaders/Phong.vert", "Shaders/Phong.frag"))
+	if (!mMeshShader->Load("Shaders/Phong.vert", "Shaders/Phong.frag", {}, mShaderCache))
 	{
 		return false;
 	}
@@ -269,7 +890,13 @@ bool Renderer::LoadShaders()
 	mMeshShader->SetMatrixUniform("uViewProj", mView * mProjection);
 
 	simpleDepthShader = new Shader();
-	if (!simpleDepthShader->Load("Shaders/SimpleDepth.vert", "Shaders/SimpleDepth.frag"))
+	if (!simpleDepthShader->Load("Shaders/SimpleDepth.vert", "Shaders/SimpleDepth.frag", {}, mShaderCache))
+	{
+		return false;
+	}
+
+	mOverdrawShader = new Shader();
+	if (!mOverdrawShader->Load("Shaders/SimpleDepth.vert", "Shaders/Overdraw.frag", {}, mShaderCache))
 	{
 		return false;
 	}
@@ -277,6 +904,83 @@ bool Renderer::LoadShaders()
 	return true;
 }
 
+void Renderer::LogShaderLoad(uint64_t start) const
+{
+	double ms = Profiler::ToMilliseconds(Profiler::GetTime() - start);
+	if (mShaderCache && mShaderCache->IsEnabled())
+	{
+		SDL_Log("Loaded shaders in %.2f ms (cache: %d hits, %d misses)", ms, mShaderCache->GetHits(), mShaderCache->GetMisses());
+	}
+	else
+	{
+		SDL_Log("Compiled shaders in %.2f ms", ms);
+	}
+}
+
+Shader* Renderer::GetShader(const std::string& vertName, const std::string& fragName, const std::vector<std::string>& defines)
+{
+	std::string key = vertName + "|" + fragName;
+	for (const std::string& define : defines)
+	{
+		key += "|" + define;
+	}
+	auto iter = mShaderVariants.find(key);
+	if (iter != mShaderVariants.end())
+	{
+		return iter->second;
+	}
+
+	Shader* shader = new Shader();
+	if (!shader->Load(vertName, fragName, defines, mShaderCache))
+	{
+		SDL_Log("Failed to load shader variant %s", key.c_str());
+		shader->Unload();
+		delete shader;
+		shader = nullptr;
+	}
+	// Failures are remembered too, so a broken variant isn't recompiled every frame
+	mShaderVariants.emplace(key, shader);
+	return shader;
+}
+
+void Renderer::PrewarmShaders()
+{
+	if (IsHeadless())
+	{
+		return;
+	}
+	uint64_t start = Profiler::GetTime();
+	UpdateLitShaders(pointLights.size());
+	LogShaderLoad(start);
+}
+
+void Renderer::UpdateLitShaders(size_t numPointLights)
+{
+	// Phong.frag loops over a compile time light count, so each count is its own variant
+	int lightCount = Math::Min(static_cast<int>(numPointLights), MaxPointLights);
+	if (lightCount == mLitLightCount)
+	{
+		return;
+	}
+	mLitLightCount = lightCount;
+
+	std::vector<std::string> defines = { "POINT_LIGHTS " + std::to_string(lightCount) };
+	mLitShader = GetShader("Shaders/Phong.vert", "Shaders/Phong.frag", defines);
+	if (!mLitShader)
+	{
+		mLitShader = mMeshShader;
+	}
+	mLitIndirectShader = mIndirectShader;
+	if (mIndirectBatch)
+	{
+		Shader* variant = GetShader("Shaders/PhongIndirect.vert", "Shaders/Phong.frag", defines);
+		if (variant)
+		{
+			mLitIndirectShader = variant;
+		}
+	}
+}
+
 void Renderer::CreateSpriteVerts()
 {
 	float vertices[] = {
@@ -294,27 +998,26 @@ void Renderer::CreateSpriteVerts()
 	mSpriteVerts = new VertexArray(vertices, 4, indices, 6);
 }
 
-void Renderer::SetLightUniforms(Shader* shader)
+void Renderer::SetLightUniforms(Shader* shader, const RenderSnapshot& snapshot)
 {
-	Matrix4 invView = mView;
-	invView.Invert();
-	shader->SetVectorUniform("uCameraPos", invView.GetTranslation());
-	shader->SetVectorUniform("uAmbientLight", mAmbientLight);
-	shader->SetVectorUniform("uDirLight.mDirection", mDirLight.mDirection);
-	shader->SetVectorUniform("uDirLight.mDiffuseColor", mDirLight.mDiffuseColor);
-	shader->SetVectorUniform("uDirLight.mSpecColor", mDirLight.mSpecColor);
+	const std::vector<PointLight>& pointLights = snapshot.mPointLights;
+	shader->SetVectorUniform("uCameraPos", snapshot.mCameraPos);
+	shader->SetVectorUniform("uAmbientLight", snapshot.mAmbientLight);
+	shader->SetVectorUniform("uDirLight.mDirection", snapshot.mDirLight.mDirection);
+	shader->SetVectorUniform("uDirLight.mDiffuseColor", snapshot.mDirLight.mDiffuseColor);
+	shader->SetVectorUniform("uDirLight.mSpecColor", snapshot.mDirLight.mSpecColor);
 
-	shader->SetIntUniform("nLights", pointLights.size());
+	shader->SetIntUniform("nLights", Math::Min(static_cast<int>(pointLights.size()), MaxPointLights));
 
-	PointLight lightArray[8];
-	for (int i = 0; i < 8; i++)
+	PointLight lightArray[MaxPointLights];
+	for (int i = 0; i < MaxPointLights; i++)
 	{
 		if (i < pointLights.size())
 		{
 			lightArray[i] = pointLights[i];
 		}
 	}
-	shader->SetPointLightUniform("pLight", lightArray, 8);
+	shader->SetPointLightUniform("pLight", lightArray, MaxPointLights);
 }
 
 Vector3 Renderer::Unproject(const Vector3& screenPoint) const
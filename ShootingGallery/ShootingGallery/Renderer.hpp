@@ -1,9 +1,15 @@
 #pragma once
 #include <string>
+#include <cstdint>
 #include <vector>
 #include <unordered_map>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include <SDL.h>
 #include "Math.hpp"
+#include "AssetCache.hpp"
 
 struct DirectionalLight
 {
@@ -24,23 +30,54 @@ class Renderer
 {
 public:
 	Renderer(class Game* game);
-	~Renderer();
+	virtual ~Renderer();
 
-	bool Initialize(float screenWidth, float screenHeight);
-	void Shutdown();
+	virtual bool Initialize(float screenWidth, float screenHeight);
+	virtual void Shutdown();
 	void UnloadData();
 
-	void Draw();
+	// Snapshots the frame and draws it, or hands it to the render thread if that is running
+	virtual void Draw();
 	void GenerateShadowMap();
 
+	// Moves the GL context to a dedicated thread that draws frame N while the game simulates N+1.
+	// Call once loading is done (assets loaded later are created on the render thread).
+	bool StartRenderThread();
+	void StopRenderThread();
+	bool IsRenderThreadRunning() const { return mRenderThread.joinable(); }
+
 	void AddSprite(class SpriteComponent* sprite);
 	void RemoveSprite(class SpriteComponent* sprite);
 
 	void AddMeshComp(class MeshComponent* mesh);
 	void RemoveMeshComp(class MeshComponent* mesh);
+	void ReserveMeshComps(size_t count) { mMeshComps.reserve(mMeshComps.size() + count); }
+
+	// Moves the mesh components of static actors into the baked level chunks
+	void BakeStaticGeometry();
+	const class StaticGeometry* GetStaticGeometry() const { return mStaticGeometry; }
+
+	// Loads on first use, returns an empty handle if the file can't be loaded
+	AssetHandle<class Texture> GetTexture(const std::string& fileName) { return GetTexture(AssetNames::Intern(fileName)); }
+	AssetHandle<class Texture> GetTexture(AssetID id);
+	AssetHandle<class Mesh> GetMesh(const std::string& fileName) { return GetMesh(AssetNames::Intern(fileName)); }
+	AssetHandle<class Mesh> GetMesh(AssetID id);
+	// Unreferenced meshes and textures are unloaded, least recently used first, once the cached ones
+	// need more than this many bytes of CPU or GPU memory
+	void SetAssetBudget(size_t cpuBytes, size_t gpuBytes) { mCPUBudget = cpuBytes; mGPUBudget = gpuBytes; }
+	// Evicts what is over budget, called once per frame before Draw
+	void UpdateAssets();
+	// Logs bytes, references and hit rate of every cached asset
+	void LogAssetStats() const;
 
-	class Texture* GetTexture(const std::string& fileName);
-	class Mesh* GetMesh(const std::string& fileName);
+	// Textures load only their low resolution mips and stream finer ones in as they get close enough
+	// to need them (on by default, set before Initialize)
+	void SetTextureStreaming(bool enable) { mTextureStreaming = enable; }
+	// Streamed mips are evicted, least recently seen first, above this many bytes.
+	// They also count toward the texture cache's GPU bytes, but SetAssetBudget only limits unreferenced textures.
+	void SetVRAMBudget(size_t bytes);
+	// Logs the resident and wanted mips of every streamed texture
+	void LogStreamingStats() const;
 
 	void SetViewMatrix(const Matrix4& view) { mView = view; }
 
@@ -48,6 +85,8 @@ public:
 	DirectionalLight& GetDirectionalLight() { return mDirLight; }
 	std::vector<PointLight> GetPointLights() { return pointLights; }
 
+	// Phong.frag has room for this many point lights, any more are not shaded
+	static const int MaxPointLights = 8;
 	void AddPointLight(PointLight& light) { pointLights.push_back(light); }
 	void SwitchLight(int light) { pointLights[light].TurnOn = (pointLights[light].TurnOn == 0 ? 1 : 0); }
 
@@ -62,16 +101,117 @@ public:
 	float GetScreenWidth() const { return mScreenWidth; }
 	float GetScreenHeight() const { return mScreenHeight; }
 
-private:
+	// Headless renderers keep CPU-side asset data but never touch GL
+	virtual bool IsHeadless() const { return false; }
+
+	// CPU time of the last Draw, excluding the buffer swap.
+	// With the render thread this is only the snapshot, the thread's own time is a profiler zone.
+	double GetLastSubmitMs() const { return mLastSubmitMs; }
+
+	// Draw static meshes with glMultiDrawElementsIndirect (needs GL 4.3, set before Initialize).
+	// Falls back to the GL 3.3 path when the context doesn't support it.
+	void SetMultiDrawIndirect(bool enable) { mUseIndirect = enable; }
+	bool IsMultiDrawIndirect() const { return mIndirectBatch != nullptr; }
+
+	// Meshes loaded after this use the compact 16 byte vertex format
+	void SetCompactVertices(bool compact) { mCompactVertices = compact; }
+	bool GetCompactVertices() const { return mCompactVertices; }
+
+	// Weld and reorder meshes for the vertex cache as they are loaded (on by default)
+	void SetOptimizeMeshes(bool optimize) { mOptimizeMeshes = optimize; }
+	bool GetOptimizeMeshes() const { return mOptimizeMeshes; }
+
+	// Skip meshes hidden behind the static level geometry (on by default)
+	void ToggleOcclusionCulling() { mOcclusionCulling = !mOcclusionCulling; }
+
+	// Depth-only pass before shading, then shade with GL_EQUAL so every pixel runs Phong.frag once
+	void ToggleDepthPrepass() { mDepthPrepass = !mDepthPrepass; }
+	// Sort meshes and static chunks front to back every frame
+	void ToggleFrontToBack() { mSortFrontToBack = !mSortFrontToBack; }
+	// Show how many times each pixel is shaded instead of the lit scene
+	void ToggleOverdraw() { mShowOverdraw = !mShowOverdraw; }
+
+	// Store linked shader programs on disk and reuse them on later runs (on by default, set before Initialize)
+	void SetShaderCache(bool enable) { mUseShaderCache = enable; }
+	// Shader variants are loaded the first time they're asked for and kept until Shutdown.
+	// Each define is "NAME" or "NAME value"; returns nullptr if the variant doesn't compile.
+	class Shader* GetShader(const std::string& vertName, const std::string& fragName, const std::vector<std::string>& defines = {});
+	// Loads the variants the current lights need, so the first frame doesn't compile them
+	void PrewarmShaders();
+
+	// Rolling frame time graph in the bottom left corner
+	void ToggleFrameGraph() { mShowFrameGraph = !mShowFrameGraph; }
+
+protected:
 	bool LoadShaders();
 	void CreateSpriteVerts();
-	void SetLightUniforms(class Shader* shader);
+	void SetLightUniforms(class Shader* shader, const struct RenderSnapshot& snapshot);
+	void UpdateLitShaders(size_t numPointLights);
+	void LogShaderLoad(uint64_t start) const;
+
+	// Simulation side: copies the frame into a snapshot
+	void BuildSnapshot(struct RenderSnapshot& snapshot);
+	// Render side: only reads the snapshot and render-owned state
+	void RenderFrame(const struct RenderSnapshot& snapshot);
+	void DrawMeshPass(class Shader* shader, class Shader* indirectShader, const class OcclusionCuller* culler, bool lit,
+		const struct RenderSnapshot& snapshot);
+	void DrawFrameGraph(const struct RenderSnapshot& snapshot);
+
+	void RenderThreadMain();
+	// Runs GL work on the thread that owns the context (right away when there is no render thread)
+	void RunOnRenderThread(std::function<void()> command, bool wait);
+	void RunRenderCommands();
+
+	// GL_TIME_ELAPSED queries around each render pass.
+	// Results are read back NumTimerFrames frames later so we never stall on the GPU.
+	enum GpuPass
+	{
+		EDepthPass,
+		EMeshPass,
+		ESpritePass,
+		NumGpuPasses
+	};
+	static const int NumTimerFrames = 3;
+	void CreateGpuTimers();
+	void BeginGpuTimer(GpuPass pass);
+	void EndGpuTimer();
+	void ReadGpuTimers();
+
+	class Texture* LoadTexture(const std::string& fileName);
+	void UnloadTexture(class Texture* texture);
+	class Mesh* LoadMesh(const std::string& fileName);
+	void UnloadMesh(class Mesh* mesh);
 
-	std::unordered_map<std::string, class Texture*> mTextures;
-	std::unordered_map<std::string, class Mesh*> mMeshes;
+	AssetCache<class Texture> mTextures;
+	AssetCache<class Mesh> mMeshes;
+	size_t mCPUBudget;
+	size_t mGPUBudget;
+	class TextureStreamer* mStreamer;
+	bool mTextureStreaming;
+	size_t mVRAMBudget;
 
 	std::vector<class SpriteComponent*> mSprites;
+	// Meshes that aren't baked; drawing walks the MeshComponent pool instead
 	std::vector<class MeshComponent*> mMeshComps;
+	// Meshes outside the game's MeshComponent pool (bigger subclasses), drawn from this list
+	std::vector<class MeshComponent*> mUnpooledMeshComps;
+	class StaticGeometry* mStaticGeometry;
+	bool mUseIndirect;
+	bool mCompactVertices;
+	bool mOptimizeMeshes;
+	class IndirectBatch* mIndirectBatch;
+	class Shader* mIndirectShader;
+	class OcclusionCuller* mCuller;
+	bool mOcclusionCulling;
+
+	// Snapshot meshes that passed culling this frame, in draw order
+	std::vector<const struct MeshDraw*> mVisibleMeshes;
+	bool mDepthPrepass;
+	bool mSortFrontToBack;
+	bool mShowOverdraw;
+	class Shader* mOverdrawShader;
+	class Shader* mIndirectDepthShader;
+	class Shader* mIndirectOverdrawShader;
 
 	class Game* mGame;
 
@@ -80,6 +220,14 @@ private:
 	class Shader* mMeshShader;
 	class Shader* simpleDepthShader;
 
+	class ShaderCache* mShaderCache;
+	bool mUseShaderCache;
+	std::unordered_map<std::string, class Shader*> mShaderVariants;
+	// Phong variants for the current point light count
+	class Shader* mLitShader;
+	class Shader* mLitIndirectShader;
+	int mLitLightCount;
+
 	Matrix4 mView;
 	Matrix4 mProjection;
 	float mScreenWidth;
@@ -91,4 +239,29 @@ private:
 
 	SDL_Window* mWindow;
 	SDL_GLContext mContext;
+
+	unsigned int mGpuTimers[NumTimerFrames][NumGpuPasses];
+	int mGpuTimerFrame;
+	int mGpuTimerFramesIssued;
+
+	double mLastSubmitMs;
+	bool mShowFrameGraph;
+	class Texture* mGraphTexture;
+	class Texture* mGraphSlowTexture;
+
+	// Triple buffered snapshots: the simulation fills mSnapshots[mWriteSlot] and the render thread
+	// draws mSnapshots[mReadSlot]. Each side swaps its slot with mReadySlot (plus NewSnapshotBit when
+	// it holds a frame not drawn yet), so neither ever waits for the other.
+	static const int NewSnapshotBit = 4;
+	struct RenderSnapshot* mSnapshots[3];
+	int mWriteSlot;
+	int mReadSlot;
+	std::atomic<int> mReadySlot;
+	std::thread mRenderThread;
+	std::thread::id mRenderThreadID;
+	std::atomic<bool> mRenderThreadQuit;
+	// Posted for every published snapshot and queued command
+	SDL_sem* mRenderWake;
+	std::mutex mCommandMutex;
+	std::vector<std::function<void()>> mCommands;
 };
\ No newline at end of file
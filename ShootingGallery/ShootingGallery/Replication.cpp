@@ -0,0 +1,268 @@
+#include "Replication.hpp"
+#include "Game.hpp"
+#include "Actor.hpp"
+#include "BallActor.hpp"
+#include "TargetActor.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <cstring>
+#include <SDL.h>
+
+LoopbackLink::LoopbackLink(float lossRate, int latencyTicks, unsigned int seed):mLossRate(lossRate), mLatencyTicks(latencyTicks), mRandom(seed)
+{
+}
+
+void LoopbackLink::Send(std::deque<Packet>& queue, const std::vector<uint8_t>& data, uint32_t tick)
+{
+	std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+	if (chance(mRandom) < mLossRate)
+	{
+		return;
+	}
+	Packet packet;
+	packet.mArrival = tick + mLatencyTicks;
+	packet.mData = data;
+	queue.emplace_back(std::move(packet));
+}
+
+bool LoopbackLink::Receive(std::deque<Packet>& queue, uint32_t tick, std::vector<uint8_t>& outData)
+{
+	// Every packet has the same latency, so they arrive in order
+	if (queue.empty() || queue.front().mArrival > tick)
+	{
+		return false;
+	}
+	outData.swap(queue.front().mData);
+	queue.pop_front();
+	return true;
+}
+
+ReplicationServer::ReplicationServer(Game* game):mGame(game), mHasHistory(false), mNewestTick(0)
+{
+}
+
+void ReplicationServer::AddClient(LoopbackLink* link)
+{
+	Client client;
+	client.mLink = link;
+	client.mHasAck = false;
+	client.mAckedTick = 0;
+	mClients.emplace_back(client);
+}
+
+const NetSnapshot* ReplicationServer::GetSnapshot(uint32_t tick) const
+{
+	if (!mHasHistory || tick > mNewestTick || mNewestTick - tick >= HistorySize)
+	{
+		return nullptr;
+	}
+	const NetSnapshot& snapshot = mHistory[tick % HistorySize];
+	return snapshot.mTick == tick ? &snapshot : nullptr;
+}
+
+void ReplicationServer::Update(uint32_t tick)
+{
+	PROFILE_SCOPE("ReplicationServer::Update");
+	NetSnapshot& snapshot = mHistory[tick % HistorySize];
+	Capture(snapshot, tick);
+	mHasHistory = true;
+	mNewestTick = tick;
+
+	for (Client& client : mClients)
+	{
+		// Acks are the 4 byte tick of the newest snapshot the client decoded
+		while (client.mLink->ReceiveOnServer(tick, mPacket))
+		{
+			if (mPacket.size() == sizeof(uint32_t))
+			{
+				uint32_t acked;
+				memcpy(&acked, mPacket.data(), sizeof(uint32_t));
+				if (!client.mHasAck || acked > client.mAckedTick)
+				{
+					client.mAckedTick = acked;
+					client.mHasAck = true;
+				}
+			}
+		}
+
+		uint64_t start = Profiler::GetTime();
+		const NetSnapshot* baseline = client.mHasAck ? GetSnapshot(client.mAckedTick) : nullptr;
+		mWriter.Reset();
+		SnapshotCodec::Encode(snapshot, baseline, mWriter);
+		client.mStats.mEncodeMs.emplace_back(Profiler::ToMilliseconds(Profiler::GetTime() - start));
+
+		client.mLink->SendToClient(mWriter.GetData(), tick);
+		client.mStats.mPackets++;
+		client.mStats.mBytes += mWriter.GetData().size();
+		if (baseline == nullptr)
+		{
+			client.mStats.mFullPackets++;
+		}
+	}
+}
+
+void ReplicationServer::Capture(NetSnapshot& outSnapshot, uint32_t tick) const
+{
+	outSnapshot.mTick = tick;
+	outSnapshot.mActors.clear();
+	for (Actor* actor : mGame->GetActors())
+	{
+		NetActorState state = {};
+		state.mID = actor->GetID();
+		state.mType = NetActorState::EOther;
+		state.SetTransform(actor->GetPosition(), actor->GetRotation(), actor->GetScale());
+		switch (actor->GetType())
+		{
+		case Actor::EBall:
+			state.mType = NetActorState::EBall;
+			state.mLifeSpan = static_cast<uint8_t>(Math::Clamp(static_cast<BallActor*>(actor)->GetLifeSpan() * 60.0f, 0.0f, 255.0f));
+			break;
+		case Actor::ETarget:
+			state.mType = NetActorState::ETarget;
+			state.mHits = static_cast<uint8_t>(static_cast<TargetActor*>(actor)->GetHits());
+			break;
+		case Actor::EPlayer:
+			state.mType = NetActorState::EPlayer;
+			break;
+		default:
+			break;
+		}
+		outSnapshot.mActors.emplace_back(state);
+	}
+	// Ids grow with creation order, but removals swap actors around
+	std::sort(outSnapshot.mActors.begin(), outSnapshot.mActors.end(),
+		[](const NetActorState& a, const NetActorState& b) { return a.mID < b.mID; });
+}
+
+ReplicationClient::ReplicationClient(LoopbackLink* link):mLink(link), mHasSnapshot(false), mLatestTick(0), mDropped(0)
+{
+}
+
+const NetSnapshot* ReplicationClient::FindSnapshot(uint32_t tick) const
+{
+	const NetSnapshot& snapshot = mReceived[tick % ReplicationServer::HistorySize];
+	return (mHasSnapshot && snapshot.mTick == tick && tick <= mLatestTick) ? &snapshot : nullptr;
+}
+
+void ReplicationClient::Update(uint32_t tick)
+{
+	bool received = false;
+	while (mLink->ReceiveOnClient(tick, mPacket))
+	{
+		const NetSnapshot* baseline = nullptr;
+		uint32_t baselineTick;
+		if (SnapshotCodec::PeekBaseline(mPacket.data(), mPacket.size(), baselineTick))
+		{
+			baseline = FindSnapshot(baselineTick);
+			if (baseline == nullptr)
+			{
+				mDropped++;
+				continue;
+			}
+		}
+		if (!SnapshotCodec::Decode(mPacket.data(), mPacket.size(), baseline, mDecoded) ||
+			(mHasSnapshot && mDecoded.mTick <= mLatestTick))
+		{
+			mDropped++;
+			continue;
+		}
+
+		// Keep the vector's capacity in the ring
+		NetSnapshot& slot = mReceived[mDecoded.mTick % ReplicationServer::HistorySize];
+		slot.mTick = mDecoded.mTick;
+		slot.mActors.swap(mDecoded.mActors);
+		mLatestTick = slot.mTick;
+		mHasSnapshot = true;
+		received = true;
+	}
+
+	if (received)
+	{
+		std::vector<uint8_t> ack(sizeof(uint32_t));
+		memcpy(ack.data(), &mLatestTick, sizeof(uint32_t));
+		mLink->SendToServer(ack, tick);
+	}
+}
+
+ReplicationBenchmark::ReplicationBenchmark(const Settings& settings):mSettings(settings)
+{
+}
+
+bool ReplicationBenchmark::Run()
+{
+	const int tickRate = 60;
+	Game game;
+	game.SetHosted(true);
+	game.SetFixedTimestep(1.0f / tickRate);
+	game.SetUncapped(true);
+	game.SetLevelFile(mSettings.mLevelFile);
+	if (!game.Initialize(true))
+	{
+		game.Shutdown();
+		return false;
+	}
+
+	ReplicationServer server(&game);
+	std::vector<LoopbackLink> links;
+	links.reserve(mSettings.mClients);
+	std::vector<ReplicationClient> clients;
+	clients.reserve(mSettings.mClients);
+	for (int i = 0; i < mSettings.mClients; i++)
+	{
+		links.emplace_back(mSettings.mLossRate, mSettings.mLatencyTicks, 1234u + i);
+		server.AddClient(&links.back());
+		clients.emplace_back(&links.back());
+	}
+
+	uint64_t fullBytes = 0;
+	uint64_t mismatches = 0;
+	BitWriter fullWriter;
+	for (int tick = 0; tick < mSettings.mTicks; tick++)
+	{
+		if (mSettings.mShotInterval > 0 && tick % mSettings.mShotInterval == 0)
+		{
+			game.FirePlayerWeapon();
+		}
+		game.Tick();
+		server.Update(tick);
+
+		// What every packet would cost without delta compression
+		fullWriter.Reset();
+		SnapshotCodec::Encode(*server.GetSnapshot(tick), nullptr, fullWriter);
+		fullBytes += fullWriter.GetData().size();
+
+		for (auto& client : clients)
+		{
+			client.Update(tick);
+			const NetSnapshot* latest = client.GetLatest();
+			const NetSnapshot* sent = latest ? server.GetSnapshot(latest->mTick) : nullptr;
+			if (sent && (sent->mActors.size() != latest->mActors.size() ||
+				!std::equal(sent->mActors.begin(), sent->mActors.end(), latest->mActors.begin())))
+			{
+				mismatches++;
+			}
+		}
+	}
+
+	SDL_Log("Replicated %d ticks to %d clients (%.0f%% loss, %d ticks latency), full snapshots average %.1f bytes",
+		mSettings.mTicks, mSettings.mClients, mSettings.mLossRate * 100.0f, mSettings.mLatencyTicks,
+		static_cast<double>(fullBytes) / mSettings.mTicks);
+	for (size_t i = 0; i < server.GetNumClients(); i++)
+	{
+		const ReplicationServer::ClientStats& stats = server.GetClientStats(i);
+		std::vector<double> encodeMs = stats.mEncodeMs;
+		std::sort(encodeMs.begin(), encodeMs.end());
+		double bytesPerTick = static_cast<double>(stats.mBytes) / Math::Max(stats.mPackets, static_cast<uint64_t>(1));
+		SDL_Log("Client %zu: %.1f bytes/tick (%.1f kbit/s), %llu full packets, %llu undecodable, encode p50 %.4f ms p99 %.4f ms",
+			i, bytesPerTick, bytesPerTick * tickRate * 8.0 / 1000.0,
+			static_cast<unsigned long long>(stats.mFullPackets), static_cast<unsigned long long>(clients[i].GetDroppedPackets()),
+			encodeMs.empty() ? 0.0 : encodeMs[encodeMs.size() / 2], encodeMs.empty() ? 0.0 : encodeMs[encodeMs.size() * 99 / 100]);
+	}
+	if (mismatches > 0)
+	{
+		SDL_Log("%llu decoded snapshots differ from what the server sent", static_cast<unsigned long long>(mismatches));
+	}
+
+	game.Shutdown();
+	return mismatches == 0;
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+#include "NetSnapshot.hpp"
+
+// In-process stand-in for a UDP connection between the server and one client.
+// Packets arrive after a fixed number of ticks and a share of them is dropped, like on a real network.
+class LoopbackLink
+{
+public:
+	LoopbackLink(float lossRate, int latencyTicks, unsigned int seed);
+
+	void SendToClient(const std::vector<uint8_t>& data, uint32_t tick) { Send(mToClient, data, tick); }
+	void SendToServer(const std::vector<uint8_t>& data, uint32_t tick) { Send(mToServer, data, tick); }
+	// Pops the next packet that has arrived by tick
+	bool ReceiveOnClient(uint32_t tick, std::vector<uint8_t>& outData) { return Receive(mToClient, tick, outData); }
+	bool ReceiveOnServer(uint32_t tick, std::vector<uint8_t>& outData) { return Receive(mToServer, tick, outData); }
+
+private:
+	struct Packet
+	{
+		uint32_t mArrival;
+		std::vector<uint8_t> mData;
+	};
+
+	void Send(std::deque<Packet>& queue, const std::vector<uint8_t>& data, uint32_t tick);
+	bool Receive(std::deque<Packet>& queue, uint32_t tick, std::vector<uint8_t>& outData);
+
+	std::deque<Packet> mToClient;
+	std::deque<Packet> mToServer;
+	float mLossRate;
+	int mLatencyTicks;
+	std::mt19937 mRandom;
+};
+
+// Sends every client one snapshot per tick, delta compressed against the newest snapshot that
+// client acknowledged. Snapshots are captured once per tick and shared by all clients.
+class ReplicationServer
+{
+public:
+	// Snapshots older than this can't be used as baselines, clients that fall further behind get a full one
+	static const uint32_t HistorySize = 32;
+
+	ReplicationServer(class Game* game);
+	void AddClient(LoopbackLink* link);
+
+	// Captures the game's state for tick, reads acks and sends each client its packet
+	void Update(uint32_t tick);
+
+	// Snapshot sent on tick, or null if it is no longer kept
+	const NetSnapshot* GetSnapshot(uint32_t tick) const;
+
+	struct ClientStats
+	{
+		uint64_t mPackets = 0;
+		uint64_t mBytes = 0;
+		// Packets that had to be sent without a baseline
+		uint64_t mFullPackets = 0;
+		std::vector<double> mEncodeMs;
+	};
+	const ClientStats& GetClientStats(size_t client) const { return mClients[client].mStats; }
+	size_t GetNumClients() const { return mClients.size(); }
+
+private:
+	void Capture(NetSnapshot& outSnapshot, uint32_t tick) const;
+
+	struct Client
+	{
+		LoopbackLink* mLink;
+		bool mHasAck;
+		uint32_t mAckedTick;
+		ClientStats mStats;
+	};
+
+	class Game* mGame;
+	std::vector<Client> mClients;
+	// Ring of the last HistorySize snapshots, indexed by tick % HistorySize
+	NetSnapshot mHistory[HistorySize];
+	bool mHasHistory;
+	uint32_t mNewestTick;
+	BitWriter mWriter;
+	std::vector<uint8_t> mPacket;
+};
+
+// Decodes the server's packets and acknowledges the newest snapshot it has
+class ReplicationClient
+{
+public:
+	ReplicationClient(LoopbackLink* link);
+
+	// Receives everything that arrived by tick and sends an ack for the newest snapshot
+	void Update(uint32_t tick);
+
+	const NetSnapshot* GetLatest() const { return mHasSnapshot ? &mReceived[mLatestTick % ReplicationServer::HistorySize] : nullptr; }
+	// Packets that couldn't be decoded because their baseline was never received
+	uint64_t GetDroppedPackets() const { return mDropped; }
+
+private:
+	const NetSnapshot* FindSnapshot(uint32_t tick) const;
+
+	LoopbackLink* mLink;
+	NetSnapshot mReceived[ReplicationServer::HistorySize];
+	bool mHasSnapshot;
+	uint32_t mLatestTick;
+	uint64_t mDropped;
+	std::vector<uint8_t> mPacket;
+	NetSnapshot mDecoded;
+};
+
+// Runs the gallery headless with clients on lossy loopback links and reports bandwidth and encode times.
+// Every decoded snapshot is compared against what the server sent, so it doubles as a correctness check.
+class ReplicationBenchmark
+{
+public:
+	struct Settings
+	{
+		int mClients = 4;
+		int mTicks = 600;
+		float mLossRate = 0.05f;
+		int mLatencyTicks = 3;
+		// Ticks between the bot's shots, more balls means more moving actors
+		int mShotInterval = 6;
+		std::string mLevelFile = "Assets/Gallery.gplevel";
+	};
+
+	ReplicationBenchmark(const Settings& settings);
+	// Returns false if the game failed to start or a client decoded a different state
+	bool Run();
+
+private:
+	Settings mSettings;
+};
@@ -1,8 +1,8 @@
 #include "Shader.hpp"
 #include "Texture.hpp"
+#include "ShaderCache.hpp"
+#include "VirtualFS.hpp"
 #include <SDL.h>
-#include <fstream>
-#include <sstream>
 
 Shader::Shader(): mShaderProgram(0), mVertexShader(0), mFragShader(0)
 {
@@ -14,9 +14,29 @@ Shader::~Shader()
 
 }
 
-bool Shader::Load(const std::string& vertName, const std::string& fragName)
+bool Shader::Load(const std::string& vertName, const std::string& fragName, const std::vector<std::string>& defines, ShaderCache* cache)
 {
-	if (!CompileShader(vertName, GL_VERTEX_SHADER, mVertexShader) || !CompileShader(fragName, GL_FRAGMENT_SHADER, mFragShader))
+	std::string vertSource;
+	std::string fragSource;
+	if (!ReadSource(vertName, defines, vertSource) || !ReadSource(fragName, defines, fragSource))
+	{
+		return false;
+	}
+
+	bool useCache = cache && cache->IsEnabled();
+	uint64_t key = 0;
+	if (useCache)
+	{
+		key = ShaderCache::HashSource(vertSource + '\0' + fragSource);
+		mShaderProgram = cache->LoadProgram(key);
+		if (mShaderProgram != 0)
+		{
+			return true;
+		}
+	}
+
+	if (!CompileShader(vertName, vertSource, GL_VERTEX_SHADER, mVertexShader) ||
+		!CompileShader(fragName, fragSource, GL_FRAGMENT_SHADER, mFragShader))
 	{
 		return false;
 	}
@@ -24,6 +44,10 @@ bool Shader::Load(const std::string& vertName, const std::string& fragName)
 	mShaderProgram = glCreateProgram();
 	glAttachShader(mShaderProgram, mVertexShader);
 	glAttachShader(mShaderProgram, mFragShader);
+	if (useCache)
+	{
+		glProgramParameteri(mShaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
 	glLinkProgram(mShaderProgram);
 
 	if (!IsValidProgram())
@@ -31,6 +55,10 @@ bool Shader::Load(const std::string& vertName, const std::string& fragName)
 		return false;
 	}
 
+	if (useCache)
+	{
+		cache->SaveProgram(mShaderProgram, key);
+	}
 	return true;
 }
 
@@ -97,29 +125,49 @@ void Shader::SetIntUniform(const char * name, int value)
 	glUniform1i(loc, value);
 }
 
-bool Shader::CompileShader(const std::string& fileName, GLenum shaderType, GLuint& outShader)
+bool Shader::ReadSource(const std::string& fileName, const std::vector<std::string>& defines, std::string& outSource)
 {
-	std::ifstream shaderFile(fileName);
-	if (shaderFile.is_open())
+	FileData shaderFile;
+	if (!VirtualFS::ReadFile(fileName, shaderFile))
 	{
-		std::stringstream sstream;
-		sstream << shaderFile.rdbuf();
-		std::string contents = sstream.str();
-		const char* contentsChar = contents.c_str();
-
-		outShader = glCreateShader(shaderType);
-		glShaderSource(outShader, 1, &(contentsChar), nullptr);
-		glCompileShader(outShader);
+		SDL_Log("Shader file not found: %s", fileName.c_str());
+		return false;
+	}
+	outSource.assign(shaderFile.GetChars(), shaderFile.GetSize());
 
-		if (!IsCompiled(outShader))
+	if (!defines.empty())
+	{
+		// #version has to stay the first statement, so the defines go right after it
+		size_t pos = outSource.find("#version");
+		if (pos != std::string::npos)
+		{
+			pos = outSource.find('\n', pos);
+			pos = (pos == std::string::npos) ? outSource.size() : pos + 1;
+		}
+		else
+		{
+			pos = 0;
+		}
+		std::string block;
+		for (const std::string& define : defines)
 		{
-			SDL_Log("Failed to compile shader %s", fileName.c_str());
-			return false;
+			block += "#define " + define + "\n";
 		}
+		outSource.insert(pos, block);
 	}
-	else
+	return true;
+}
+
+bool Shader::CompileShader(const std::string& fileName, const std::string& source, GLenum shaderType, GLuint& outShader)
+{
+	const char* contentsChar = source.c_str();
+	outShader = glCreateShader(shaderType);
+	glShaderSource(outShader, 1, &(contentsChar), nullptr);
+	glCompileShader(outShader);
+
+	if (!IsCompiled(outShader))
 	{
-		SDL_Log("Shader file not found: %s", fileName.c_str());
+		SDL_Log("Failed to compile shader %s", fileName.c_str());
 		return false;
 	}
 
@@ -1,6 +1,7 @@
 #pragma once
 #include <GL/glew.h>
 #include <string>
+#include <vector>
 #include "Math.hpp"
 #include "Renderer.hpp"
 
@@ -9,7 +10,10 @@ class Shader
 public:
 	Shader();
 	~Shader();
-	bool Load(const std::string& vertName, const std::string& fragName);
+	// Each define ("NAME" or "NAME value") is inserted after the #version line of both stages.
+	// With a cache the linked program is loaded from/saved to it instead of always compiling.
+	bool Load(const std::string& vertName, const std::string& fragName, const std::vector<std::string>& defines = {},
+		class ShaderCache* cache = nullptr);
 	void Unload();
 	void SetActive();
 	void SetMatrixUniform(const char* name, const Matrix4& matrix);
@@ -21,7 +25,8 @@ public:
 	void SetIntUniform(const char* name, int value);
 
 private:
-	bool CompileShader(const std::string& fileName, GLenum shaderType, GLuint& outShader);
+	bool ReadSource(const std::string& fileName, const std::vector<std::string>& defines, std::string& outSource);
+	bool CompileShader(const std::string& fileName, const std::string& source, GLenum shaderType, GLuint& outShader);
 	bool IsCompiled(GLuint shader);
 	bool IsValidProgram();
 
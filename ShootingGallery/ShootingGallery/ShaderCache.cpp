@@ -0,0 +1,170 @@
+#include "ShaderCache.hpp"
+#include <GL/glew.h>
+#include <SDL.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace
+{
+	const char ShaderCacheMagic[4] = { 'S', 'G', 'S', 'C' };
+	const uint32_t ShaderCacheVersion = 1;
+
+	template <typename T>
+	void WriteValue(std::vector<uint8_t>& data, const T& value)
+	{
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+		data.insert(data.end(), bytes, bytes + sizeof(T));
+	}
+
+	template <typename T>
+	bool ReadValue(const std::vector<uint8_t>& data, size_t& pos, T& outValue)
+	{
+		if (pos + sizeof(T) > data.size())
+		{
+			return false;
+		}
+		memcpy(&outValue, data.data() + pos, sizeof(T));
+		pos += sizeof(T);
+		return true;
+	}
+
+	std::string GetGLString(GLenum name)
+	{
+		const GLubyte* str = glGetString(name);
+		return str ? reinterpret_cast<const char*>(str) : "";
+	}
+}
+
+ShaderCache::ShaderCache():mEnabled(false), mHits(0), mMisses(0)
+{
+}
+
+bool ShaderCache::Initialize()
+{
+	mEnabled = false;
+	if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary)
+	{
+		SDL_Log("Shader cache disabled: no GL_ARB_get_program_binary");
+		return false;
+	}
+	GLint numFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+	if (numFormats <= 0)
+	{
+		SDL_Log("Shader cache disabled: the driver has no program binary formats");
+		return false;
+	}
+
+	char* prefPath = SDL_GetPrefPath("ShootingGallery", "ShaderCache");
+	if (!prefPath)
+	{
+		SDL_Log("Shader cache disabled: %s", SDL_GetError());
+		return false;
+	}
+	mDirectory = prefPath;
+	SDL_free(prefPath);
+
+	mDriver = GetGLString(GL_VENDOR) + "|" + GetGLString(GL_RENDERER) + "|" + GetGLString(GL_VERSION);
+	mEnabled = true;
+	return true;
+}
+
+uint64_t ShaderCache::HashSource(const std::string& source)
+{
+	// FNV-1a, 64 bit
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : source)
+	{
+		hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+	}
+	return hash;
+}
+
+std::string ShaderCache::GetFileName(uint64_t key) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+	return mDirectory + name;
+}
+
+unsigned int ShaderCache::LoadProgram(uint64_t key)
+{
+	std::ifstream file(GetFileName(key), std::ios::binary);
+	if (!file.is_open())
+	{
+		mMisses++;
+		return 0;
+	}
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	size_t pos = sizeof(ShaderCacheMagic);
+	uint32_t version = 0;
+	uint32_t driverLength = 0;
+	if (data.size() < sizeof(ShaderCacheMagic) || memcmp(data.data(), ShaderCacheMagic, sizeof(ShaderCacheMagic)) != 0 ||
+		!ReadValue(data, pos, version) || version != ShaderCacheVersion || !ReadValue(data, pos, driverLength) ||
+		driverLength != mDriver.size() || pos + driverLength > data.size() || memcmp(data.data() + pos, mDriver.data(), driverLength) != 0)
+	{
+		mMisses++;
+		return 0;
+	}
+	pos += driverLength;
+
+	uint64_t storedKey = 0;
+	uint32_t format = 0;
+	uint32_t length = 0;
+	if (!ReadValue(data, pos, storedKey) || storedKey != key || !ReadValue(data, pos, format) ||
+		!ReadValue(data, pos, length) || pos + length != data.size())
+	{
+		mMisses++;
+		return 0;
+	}
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, format, data.data() + pos, static_cast<GLsizei>(length));
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		// The driver can reject binaries it wrote itself (e.g. after an update that kept the version string)
+		glDeleteProgram(program);
+		mMisses++;
+		return 0;
+	}
+	mHits++;
+	return program;
+}
+
+void ShaderCache::SaveProgram(unsigned int program, uint64_t key)
+{
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+	{
+		return;
+	}
+
+	std::vector<uint8_t> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+
+	std::vector<uint8_t> data;
+	data.reserve(64 + mDriver.size() + length);
+	data.insert(data.end(), ShaderCacheMagic, ShaderCacheMagic + sizeof(ShaderCacheMagic));
+	WriteValue(data, ShaderCacheVersion);
+	WriteValue(data, static_cast<uint32_t>(mDriver.size()));
+	data.insert(data.end(), mDriver.begin(), mDriver.end());
+	WriteValue(data, key);
+	WriteValue(data, static_cast<uint32_t>(format));
+	WriteValue(data, static_cast<uint32_t>(length));
+	data.insert(data.end(), binary.begin(), binary.begin() + length);
+
+	std::string fileName = GetFileName(key);
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file.is_open() || !file.write(reinterpret_cast<const char*>(data.data()), data.size()))
+	{
+		SDL_Log("Failed to write shader cache entry %s", fileName.c_str());
+	}
+}
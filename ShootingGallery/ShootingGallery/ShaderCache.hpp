@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+// Keeps linked program binaries (glGetProgramBinary) on disk so later runs skip compiling and linking.
+// Entries are keyed by a hash of the final shader sources (defines included). Each entry also stores
+// the GL vendor/renderer/version string, so a driver or GPU change, or a binary the driver rejects,
+// is a miss and the program gets compiled and cached again.
+class ShaderCache
+{
+public:
+	ShaderCache();
+
+	// Needs a current GL context. Leaves the cache disabled when the driver can't export binaries.
+	bool Initialize();
+	bool IsEnabled() const { return mEnabled; }
+
+	static uint64_t HashSource(const std::string& source);
+
+	// Returns a linked program created from the cached binary, or 0 on a miss
+	unsigned int LoadProgram(uint64_t key);
+	// The program should be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+	void SaveProgram(unsigned int program, uint64_t key);
+
+	int GetHits() const { return mHits; }
+	int GetMisses() const { return mMisses; }
+private:
+	std::string GetFileName(uint64_t key) const;
+
+	bool mEnabled;
+	std::string mDirectory;
+	std::string mDriver;
+	int mHits;
+	int mMisses;
+};
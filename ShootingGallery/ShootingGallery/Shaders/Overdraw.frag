@@ -0,0 +1,10 @@
+#version 330 core
+
+// Overdraw view, blended additively: every shaded fragment adds one step,
+// so a pixel goes from dark red to white the more times it is shaded
+out vec4 outColor;
+
+void main()
+{
+	outColor = vec4(0.25, 0.1, 0.05, 1.0);
+}
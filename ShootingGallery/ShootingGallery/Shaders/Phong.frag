@@ -9,7 +9,13 @@
 // Request GLSL 3.3
 #version 330
 
-#define N_POINT_LIGHTS 8;
+// Renderer compiles a variant per light count with POINT_LIGHTS defined,
+// without it the loop runs over nLights
+#ifdef POINT_LIGHTS
+#define NUM_POINT_LIGHTS POINT_LIGHTS
+#else
+#define NUM_POINT_LIGHTS nLights
+#endif
 
 // Inputs from vertex shader
 // Tex coord
@@ -51,6 +57,7 @@ struct PointLight
     int TurnOn;
 };
 
+// Renderer::MaxPointLights
 uniform PointLight pLight[8];
 // number of active lights
 uniform int nLights;
@@ -104,7 +111,7 @@ void main()
 	}
 
         vec3 pointLights = vec3(0.0, 0.0, 0.0);
-        for (int i = 0; i < nLights; i++)
+        for (int i = 0; i < NUM_POINT_LIGHTS; i++)
             pointLights += CalcPointLight(pLight[i], N, fragWorldPos, V);
 
 	// Final color is texture color times phong light (alpha = 1)
@@ -28,6 +28,12 @@ struct PointLight
 uniform mat4 uWorldTransform;
 uniform mat4 uViewProj;
 
+// Vertex format decoding (see VertexArray), scale 1 and offset 0 for float vertices
+uniform vec3 uPosScale;
+uniform vec3 uPosOffset;
+// Normals are octahedral encoded in inNormal.xy
+uniform int uPackedNormals;
+
 // Attribute 0 is position, 1 is normal, 2 is tex coords.
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
@@ -46,10 +52,22 @@ out vec3 fragWorldPos;
 
 //out vec3 pLightDirection[numberOfPointLights];
 
+// Depth pre-pass (SimpleDepth.vert) has to produce bit-identical depths
+invariant gl_Position;
+
+vec3 OctDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
 void main()
 {
 	// Convert position to homogeneous coordinates
-	vec4 pos = vec4(inPosition, 1.0);
+	vec4 pos = vec4(inPosition * uPosScale + uPosOffset, 1.0);
 	// Transform position to world space
 	pos = pos * uWorldTransform;
 	// Save world position
@@ -58,7 +76,8 @@ void main()
 	gl_Position = pos * uViewProj;
 
 	// Transform normal into world space (w = 0)
-	fragNormal = (vec4(inNormal, 0.0f) * uWorldTransform).xyz;
+	vec3 normal = uPackedNormals != 0 ? OctDecode(inNormal.xy) : inNormal;
+	fragNormal = (vec4(normal, 0.0f) * uWorldTransform).xyz;
 
 	// Pass along the texture coordinate to frag shader
 	fragTexCoord = inTexCoord;
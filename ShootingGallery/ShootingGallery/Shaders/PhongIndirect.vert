@@ -0,0 +1,43 @@
+// ----------------------------------------------------------------
+// Phong vertex shader for the multi-draw-indirect path.
+// Same outputs as Phong.vert, but the world transform comes from the
+// object buffer, indexed by the per-draw id (fed through baseInstance).
+// ----------------------------------------------------------------
+
+// Request GLSL 4.3 (shader storage buffers)
+#version 430
+
+// One world transform per object, same row-vector layout as uWorldTransform
+layout(std430, binding = 0) readonly buffer ObjectData
+{
+	layout(row_major) mat4 uWorldTransforms[];
+};
+
+uniform mat4 uViewProj;
+
+// Attribute 0 is position, 1 is normal, 2 is tex coords, 3 is the draw id
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inTexCoord;
+layout(location = 3) in uint inDrawID;
+
+out vec2 fragTexCoord;
+// Normal (in world space)
+out vec3 fragNormal;
+// Position (in world space)
+out vec3 fragWorldPos;
+
+// Depth pre-pass uses this shader too and has to produce bit-identical depths
+invariant gl_Position;
+
+void main()
+{
+	mat4 world = uWorldTransforms[inDrawID];
+
+	vec4 pos = vec4(inPosition, 1.0) * world;
+	fragWorldPos = pos.xyz;
+	gl_Position = pos * uViewProj;
+
+	fragNormal = (vec4(inNormal, 0.0f) * world).xyz;
+	fragTexCoord = inTexCoord;
+}
@@ -1,10 +1,21 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
 
-uniform mat4 lightSpaceMatrix;
-uniform mat4 model;
+// Position-only pass (depth pre-pass and overdraw view).
+// Same uniforms and the same transform as Phong.vert, so a GL_EQUAL
+// depth test against this pass matches exactly.
+uniform mat4 uWorldTransform;
+uniform mat4 uViewProj;
+// Position decoding for compact vertices (see VertexArray)
+uniform vec3 uPosScale;
+uniform vec3 uPosOffset;
+
+layout (location = 0) in vec3 inPosition;
+
+invariant gl_Position;
 
 void main()
 {
-    gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0);
-}
\ No newline at end of file
+	vec4 pos = vec4(inPosition * uPosScale + uPosOffset, 1.0);
+	pos = pos * uWorldTransform;
+	gl_Position = pos * uViewProj;
+}
@@ -1,6 +1,5 @@
 #include "SpriteComponent.hpp"
 #include "Texture.hpp"
-#include "Shader.hpp"
 #include "Actor.hpp"
 #include "Game.hpp"
 #include "Renderer.hpp"
@@ -15,22 +14,10 @@ SpriteComponent::~SpriteComponent()
 	mOwner->GetGame()->GetRenderer()->RemoveSprite(this);
 }
 
-void SpriteComponent::Draw(Shader* shader)
+void SpriteComponent::SetTexture(const AssetHandle<Texture>& texture)
 {
-	if (mTexture)
-	{
-		Matrix4 scaleMat = Matrix4::CreateScale(static_cast<float>(mTexWidth), static_cast<float>(mTexHeight), 1.0f);
-		Matrix4 world = scaleMat * mOwner->GetWorldTransform();
-
-		shader->SetMatrixUniform("uWorldTransform", world);
-		mTexture->SetActive();
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
-	}
-}
-
-void SpriteComponent::SetTexture(Texture* texture)
-{
-	mTexture = texture;
+	mTextureRef = texture;
+	mTexture = texture.Get();
 	mTexWidth = texture->GetWidth();
 	mTexHeight = texture->GetHeight();
 }
\ No newline at end of file
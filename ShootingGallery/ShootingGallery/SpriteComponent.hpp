@@ -1,14 +1,16 @@
 #pragma once
 #include "Component.hpp"
 #include "SDL.h"
+#include "AssetCache.hpp"
 class SpriteComponent : public Component
 {
+	POOLED_COMPONENT(SpriteComponent)
 public:
 	SpriteComponent(class Actor* owner, int drawOrder = 100);
 	~SpriteComponent();
 
-	virtual void Draw(class Shader* shader);
-	virtual void SetTexture(class Texture* texture);
+	virtual void SetTexture(const AssetHandle<class Texture>& texture);
+	class Texture* GetTexture() const { return mTexture; }
 	int GetDrawOrder() const { return mDrawOrder; }
 	int GetTexHeight() const { return mTexHeight; }
 	int GetTexWidth() const { return mTexWidth; }
@@ -17,6 +19,7 @@ public:
 
 protected:
 	class Texture* mTexture;
+	AssetHandle<class Texture> mTextureRef;
 	int mDrawOrder;
 	int mTexWidth;
 	int mTexHeight;
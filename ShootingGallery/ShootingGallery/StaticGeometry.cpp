@@ -0,0 +1,128 @@
+#include "StaticGeometry.hpp"
+#include "MeshComponent.hpp"
+#include "Mesh.hpp"
+#include "Actor.hpp"
+#include "Shader.hpp"
+#include "Texture.hpp"
+#include "VertexArray.hpp"
+#include "OcclusionCuller.hpp"
+#include <map>
+#include <algorithm>
+#include <tuple>
+#include <GL/glew.h>
+
+StaticGeometry::Chunk::Chunk():mBounds(Vector3::Infinity, Vector3::NegInfinity), mTexture(nullptr), mSpecPower(100.0f), mVertexArray(nullptr)
+{
+}
+
+StaticGeometry::StaticGeometry(float chunkSize):mChunkSize(chunkSize)
+{
+}
+
+StaticGeometry::~StaticGeometry()
+{
+	Unload();
+}
+
+void StaticGeometry::Bake(const std::vector<MeshComponent*>& meshes, bool createGPUBuffers)
+{
+	Unload();
+
+	// Chunk key is the cell plus everything that has to be the same within one draw call
+	typedef std::tuple<int, int, Texture*, float> ChunkKey;
+	std::map<ChunkKey, size_t> chunkIndices;
+
+	for (auto mc : meshes)
+	{
+		Mesh* mesh = mc->GetMesh();
+		if (mesh == nullptr)
+		{
+			continue;
+		}
+
+		const Matrix4& world = mc->GetOwner()->GetWorldTransform();
+		Vector3 center = world.GetTranslation();
+		int cellX = static_cast<int>(floorf(center.x / mChunkSize));
+		int cellY = static_cast<int>(floorf(center.y / mChunkSize));
+		Texture* texture = mesh->GetTexture(mc->GetTextureIndex());
+		ChunkKey key(cellX, cellY, texture, mesh->GetSpecPower());
+
+		auto iter = chunkIndices.find(key);
+		if (iter == chunkIndices.end())
+		{
+			iter = chunkIndices.emplace(key, mChunks.size()).first;
+			mChunks.emplace_back();
+			mChunks.back().mTexture = texture;
+			mChunks.back().mSpecPower = mesh->GetSpecPower();
+		}
+		Chunk& chunk = mChunks[iter->second];
+
+		// Pre-transform position and normal, the uvs are copied as they are
+		const std::vector<float>& verts = mesh->GetVertices();
+		const size_t vertSize = mesh->GetVertexSize();
+		const unsigned int baseVertex = static_cast<unsigned int>(chunk.mVertices.size() / 8);
+		for (size_t i = 0; i + vertSize <= verts.size(); i += vertSize)
+		{
+			Vector3 pos = Vector3::Transform(Vector3(verts[i], verts[i + 1], verts[i + 2]), world);
+			Vector3 normal = Vector3::Transform(Vector3(verts[i + 3], verts[i + 4], verts[i + 5]), world, 0.0f);
+			normal.Normalize();
+			chunk.mBounds.UpdateMinMax(pos);
+
+			chunk.mVertices.insert(chunk.mVertices.end(), { pos.x, pos.y, pos.z, normal.x, normal.y, normal.z, verts[i + 6], verts[i + 7] });
+		}
+		for (unsigned int index : mesh->GetIndices())
+		{
+			chunk.mIndices.emplace_back(baseVertex + index);
+		}
+	}
+
+	if (createGPUBuffers)
+	{
+		for (auto& chunk : mChunks)
+		{
+			chunk.mVertexArray = new VertexArray(chunk.mVertices.data(), static_cast<unsigned>(chunk.mVertices.size() / 8),
+				chunk.mIndices.data(), static_cast<unsigned>(chunk.mIndices.size()));
+		}
+	}
+}
+
+void StaticGeometry::Unload()
+{
+	for (auto& chunk : mChunks)
+	{
+		delete chunk.mVertexArray;
+	}
+	mChunks.clear();
+}
+
+void StaticGeometry::SortFrontToBack(const Vector3& pos)
+{
+	// By distance to the center of each chunk's bounds
+	std::sort(mChunks.begin(), mChunks.end(), [&pos](const Chunk& a, const Chunk& b)
+	{
+		Vector3 centerA = (a.mBounds.mMin + a.mBounds.mMax) * 0.5f;
+		Vector3 centerB = (b.mBounds.mMin + b.mBounds.mMax) * 0.5f;
+		return (centerA - pos).LengthSq() < (centerB - pos).LengthSq();
+	});
+}
+
+void StaticGeometry::Draw(Shader* shader, const OcclusionCuller* culler)
+{
+	// Vertices are already in world space
+	shader->SetMatrixUniform("uWorldTransform", Matrix4::Identity);
+	for (auto& chunk : mChunks)
+	{
+		if (chunk.mVertexArray == nullptr || (culler && !culler->IsVisible(chunk.mBounds)))
+		{
+			continue;
+		}
+		shader->SetFloatUniform("uSpecPower", chunk.mSpecPower);
+		if (chunk.mTexture)
+		{
+			chunk.mTexture->SetActive();
+		}
+		chunk.mVertexArray->SetActive();
+		chunk.mVertexArray->SetFormatUniforms(shader);
+		glDrawElements(GL_TRIANGLES, chunk.mVertexArray->GetNumIndices(), chunk.mVertexArray->GetIndexType(), nullptr);
+	}
+}
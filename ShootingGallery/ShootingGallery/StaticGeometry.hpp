@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+#include "Collision.hpp"
+
+// Static meshes baked into a handful of world space chunks.
+// Every chunk has its vertices pre-transformed and is drawn with a single draw call,
+// so static actors need no world matrix upload or per-actor draw.
+class StaticGeometry
+{
+public:
+	struct Chunk
+	{
+		Chunk();
+
+		AABB mBounds;
+		class Texture* mTexture;
+		float mSpecPower;
+		std::vector<float> mVertices;
+		std::vector<unsigned int> mIndices;
+		class VertexArray* mVertexArray;
+	};
+
+	// Meshes are grouped into chunkSize x chunkSize cells on the xy plane
+	StaticGeometry(float chunkSize = 1000.0f);
+	~StaticGeometry();
+
+	// Pre-transform the meshes into chunks, GPU buffers are only created if createGPUBuffers is set
+	void Bake(const std::vector<class MeshComponent*>& meshes, bool createGPUBuffers);
+	void Unload();
+
+	// Reorder the chunks so the ones closest to pos are drawn first
+	void SortFrontToBack(const Vector3& pos);
+	// Chunks the culler reports as hidden are skipped
+	void Draw(class Shader* shader, const class OcclusionCuller* culler = nullptr);
+
+	const std::vector<Chunk>& GetChunks() const { return mChunks; }
+
+private:
+	float mChunkSize;
+	std::vector<Chunk> mChunks;
+};
@@ -5,12 +5,12 @@
 #include "BoxComponent.hpp"
 #include "Mesh.hpp"
 
-TargetActor::TargetActor(Game* game):Actor(game)
+TargetActor::TargetActor(Game* game):Actor(game, ETarget), mHits(0)
 {
 	//SetScale(10.0f);
 	SetRotation(Quaternion(Vector3::UnitZ, Math::Pi));
 	MeshComponent* mc = new MeshComponent(this);
-	Mesh* mesh = GetGame()->GetRenderer()->GetMesh("Assets/Target.gpmesh");
+	AssetHandle<Mesh> mesh = GetGame()->GetRenderer()->GetMesh("Assets/Target.gpmesh");
 	mc->SetMesh(mesh);
 	// Add collision box
 	BoxComponent* bc = new BoxComponent(this);
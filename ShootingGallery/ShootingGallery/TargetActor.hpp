@@ -5,4 +5,10 @@ class TargetActor : public Actor
 {
 public:
 	TargetActor(class Game* game);
+
+	void OnHit() { mHits++; }
+	int GetHits() const { return mHits; }
+
+private:
+	int mHits;
 };
\ No newline at end of file
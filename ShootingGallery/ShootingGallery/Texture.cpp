@@ -1,55 +1,287 @@
 #include "Texture.hpp"
+#include "VirtualFS.hpp"
+#include "Math.hpp"
 #include <SOIL\SOIL.h>
 #include <GL/glew.h>
 #include <SDL.h>
+#include <cmath>
+#include <cstring>
+#include <mutex>
 
-Texture::Texture():mTextureID(0), mWidth(0), mHeight(0)
+namespace
 {
+	int LevelSize(int size, int level)
+	{
+		return Math::Max(size >> level, 1);
+	}
+
+	// 2x2 box filter, odd edges reuse the last row/column
+	void Downsample(const std::vector<uint8_t>& src, int width, int height, std::vector<uint8_t>& out)
+	{
+		int outWidth = Math::Max(width / 2, 1);
+		int outHeight = Math::Max(height / 2, 1);
+		out.resize(static_cast<size_t>(outWidth) * outHeight * 4);
+		for (int y = 0; y < outHeight; y++)
+		{
+			const uint8_t* row0 = &src[static_cast<size_t>(Math::Min(y * 2, height - 1)) * width * 4];
+			const uint8_t* row1 = &src[static_cast<size_t>(Math::Min(y * 2 + 1, height - 1)) * width * 4];
+			uint8_t* dst = &out[static_cast<size_t>(y) * outWidth * 4];
+			for (int x = 0; x < outWidth; x++)
+			{
+				int x0 = Math::Min(x * 2, width - 1) * 4;
+				int x1 = Math::Min(x * 2 + 1, width - 1) * 4;
+				for (int c = 0; c < 4; c++)
+				{
+					dst[x * 4 + c] = static_cast<uint8_t>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+				}
+			}
+		}
+	}
+
+	bool ReadTextureFile(const std::string& fileName, FileData& outFile)
+	{
+		if (!VirtualFS::ReadFile(fileName, outFile))
+		{
+			SDL_Log("Texture file not found: %s", fileName.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	// Reads the size from a png's header, false for other formats
+	bool ReadPngSize(const FileData& file, int& outWidth, int& outHeight)
+	{
+		const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		const uint8_t* data = file.GetData();
+		// The IHDR chunk always comes first: length, "IHDR", then big endian width and height
+		if (file.GetSize() < 24 || memcmp(data, signature, sizeof(signature)) != 0 || memcmp(data + 12, "IHDR", 4) != 0)
+		{
+			return false;
+		}
+		uint32_t width = (static_cast<uint32_t>(data[16]) << 24) | (data[17] << 16) | (data[18] << 8) | data[19];
+		uint32_t height = (static_cast<uint32_t>(data[20]) << 24) | (data[21] << 16) | (data[22] << 8) | data[23];
+		if (width == 0 || height == 0 || width > 0x7FFFFFFF || height > 0x7FFFFFFF)
+		{
+			return false;
+		}
+		outWidth = static_cast<int>(width);
+		outHeight = static_cast<int>(height);
+		return true;
+	}
 
+	unsigned char* DecodeImage(const std::string& fileName, const FileData& file, int& outWidth, int& outHeight)
+	{
+		// SOIL keeps its last error in a global, so the streaming workers and the loading
+		// thread take turns decoding (the mips are still built in parallel)
+		static std::mutex soilMutex;
+		std::lock_guard<std::mutex> lock(soilMutex);
+		int channels = 0;
+		// Always RGBA so every mip has the same layout
+		unsigned char* image = SOIL_load_image_from_memory(file.GetData(), static_cast<int>(file.GetSize()), &outWidth, &outHeight, &channels, SOIL_LOAD_RGBA);
+		if (image == nullptr)
+		{
+			SDL_Log("SOIL failed to load image %s: %s", fileName.c_str(), SOIL_last_result());
+		}
+		return image;
+	}
 }
 
-Texture::~Texture()
+Texture::Texture():mTextureID(0), mWidth(0), mHeight(0), mNumLevels(1), mResidentLevel(0), mRequestedLevel(1), mStreamed(false)
 {
 
 }
 
-bool Texture::Load(const std::string& fileName)
+Texture::~Texture()
 {
-	int channels = 0;
 
-	unsigned char* image = SOIL_load_image(fileName.c_str(), &mWidth, &mHeight, &channels, SOIL_LOAD_AUTO);
+}
 
-	if (image == nullptr)
+bool Texture::Load(const std::string& fileName, bool createGPUTexture, bool streamed)
+{
+	FileData file;
+	if (!ReadTextureFile(fileName, file))
 	{
-		SDL_Log("SOIL failed to load image %s: %s", fileName.c_str(), SOIL_last_result());
 		return false;
 	}
+	mFileName = fileName;
 
-	int format = GL_RGB;
-	if (channels == 4)
+	// Headless textures only need their size, pngs don't have to be decoded for it
+	unsigned char* image = nullptr;
+	if (createGPUTexture || !ReadPngSize(file, mWidth, mHeight))
 	{
-		format = GL_RGBA;
+		image = DecodeImage(fileName, file, mWidth, mHeight);
+		if (image == nullptr)
+		{
+			return false;
+		}
 	}
 
-	glGenTextures(1, &mTextureID);
-	glBindTexture(GL_TEXTURE_2D, mTextureID);
+	mNumLevels = 1;
+	while ((Math::Max(mWidth, mHeight) >> mNumLevels) > 0)
+	{
+		mNumLevels++;
+	}
 
-	glTexImage2D(GL_TEXTURE_2D, 0, format, mWidth, mHeight, 0, format, GL_UNSIGNED_BYTE, image);
+	if (!createGPUTexture)
+	{
+		if (image)
+		{
+			SOIL_free_image_data(image);
+		}
+		return true;
+	}
 
+	mStreamed = streamed;
+	int firstLevel = mStreamed ? GetTailLevel() : 0;
+	std::vector<std::vector<uint8_t>> levels;
+	BuildLevels(image, mWidth, mHeight, firstLevel, mNumLevels - 1, levels);
 	SOIL_free_image_data(image);
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glGenTextures(1, &mTextureID);
+	UploadLevels(firstLevel, levels);
+	mResidentLevel = firstLevel;
+	mRequestedLevel = mNumLevels;
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 	return true;
 }
 
+void Texture::CreateFromPixels(const unsigned char* pixels, int width, int height)
+{
+	mWidth = width;
+	mHeight = height;
+	mNumLevels = 1;
+
+	glGenTextures(1, &mTextureID);
+	glBindTexture(GL_TEXTURE_2D, mTextureID);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, mWidth, mHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
+
 void Texture::Unload()
 {
-	glDeleteTextures(1, &mTextureID);
+	if (mTextureID != 0)
+	{
+		glDeleteTextures(1, &mTextureID);
+		mTextureID = 0;
+	}
 }
 
 void Texture::SetActive()
 {
 	glBindTexture(GL_TEXTURE_2D, mTextureID);
-}
\ No newline at end of file
+}
+
+size_t Texture::GetGPUBytes() const
+{
+	if (mTextureID == 0)
+	{
+		return 0;
+	}
+	size_t bytes = 0;
+	for (int level = mResidentLevel; level < mNumLevels; level++)
+	{
+		bytes += GetLevelBytes(level);
+	}
+	return bytes;
+}
+
+int Texture::GetTailLevel() const
+{
+	int level = 0;
+	while (level + 1 < mNumLevels && Math::Max(LevelSize(mWidth, level), LevelSize(mHeight, level)) > TailSize)
+	{
+		level++;
+	}
+	return level;
+}
+
+size_t Texture::GetLevelBytes(int level) const
+{
+	return static_cast<size_t>(LevelSize(mWidth, level)) * LevelSize(mHeight, level) * 4;
+}
+
+void Texture::RequestPixels(float pixels)
+{
+	// One texel per pixel: every halving of the on-screen size allows one coarser level
+	float texels = static_cast<float>(Math::Max(mWidth, mHeight));
+	int level = pixels >= texels ? 0 : static_cast<int>(std::log2(texels / Math::Max(pixels, 1.0f)));
+	mRequestedLevel = Math::Min(mRequestedLevel, Math::Min(level, mNumLevels - 1));
+}
+
+int Texture::TakeRequest()
+{
+	int level = mRequestedLevel;
+	mRequestedLevel = mNumLevels;
+	return level;
+}
+
+void Texture::UploadLevels(int firstLevel, const std::vector<std::vector<uint8_t>>& levels)
+{
+	glBindTexture(GL_TEXTURE_2D, mTextureID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		int level = firstLevel + static_cast<int>(i);
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, LevelSize(mWidth, level), LevelSize(mHeight, level), 0, GL_RGBA, GL_UNSIGNED_BYTE, levels[i].data());
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	// Levels below the base aren't defined (streamed out), GL only samples base to max
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, firstLevel);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mNumLevels - 1);
+}
+
+void Texture::ReleaseLevelsBelow(int level)
+{
+	glBindTexture(GL_TEXTURE_2D, mTextureID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+	for (int i = 0; i < level; i++)
+	{
+		// A zero sized image gives the level's memory back
+		glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	}
+}
+
+bool Texture::DecodeLevels(const std::string& fileName, int firstLevel, int lastLevel, std::vector<std::vector<uint8_t>>& outLevels)
+{
+	FileData file;
+	if (!ReadTextureFile(fileName, file))
+	{
+		return false;
+	}
+	int width = 0;
+	int height = 0;
+	unsigned char* image = DecodeImage(fileName, file, width, height);
+	if (image == nullptr)
+	{
+		return false;
+	}
+	BuildLevels(image, width, height, firstLevel, lastLevel, outLevels);
+	SOIL_free_image_data(image);
+	return true;
+}
+
+void Texture::BuildLevels(const unsigned char* image, int width, int height, int firstLevel, int lastLevel,
+	std::vector<std::vector<uint8_t>>& outLevels)
+{
+	outLevels.clear();
+	std::vector<uint8_t> current(image, image + static_cast<size_t>(width) * height * 4);
+	std::vector<uint8_t> next;
+	for (int level = 0; level <= lastLevel; level++)
+	{
+		if (level >= firstLevel)
+		{
+			outLevels.emplace_back(current);
+		}
+		if (level < lastLevel)
+		{
+			Downsample(current, LevelSize(width, level), LevelSize(height, level), next);
+			current.swap(next);
+		}
+	}
+}
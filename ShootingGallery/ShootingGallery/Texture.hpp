@@ -1,19 +1,65 @@
+#pragma once
+#include <cstdint>
 #include <string>
+#include <vector>
 
 class Texture
 {
 public:
+	// Streamed textures always keep the mips of at most this many pixels a side resident
+	static const int TailSize = 64;
+
 	Texture();
 	~Texture();
 
-	bool Load(const std::string& fileName);
+	// When createGPUTexture is false only the image size is kept (headless mode).
+	// Every mip is uploaded, unless the texture is streamed: then only the mip tail is and TextureStreamer adds the rest.
+	bool Load(const std::string& fileName, bool createGPUTexture = true, bool streamed = false);
+	// Create a texture from tightly packed RGBA8 pixels
+	void CreateFromPixels(const unsigned char* pixels, int width, int height);
 	void Unload();
 	void SetActive();
 
 	int GetWidth() const { return mWidth; }
 	int GetHeight() const { return mHeight; }
+	// Pixels live on the GPU only (headless textures take none)
+	size_t GetCPUBytes() const { return sizeof(Texture); }
+	// Bytes of the resident mips
+	size_t GetGPUBytes() const;
+
+	// Level 0 is the full image, every level halves the size down to 1x1
+	const std::string& GetFileName() const { return mFileName; }
+	int GetNumLevels() const { return mNumLevels; }
+	int GetTailLevel() const;
+	size_t GetLevelBytes(int level) const;
+	bool IsStreamed() const { return mStreamed; }
+	// Finest level on the GPU. Tracked on the simulation side, the GL calls follow on the render thread.
+	int GetResidentLevel() const { return mResidentLevel; }
+	void SetResidentLevel(int level) { mResidentLevel = level; }
+
+	// Feedback: something drawn with this texture covers about this many pixels across
+	void RequestPixels(float pixels);
+	// Finest level asked for since the last call, GetNumLevels() if nothing drew the texture
+	int TakeRequest();
+
+	// Render thread: uploads levels firstLevel and up and samples from firstLevel on
+	void UploadLevels(int firstLevel, const std::vector<std::vector<uint8_t>>& levels);
+	// Render thread: frees the levels finer than level
+	void ReleaseLevelsBelow(int level);
+
+	// Decodes an image to RGBA8 and box filters mips firstLevel to lastLevel (any thread)
+	static bool DecodeLevels(const std::string& fileName, int firstLevel, int lastLevel, std::vector<std::vector<uint8_t>>& outLevels);
+
 private:
+	static void BuildLevels(const unsigned char* image, int width, int height, int firstLevel, int lastLevel,
+		std::vector<std::vector<uint8_t>>& outLevels);
+
 	unsigned int mTextureID;
 	int mWidth;
 	int mHeight;
-};
\ No newline at end of file
+	std::string mFileName;
+	int mNumLevels;
+	int mResidentLevel;
+	int mRequestedLevel;
+	bool mStreamed;
+};
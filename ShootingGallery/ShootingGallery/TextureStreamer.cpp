@@ -0,0 +1,297 @@
+#include "TextureStreamer.hpp"
+#include "Texture.hpp"
+#include "Profiler.hpp"
+#include "Math.hpp"
+#include <algorithm>
+#include <memory>
+#include <SDL.h>
+
+TextureStreamer::TextureStreamer(Runner runner, ResidencyChanged residencyChanged, size_t budget):mRunner(runner), mResidencyChanged(residencyChanged), mBudget(budget), mFrame(0), mInFlightBytes(0), mInFlight(0), mQuit(false)
+{
+	for (int i = 0; i < NumWorkers; i++)
+	{
+		mWorkers.emplace_back(&TextureStreamer::WorkerMain, this);
+	}
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mJobMutex);
+		mQuit = true;
+		mJobs.clear();
+	}
+	mJobReady.notify_all();
+	for (std::thread& worker : mWorkers)
+	{
+		worker.join();
+	}
+	Result* result = nullptr;
+	while (mResults.Pop(result))
+	{
+		delete result;
+	}
+	for (Entry* entry : mEntries)
+	{
+		delete entry;
+	}
+}
+
+void TextureStreamer::Register(Texture* texture, AssetID id)
+{
+	if (texture->GetTailLevel() == 0)
+	{
+		return;
+	}
+	Entry* entry = new Entry();
+	entry->mTexture = texture;
+	entry->mID = id;
+	entry->mWantedLevel = texture->GetTailLevel();
+	entry->mLastSeenFrame = mFrame;
+	entry->mPendingBytes = 0;
+	entry->mPending = false;
+	entry->mFailed = false;
+	mEntries.emplace_back(entry);
+}
+
+void TextureStreamer::Unregister(Texture* texture)
+{
+	auto iter = std::find_if(mEntries.begin(), mEntries.end(), [texture](const Entry* e) { return e->mTexture == texture; });
+	if (iter == mEntries.end())
+	{
+		return;
+	}
+	Entry* entry = *iter;
+	if (entry->mPending)
+	{
+		// The worker still points at the entry, ReceiveResults frees it
+		entry->mTexture = nullptr;
+		return;
+	}
+	mEntries.erase(iter);
+	delete entry;
+}
+
+void TextureStreamer::Update()
+{
+	PROFILE_SCOPE("TextureStreamer::Update");
+	mFrame++;
+	ReceiveResults();
+
+	// Turn this frame's requests into the level each texture should have
+	size_t neededBytes = 0;
+	mStats.mTextures = 0;
+	mStats.mResidentBytes = 0;
+	mStats.mWantedBytes = 0;
+	for (Entry* entry : mEntries)
+	{
+		Texture* texture = entry->mTexture;
+		if (texture == nullptr)
+		{
+			continue;
+		}
+		int requested = texture->TakeRequest();
+		if (requested < texture->GetNumLevels())
+		{
+			entry->mLastSeenFrame = mFrame;
+		}
+		entry->mWantedLevel = Math::Min(requested, texture->GetTailLevel());
+		int resident = texture->GetResidentLevel();
+		if (!entry->mPending && !entry->mFailed && entry->mWantedLevel < resident)
+		{
+			neededBytes += GetBytes(texture, entry->mWantedLevel, resident - 1);
+		}
+		mStats.mTextures++;
+		mStats.mResidentBytes += texture->GetGPUBytes();
+		mStats.mWantedBytes += GetBytes(texture, entry->mWantedLevel, texture->GetNumLevels() - 1);
+	}
+
+	Evict(neededBytes);
+	QueueLoads();
+}
+
+void TextureStreamer::ReceiveResults()
+{
+	// Uploads are spread over frames so a burst of finished jobs doesn't stall the render thread
+	Result* result = nullptr;
+	int uploads = 0;
+	while (uploads < MaxUploadsPerFrame && mResults.Pop(result))
+	{
+		Entry* entry = result->mEntry;
+		mInFlight--;
+		mInFlightBytes -= entry->mPendingBytes;
+		entry->mPendingBytes = 0;
+		entry->mPending = false;
+
+		Texture* texture = entry->mTexture;
+		if (texture == nullptr)
+		{
+			mEntries.erase(std::find(mEntries.begin(), mEntries.end(), entry));
+			delete entry;
+			delete result;
+			continue;
+		}
+		if (!result->mLoaded)
+		{
+			entry->mFailed = true;
+			mStats.mFailedLoads++;
+			delete result;
+			continue;
+		}
+
+		// Nothing evicts a texture with a load in flight, so the levels still continue the resident ones
+		texture->SetResidentLevel(result->mFirstLevel);
+		mStats.mStreamedLevels += result->mLevels.size();
+		std::shared_ptr<Result> upload(result);
+		mRunner([texture, upload]() { texture->UploadLevels(upload->mFirstLevel, upload->mLevels); });
+		mResidencyChanged(entry->mID);
+		uploads++;
+	}
+}
+
+void TextureStreamer::Evict(size_t neededBytes)
+{
+	if (mStats.mResidentBytes + mInFlightBytes + neededBytes <= mBudget)
+	{
+		return;
+	}
+
+	// Textures holding finer levels than they need, least recently seen first
+	std::vector<Entry*> candidates;
+	for (Entry* entry : mEntries)
+	{
+		if (entry->mTexture && !entry->mPending && entry->mTexture->GetResidentLevel() < entry->mWantedLevel)
+		{
+			candidates.emplace_back(entry);
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const Entry* a, const Entry* b)
+	{
+		return a->mLastSeenFrame < b->mLastSeenFrame;
+	});
+
+	for (Entry* entry : candidates)
+	{
+		if (mStats.mResidentBytes + mInFlightBytes + neededBytes <= mBudget)
+		{
+			break;
+		}
+		Texture* texture = entry->mTexture;
+		int level = entry->mWantedLevel;
+		mStats.mResidentBytes -= GetBytes(texture, texture->GetResidentLevel(), level - 1);
+		mStats.mEvictedLevels += level - texture->GetResidentLevel();
+		texture->SetResidentLevel(level);
+		mRunner([texture, level]() { texture->ReleaseLevelsBelow(level); });
+		mResidencyChanged(entry->mID);
+	}
+}
+
+void TextureStreamer::QueueLoads()
+{
+	std::vector<Entry*> candidates;
+	for (Entry* entry : mEntries)
+	{
+		if (entry->mTexture && !entry->mPending && !entry->mFailed && entry->mWantedLevel < entry->mTexture->GetResidentLevel())
+		{
+			candidates.emplace_back(entry);
+		}
+	}
+	// The textures furthest from what the screen needs go first
+	std::sort(candidates.begin(), candidates.end(), [](const Entry* a, const Entry* b)
+	{
+		return a->mTexture->GetResidentLevel() - a->mWantedLevel > b->mTexture->GetResidentLevel() - b->mWantedLevel;
+	});
+
+	for (Entry* entry : candidates)
+	{
+		if (mInFlight >= MaxInFlight)
+		{
+			break;
+		}
+		Texture* texture = entry->mTexture;
+		int resident = texture->GetResidentLevel();
+		int first = entry->mWantedLevel;
+		size_t bytes = GetBytes(texture, first, resident - 1);
+		// Settle for coarser levels when the wanted ones don't fit the budget
+		while (first < resident && mStats.mResidentBytes + mInFlightBytes + bytes > mBudget)
+		{
+			bytes -= texture->GetLevelBytes(first);
+			first++;
+		}
+		if (first == resident)
+		{
+			continue;
+		}
+
+		Job job;
+		job.mEntry = entry;
+		job.mFileName = texture->GetFileName();
+		job.mFirstLevel = first;
+		job.mLastLevel = resident - 1;
+		entry->mPending = true;
+		entry->mPendingBytes = bytes;
+		mInFlight++;
+		mInFlightBytes += bytes;
+		{
+			std::lock_guard<std::mutex> lock(mJobMutex);
+			mJobs.emplace_back(std::move(job));
+		}
+		mJobReady.notify_one();
+	}
+}
+
+void TextureStreamer::WorkerMain()
+{
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mJobMutex);
+			mJobReady.wait(lock, [this]() { return mQuit || !mJobs.empty(); });
+			if (mQuit)
+			{
+				return;
+			}
+			job = std::move(mJobs.front());
+			mJobs.pop_front();
+		}
+
+		Result* result = new Result();
+		result->mEntry = job.mEntry;
+		result->mFirstLevel = job.mFirstLevel;
+		result->mLoaded = Texture::DecodeLevels(job.mFileName, job.mFirstLevel, job.mLastLevel, result->mLevels);
+		// Can't fail, there are never more than MaxInFlight results
+		mResults.Push(result);
+	}
+}
+
+size_t TextureStreamer::GetBytes(const Texture* texture, int firstLevel, int lastLevel) const
+{
+	size_t bytes = 0;
+	for (int level = firstLevel; level <= lastLevel; level++)
+	{
+		bytes += texture->GetLevelBytes(level);
+	}
+	return bytes;
+}
+
+void TextureStreamer::LogStats() const
+{
+	SDL_Log("Texture streaming: %zu textures, %.2f MB resident of %.2f MB budget (%.2f MB wanted), %d loads in flight, %llu levels streamed, %llu evicted, %llu failed loads",
+		mStats.mTextures, mStats.mResidentBytes / (1024.0 * 1024.0), mBudget / (1024.0 * 1024.0), mStats.mWantedBytes / (1024.0 * 1024.0),
+		mInFlight, static_cast<unsigned long long>(mStats.mStreamedLevels), static_cast<unsigned long long>(mStats.mEvictedLevels),
+		static_cast<unsigned long long>(mStats.mFailedLoads));
+	for (const Entry* entry : mEntries)
+	{
+		const Texture* texture = entry->mTexture;
+		if (texture == nullptr)
+		{
+			continue;
+		}
+		int resident = texture->GetResidentLevel();
+		SDL_Log("  %s: %dx%d, level %d resident (%dx%d, %.1f KB), level %d wanted%s%s", texture->GetFileName().c_str(),
+			texture->GetWidth(), texture->GetHeight(), resident, Math::Max(texture->GetWidth() >> resident, 1),
+			Math::Max(texture->GetHeight() >> resident, 1), texture->GetGPUBytes() / 1024.0, entry->mWantedLevel,
+			entry->mPending ? ", loading" : "", entry->mFailed ? ", failed" : "");
+	}
+}
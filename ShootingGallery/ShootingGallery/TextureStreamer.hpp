@@ -0,0 +1,111 @@
+#pragma once
+#include "MPSCQueue.hpp"
+#include "AssetCache.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Streams the finer mips of textures that were loaded with only their mip tail.
+// Every frame the renderer reports how large each texture is on screen (Texture::RequestPixels),
+// Update turns that into decode jobs for the worker threads, uploads what they finished and,
+// when the VRAM budget is short, drops the finest mips of the textures seen least recently.
+// Everything but the workers runs on the simulation thread, GL work goes through the runner.
+class TextureStreamer
+{
+public:
+	// Queues a GL command on the thread that owns the context
+	typedef std::function<void(std::function<void()>)> Runner;
+	// Called when a texture's resident levels (and so its GPU bytes) changed
+	typedef std::function<void(AssetID)> ResidencyChanged;
+
+	struct Stats
+	{
+		size_t mTextures = 0;
+		size_t mResidentBytes = 0;
+		size_t mWantedBytes = 0;
+		uint64_t mStreamedLevels = 0;
+		uint64_t mEvictedLevels = 0;
+		uint64_t mFailedLoads = 0;
+	};
+
+	TextureStreamer(Runner runner, ResidencyChanged residencyChanged, size_t budget);
+	~TextureStreamer();
+
+	// Resident mips of the streamed textures are kept under this many bytes, the mip tails always stay
+	void SetBudget(size_t bytes) { mBudget = bytes; }
+
+	// Textures without levels above their tail are ignored
+	void Register(class Texture* texture, AssetID id);
+	// Call before the texture is unloaded, a load still in flight is thrown away
+	void Unregister(class Texture* texture);
+
+	// Call once per frame after the requests were made
+	void Update();
+
+	const Stats& GetStats() const { return mStats; }
+	// Logs the resident and wanted level of every streamed texture
+	void LogStats() const;
+
+private:
+	static const int NumWorkers = 2;
+	// Jobs and unread results together, so the result queue can never fill up
+	static const int MaxInFlight = 8;
+	static const int MaxUploadsPerFrame = 2;
+
+	struct Entry
+	{
+		class Texture* mTexture;
+		AssetID mID;
+		int mWantedLevel;
+		uint32_t mLastSeenFrame;
+		// Levels of the job in flight, 0 bytes when there is none
+		size_t mPendingBytes;
+		bool mPending;
+		// The file couldn't be decoded, the texture keeps what it has
+		bool mFailed;
+	};
+
+	struct Job
+	{
+		Entry* mEntry;
+		std::string mFileName;
+		int mFirstLevel;
+		int mLastLevel;
+	};
+
+	struct Result
+	{
+		Entry* mEntry;
+		int mFirstLevel;
+		std::vector<std::vector<uint8_t>> mLevels;
+		bool mLoaded;
+	};
+
+	void WorkerMain();
+	void ReceiveResults();
+	void Evict(size_t neededBytes);
+	void QueueLoads();
+	size_t GetBytes(const class Texture* texture, int firstLevel, int lastLevel) const;
+
+	Runner mRunner;
+	ResidencyChanged mResidencyChanged;
+	size_t mBudget;
+	uint32_t mFrame;
+	std::vector<Entry*> mEntries;
+	size_t mInFlightBytes;
+	int mInFlight;
+	Stats mStats;
+
+	std::vector<std::thread> mWorkers;
+	std::mutex mJobMutex;
+	std::condition_variable mJobReady;
+	std::deque<Job> mJobs;
+	bool mQuit;
+	MPSCQueue<Result*, 16> mResults;
+};
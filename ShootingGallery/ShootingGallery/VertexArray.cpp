@@ -1,18 +1,76 @@
 #include "VertexArray.hpp"
+#include "Shader.hpp"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
 #include <GL/glew.h>
+#include <SDL_log.h>
 
-VertexArray::VertexArray(const float* verts, unsigned int numVerts, const unsigned int* indices, unsigned int numIndices) :mNumVerts(numVerts), mNumIndices(numIndices)
+namespace
+{
+	struct CompactVertex
+	{
+		uint16_t mPosition[4];
+		int16_t mNormal[2];
+		uint16_t mTexCoord[2];
+	};
+
+	uint16_t ToUnorm16(float value)
+	{
+		return static_cast<uint16_t>(Math::Clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+	}
+
+	int16_t ToSnorm16(float value)
+	{
+		float scaled = Math::Clamp(value, -1.0f, 1.0f) * 32767.0f;
+		return static_cast<int16_t>(scaled >= 0.0f ? scaled + 0.5f : scaled - 0.5f);
+	}
+}
+
+VertexArray::VertexArray(const float* verts, unsigned int numVerts, const unsigned int* indices, unsigned int numIndices, Format format)
+	:mNumVerts(numVerts), mNumIndices(numIndices), mIndexType(GL_UNSIGNED_INT), mFormat(format), mBufferSize(0), mPosScale(1.0f, 1.0f, 1.0f), mPosOffset(Vector3::Zero)
 {
 	glGenVertexArrays(1, &mVertexArray);
 	glBindVertexArray(mVertexArray);
 
 	glGenBuffers(1, &mVertexBuffer);
 	glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
-	glBufferData(GL_ARRAY_BUFFER, numVerts * 8 * sizeof(float), verts, GL_STATIC_DRAW);
+	if (mFormat == ECompact && !CreateCompactVertices(verts))
+	{
+		mFormat = EFloat;
+	}
+	if (mFormat == EFloat)
+	{
+		CreateFloatVertices(verts);
+	}
 
 	glGenBuffers(1, &mIndexBuffer);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+	if (numVerts <= 65536)
+	{
+		std::vector<uint16_t> shortIndices(indices, indices + numIndices);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(uint16_t), shortIndices.data(), GL_STATIC_DRAW);
+		mIndexType = GL_UNSIGNED_SHORT;
+		mBufferSize += numIndices * sizeof(uint16_t);
+	}
+	else
+	{
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+		mBufferSize += numIndices * sizeof(unsigned int);
+	}
+}
+
+VertexArray::~VertexArray()
+{
+	glDeleteBuffers(1, &mVertexBuffer);
+	glDeleteBuffers(1, &mIndexBuffer);
+	glDeleteVertexArrays(1, &mVertexArray);
+}
+
+void VertexArray::CreateFloatVertices(const float* verts)
+{
+	glBufferData(GL_ARRAY_BUFFER, mNumVerts * 8 * sizeof(float), verts, GL_STATIC_DRAW);
+	mBufferSize += mNumVerts * 8 * sizeof(float);
 
 	// Position is 3 floats
 	glEnableVertexAttribArray(0);
@@ -25,14 +83,106 @@ VertexArray::VertexArray(const float* verts, unsigned int numVerts, const unsign
 	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), reinterpret_cast<void*>(sizeof(float) * 6));
 }
 
-VertexArray::~VertexArray()
+bool VertexArray::CreateCompactVertices(const float* verts)
 {
-	glDeleteBuffers(1, &mVertexBuffer);
-	glDeleteBuffers(1, &mIndexBuffer);
-	glDeleteVertexArrays(1, &mVertexArray);
+	// Unorm uvs can't repeat, such meshes keep the float format
+	Vector3 minPos = Vector3::Infinity;
+	Vector3 maxPos = Vector3::NegInfinity;
+	for (unsigned int i = 0; i < mNumVerts; i++)
+	{
+		const float* v = verts + i * 8;
+		if (v[6] < 0.0f || v[6] > 1.0f || v[7] < 0.0f || v[7] > 1.0f)
+		{
+			SDL_Log("Vertex uvs outside [0, 1], using the float vertex format");
+			return false;
+		}
+		minPos.Set(Math::Min(minPos.x, v[0]), Math::Min(minPos.y, v[1]), Math::Min(minPos.z, v[2]));
+		maxPos.Set(Math::Max(maxPos.x, v[0]), Math::Max(maxPos.y, v[1]), Math::Max(maxPos.z, v[2]));
+	}
+
+	// Shader decodes position = attribute * uPosScale + uPosOffset
+	mPosOffset = minPos;
+	mPosScale = maxPos - minPos;
+	std::vector<CompactVertex> packed(mNumVerts);
+	for (unsigned int i = 0; i < mNumVerts; i++)
+	{
+		const float* v = verts + i * 8;
+		CompactVertex& out = packed[i];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float extent = mPosScale.GetAsFloatPtr()[axis];
+			float t = extent > 0.0f ? (v[axis] - mPosOffset.GetAsFloatPtr()[axis]) / extent : 0.0f;
+			out.mPosition[axis] = ToUnorm16(t);
+		}
+		out.mPosition[3] = 0;
+		OctEncode(Vector3(v[3], v[4], v[5]), out.mNormal[0], out.mNormal[1]);
+		out.mTexCoord[0] = ToUnorm16(v[6]);
+		out.mTexCoord[1] = ToUnorm16(v[7]);
+	}
+
+	glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(CompactVertex), packed.data(), GL_STATIC_DRAW);
+	mBufferSize += static_cast<unsigned int>(packed.size() * sizeof(CompactVertex));
+
+	// Position is 3 normalized ushorts (plus padding)
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactVertex), 0);
+	// Normal is 2 normalized shorts, octahedral
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(CompactVertex), reinterpret_cast<void*>(offsetof(CompactVertex, mNormal)));
+	// Texture coordinates is 2 normalized ushorts
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactVertex), reinterpret_cast<void*>(offsetof(CompactVertex, mTexCoord)));
+	return true;
+}
+
+unsigned int VertexArray::GetIndexSize() const
+{
+	return mIndexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
 }
 
 void VertexArray::SetActive()
 {
 	glBindVertexArray(mVertexArray);
-}
\ No newline at end of file
+}
+
+void VertexArray::SetFormatUniforms(Shader* shader) const
+{
+	shader->SetVectorUniform("uPosScale", mPosScale);
+	shader->SetVectorUniform("uPosOffset", mPosOffset);
+	shader->SetIntUniform("uPackedNormals", mFormat == ECompact ? 1 : 0);
+}
+
+void VertexArray::OctEncode(const Vector3& normal, short& outX, short& outY)
+{
+	// Project onto the octahedron, then fold the lower half over the diagonals
+	float sum = Math::Abs(normal.x) + Math::Abs(normal.y) + Math::Abs(normal.z);
+	if (sum <= 0.0f)
+	{
+		outX = 0;
+		outY = 0;
+		return;
+	}
+	float x = normal.x / sum;
+	float y = normal.y / sum;
+	if (normal.z < 0.0f)
+	{
+		float foldX = (1.0f - Math::Abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldY = (1.0f - Math::Abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldX;
+		y = foldY;
+	}
+	outX = ToSnorm16(x);
+	outY = ToSnorm16(y);
+}
+
+Vector3 VertexArray::OctDecode(short x, short y)
+{
+	// Same as OctDecode in the mesh shaders
+	Vector3 n(Math::Max(x / 32767.0f, -1.0f), Math::Max(y / 32767.0f, -1.0f), 0.0f);
+	n.z = 1.0f - Math::Abs(n.x) - Math::Abs(n.y);
+	float t = Math::Max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	n.Normalize();
+	return n;
+}
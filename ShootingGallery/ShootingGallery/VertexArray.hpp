@@ -1,18 +1,51 @@
 #pragma once
+#include "Math.hpp"
 
 class VertexArray
 {
 public:
-	VertexArray(const float* verts, unsigned int numVerts, const unsigned int* indices, unsigned int numIndices);
+	// EFloat is position/normal/uv as 8 floats (32 bytes).
+	// ECompact is 16 bytes: positions quantized to 16 bits inside the vertex bounds,
+	// octahedral normals in two snorm shorts and uvs as unorm shorts.
+	enum Format
+	{
+		EFloat,
+		ECompact
+	};
+
+	// Vertices are always passed as 8 floats, indices are stored as 16 bits when the vertex count allows
+	VertexArray(const float* verts, unsigned int numVerts, const unsigned int* indices, unsigned int numIndices, Format format = EFloat);
 	~VertexArray();
 
 	void SetActive();
+	// Upload uPosScale/uPosOffset/uPackedNormals, needed by the mesh shaders to decode this format
+	void SetFormatUniforms(class Shader* shader) const;
+
 	unsigned int GetNumIndices() const { return mNumIndices; }
 	unsigned int GetNumVerts() const { return mNumVerts; }
+	// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	unsigned int GetIndexType() const { return mIndexType; }
+	// Bytes per index, for turning a first index into a buffer offset
+	unsigned int GetIndexSize() const;
+	Format GetFormat() const { return mFormat; }
+	// Bytes of GPU memory used by the vertex and index buffers
+	unsigned int GetBufferSize() const { return mBufferSize; }
+
+	// Quantization helpers, also used by the mesh tools
+	static void OctEncode(const Vector3& normal, short& outX, short& outY);
+	static Vector3 OctDecode(short x, short y);
 private:
+	void CreateFloatVertices(const float* verts);
+	bool CreateCompactVertices(const float* verts);
+
 	unsigned int mNumVerts;
 	unsigned int mNumIndices;
+	unsigned int mIndexType;
+	Format mFormat;
+	unsigned int mBufferSize;
+	Vector3 mPosScale;
+	Vector3 mPosOffset;
 	unsigned int mVertexBuffer;
 	unsigned int mIndexBuffer;
 	unsigned int mVertexArray;
-};
\ No newline at end of file
+};
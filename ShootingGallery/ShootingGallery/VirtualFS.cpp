@@ -0,0 +1,80 @@
+#include "VirtualFS.hpp"
+#include <fstream>
+#include <memory>
+#include <SDL_log.h>
+
+namespace
+{
+	std::unique_ptr<AssetArchive> sArchive;
+#ifdef _DEBUG
+	bool sLooseOverride = true;
+#else
+	bool sLooseOverride = false;
+#endif
+}
+
+bool VirtualFS::Mount(const std::string& archiveFile)
+{
+	std::unique_ptr<AssetArchive> archive(new AssetArchive());
+	std::string error;
+	if (!archive->Open(archiveFile, error))
+	{
+		SDL_Log("Can't mount asset archive %s: %s", archiveFile.c_str(), error.c_str());
+		return false;
+	}
+	SDL_Log("Mounted asset archive %s (%zu files)%s", archiveFile.c_str(), archive->GetNumEntries(),
+		sLooseOverride ? ", loose files override it" : "");
+	sArchive = std::move(archive);
+	return true;
+}
+
+void VirtualFS::Unmount()
+{
+	sArchive.reset();
+}
+
+bool VirtualFS::IsMounted()
+{
+	return sArchive != nullptr;
+}
+
+void VirtualFS::SetLooseOverride(bool enable)
+{
+	sLooseOverride = enable;
+}
+
+bool VirtualFS::ReadFile(const std::string& path, FileData& outData)
+{
+	if ((!sArchive || sLooseOverride) && ReadLooseFile(path, outData))
+	{
+		return true;
+	}
+	if (sArchive)
+	{
+		const AssetArchive::Entry* entry = sArchive->Find(path);
+		if (entry == nullptr)
+		{
+			return false;
+		}
+		if (!sArchive->Read(*entry, outData))
+		{
+			SDL_Log("Asset archive entry %s is corrupt", path.c_str());
+			return false;
+		}
+		return true;
+	}
+	return false;
+}
+
+bool VirtualFS::ReadLooseFile(const std::string& path, FileData& outData)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	std::streamoff size = file.tellg();
+	file.seekg(0);
+	uint8_t* data = outData.Allocate(static_cast<size_t>(size));
+	return size == 0 || file.read(reinterpret_cast<char*>(data), size).good();
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <string>
+#include "AssetArchive.hpp"
+
+// Where the loaders read Assets/ and Shaders/ from. With a mounted archive files come from
+// the mapping, without one (or for loose files that override it) from disk as before.
+// Mount before any game starts; reading is safe from any thread.
+namespace VirtualFS
+{
+	bool Mount(const std::string& archiveFile);
+	void Unmount();
+	bool IsMounted();
+	// Loose files on disk win over the archive, so assets can be edited without repacking.
+	// On by default in debug builds; costs a failed open per file that only exists in the archive.
+	void SetLooseOverride(bool enable);
+	bool ReadFile(const std::string& path, FileData& outData);
+	// Always reads from disk, for files the game writes itself (cooked levels)
+	bool ReadLooseFile(const std::string& path, FileData& outData);
+}